@@ -0,0 +1,110 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <rs_driver/driver/decoder/block_kernel.hpp>
+#include <rs_driver/common/rs_log.hpp>
+
+#include <chrono>
+#include <random>
+#include <string>
+
+using namespace robosense::lidar;
+
+//
+// Decode 128-channel blocks with each block kernel available on this CPU.
+//
+
+static inline uint64_t nowNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char* argv[])
+{
+  size_t num = 1000000;
+  if (argc > 1)
+  {
+    num = (size_t)std::stoul(argv[1]);
+  }
+
+  const uint16_t CHAN_NUM = 128;
+
+  Trigon trigon;
+  BlockKernelParam param = {0.005f, 0.4f, 250.0f, 0.03615f, 0.0f, trigon.sinTable(), trigon.cosTable()};
+
+  std::mt19937 gen(1);
+  uint8_t chans[CHAN_NUM * 3];
+  float chan_azis[CHAN_NUM];
+  float vert_sins[CHAN_NUM];
+  float vert_coss[CHAN_NUM];
+  int32_t horiz_angles[CHAN_NUM];
+  for (uint16_t i = 0; i < CHAN_NUM; i++)
+  {
+    uint16_t dist = (uint16_t)(100 + gen() % 40000);
+    chans[i * 3] = (uint8_t)(dist >> 8);
+    chans[i * 3 + 1] = (uint8_t)(dist & 0xFF);
+    chans[i * 3 + 2] = (uint8_t)(gen() & 0xFF);
+    chan_azis[i] = (float)(i % 8) / 8;
+    int32_t vert = (int32_t)(gen() % 4000) - 2500;
+    vert_sins[i] = Trigon::calcSin(vert);
+    vert_coss[i] = Trigon::calcCos(vert);
+    horiz_angles[i] = (int32_t)(gen() % 600) - 300;
+  }
+
+  BlockKernelIn in = {chans, CHAN_NUM, 0, 20, chan_azis, vert_sins, vert_coss, horiz_angles};
+  BlockKernelOut out;
+
+  BlockKernelType types[] = {BLOCK_KERNEL_SCALAR, BLOCK_KERNEL_SSE41, BLOCK_KERNEL_AVX2, BLOCK_KERNEL_NEON};
+  for (auto type : types)
+  {
+    BlockKernelFunc kernel = blockKernel(type);
+    if (kernel == NULL)
+      continue;
+
+    float sum = 0;
+    uint64_t start = nowNs();
+    for (size_t i = 0; i < num; i++)
+    {
+      in.block_az = (int32_t)((i * 20) % 36000);
+      kernel(param, in, out, 0);
+      sum += out.x[i % CHAN_NUM];
+    }
+    uint64_t elapsed = nowNs() - start;
+
+    RS_MSG << blockKernelToStr(type) << ": " << (double)elapsed / num << " ns/block, " 
+           << (uint64_t)((double)num * CHAN_NUM * 1e3 / elapsed) << " Mpoints/s"
+           << " (" << sum << ")" << RS_REND;
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <rs_driver/api/lidar_driver.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace robosense::lidar;
+
+typedef PointCloudT<PointXYZI> PointCloudMsg;
+
+//
+// Latency of LidarDriver::init(), with 1 instance and with more instances in the same process.
+//
+
+static inline uint64_t nowUs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void run(size_t num)
+{
+  RSDriverParam param;
+  param.lidar_type = LidarType::RS128;
+  param.input_type = InputType::RAW_PACKET;
+
+  std::vector<std::shared_ptr<LidarDriver<PointCloudMsg>>> drivers;
+  std::vector<uint64_t> elapsed;
+
+  for (size_t i = 0; i < num; i++)
+  {
+    std::shared_ptr<LidarDriver<PointCloudMsg>> driver = std::make_shared<LidarDriver<PointCloudMsg>>();
+    driver->regPointCloudCallback(
+        []() { return std::make_shared<PointCloudMsg>(); }, [](std::shared_ptr<PointCloudMsg>) {});
+    driver->regExceptionCallback([](const Error&) {});
+
+    uint64_t start = nowUs();
+    if (!driver->init(param))
+    {
+      RS_ERROR << "Failed to init driver." << RS_REND;
+      return;
+    }
+    elapsed.emplace_back(nowUs() - start);
+
+    drivers.emplace_back(driver);
+  }
+
+  uint64_t total = 0;
+  std::stringstream ss;
+  for (auto us : elapsed)
+  {
+    total += us;
+    ss << " " << us;
+  }
+
+  RS_MSG << num << " instance(s): total " << total << " us, each(us):" << ss.str() << RS_REND;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t num = 8;
+  if (argc > 1)
+  {
+    num = (size_t)std::stoul(argv[1]);
+  }
+
+  run(1);
+  run(num);
+
+  RS_MSG << "sin/cos table: " << Trigon::tableSize() << " bytes, shared by all instances" << RS_REND;
+  return 0;
+}
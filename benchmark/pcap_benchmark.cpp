@@ -0,0 +1,117 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <rs_driver/driver/input/pcap_reader.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace robosense::lidar;
+
+//
+// Walk a pcap file with PcapReader, and classify MSOP/DIFOP packets by UDP port.
+// Compare views on the mapped file, with copying each packet out (as libpcap based input does).
+//
+
+static inline uint64_t nowNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void run(PcapReader& reader, uint16_t msop_port, uint16_t difop_port, bool copy)
+{
+  std::vector<uint8_t> buf(65536);
+  size_t pkts = 0, bytes = 0;
+  uint32_t sum = 0;
+
+  reader.rewind();
+  uint64_t start = nowNs();
+
+  PcapRecord rec;
+  while (reader.next(rec))
+  {
+    PcapUdp udp;
+    if (!PcapReader::parseUdp(rec.link_type, rec.data, rec.caplen, udp) || (udp.payload == NULL))
+      continue;
+
+    if ((udp.dst_port != msop_port) && (udp.dst_port != difop_port))
+      continue;
+
+    const uint8_t* data = udp.payload;
+    if (copy)
+    {
+      memcpy(buf.data(), udp.payload, udp.payload_len);
+      data = buf.data();
+    }
+
+    sum += data[udp.payload_len - 1];
+    pkts++;
+    bytes += udp.payload_len;
+  }
+
+  uint64_t elapsed = nowNs() - start;
+  RS_MSG << (copy ? "copy: " : "view: ") << pkts << " packets, " 
+         << (uint64_t)((double)pkts * 1e9 / elapsed) << " packets/s, " 
+         << (double)bytes / elapsed << " GB/s" << " (" << sum << ")" << RS_REND;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    RS_MSG << "Usage: pcap_benchmark <pcap file> [msop port] [difop port]" << RS_REND;
+    return 1;
+  }
+
+  uint16_t msop_port = (argc > 2) ? (uint16_t)std::stoul(argv[2]) : 6699;
+  uint16_t difop_port = (argc > 3) ? (uint16_t)std::stoul(argv[3]) : 7788;
+
+  PcapReader reader;
+  if (!reader.open(argv[1]))
+  {
+    RS_ERROR << "Failed to open " << argv[1] << RS_REND;
+    return 1;
+  }
+
+  // the first round brings the file into page cache.
+  run(reader, msop_port, difop_port, false);
+
+  for (int i = 0; i < 2; i++)
+  {
+    run(reader, msop_port, difop_port, false);
+    run(reader, msop_port, difop_port, true);
+  }
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <rs_driver/utility/sync_queue.hpp>
+#include <rs_driver/utility/spsc_queue.hpp>
+#include <rs_driver/utility/buffer.hpp>
+#include <rs_driver/common/rs_log.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace robosense::lidar;
+
+//
+// Hand packets from a producer thread to a consumer thread, and back through a free queue,
+// the same way as the recv thread and the handle thread of LidarDriverImpl do.
+//
+
+typedef std::shared_ptr<Buffer> BufferPtr;
+
+static inline uint64_t nowNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result
+{
+  double ops_per_sec;
+  double p50_us;
+  double p99_us;
+};
+
+template <typename Queue>
+Result run(Queue& pkt_queue, Queue& free_queue, size_t num, uint64_t interval_ns)
+{
+  std::vector<uint64_t> latencies;
+  latencies.reserve(num);
+
+  std::thread consumer([&]()
+  {
+    size_t got = 0;
+    while (got < num)
+    {
+      BufferPtr pkt = pkt_queue.popWait(100000);
+      if (pkt.get() == NULL)
+        continue;
+
+      uint64_t ts;
+      memcpy(&ts, pkt->data(), sizeof(ts));
+      latencies.push_back(nowNs() - ts);
+      got++;
+
+      free_queue.push(pkt);
+    }
+  });
+
+  uint64_t start = nowNs();
+  auto next = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num; i++)
+  {
+    if (interval_ns > 0)
+    {
+      next += std::chrono::nanoseconds(interval_ns);
+      std::this_thread::sleep_until(next);
+    }
+
+    BufferPtr pkt = free_queue.pop();
+    if (pkt.get() == NULL)
+      pkt = std::make_shared<Buffer>(1500);
+
+    uint64_t ts = nowNs();
+    memcpy(pkt->data(), &ts, sizeof(ts));
+    pkt->setData(0, sizeof(ts));
+
+    while (pkt_queue.push(pkt) == 0)  // full. only possible with SpscQueue
+      std::this_thread::yield();
+  }
+
+  consumer.join();
+  uint64_t elapsed = nowNs() - start;
+
+  std::sort(latencies.begin(), latencies.end());
+
+  Result r;
+  r.ops_per_sec = (double)num * 1e9 / elapsed;
+  r.p50_us = latencies[latencies.size() / 2] / 1000.0;
+  r.p99_us = latencies[latencies.size() * 99 / 100] / 1000.0;
+  return r;
+}
+
+static void print(const std::string& name, const Result& r)
+{
+  RS_MSG << name << ": " << (uint64_t)r.ops_per_sec << " ops/s, p50 " << r.p50_us << " us, p99 " << r.p99_us
+         << " us" << RS_REND;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t num = 1000000;
+  if (argc > 1)
+  {
+    num = (size_t)std::stoul(argv[1]);
+  }
+
+  // burst: as fast as possible
+  {
+    SyncQueue<BufferPtr> pkt_queue, free_queue;
+    print("SyncQueue burst", run(pkt_queue, free_queue, num, 0));
+  }
+
+  {
+    SpscQueue<BufferPtr> pkt_queue(1024), free_queue(2048);
+    print("SpscQueue burst", run(pkt_queue, free_queue, num, 0));
+  }
+
+  // paced: a packet per 50 us, close to a 128-beam LiDAR
+  size_t paced_num = std::min(num, (size_t)100000);
+
+  {
+    SyncQueue<BufferPtr> pkt_queue, free_queue;
+    print("SyncQueue paced", run(pkt_queue, free_queue, paced_num, 50000));
+  }
+
+  {
+    SpscQueue<BufferPtr> pkt_queue(1024), free_queue(2048);
+    print("SpscQueue paced", run(pkt_queue, free_queue, paced_num, 50000));
+  }
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#include <rs_driver/driver/input/input_pcap.hpp>
+#include <rs_driver/driver/packet_recorder.hpp>
+
+#include <chrono>
+#include <string>
+
+using namespace robosense::lidar;
+
+//
+// Convert a pcap file into a packet record, and compare walking the MSOP/DIFOP packets of both.
+//
+
+static inline uint64_t nowNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char* name, size_t pkts, size_t bytes, uint64_t elapsed, uint32_t sum)
+{
+  RS_MSG << name << pkts << " packets, " 
+         << (uint64_t)((double)pkts * 1e9 / elapsed) << " packets/s, " 
+         << (double)bytes / elapsed << " GB/s" << " (" << sum << ")" << RS_REND;
+}
+
+static void walkPcap(PcapReader& reader, const RSInputParam& param)
+{
+  size_t pkts = 0, bytes = 0;
+  uint32_t sum = 0;
+
+  reader.rewind();
+  uint64_t start = nowNs();
+
+  PcapRecord rec;
+  while (reader.next(rec))
+  {
+    size_t data_off, data_size;
+    if (!InputPcap::parsePacket(rec.link_type, rec, param, data_off, data_size))
+      continue;
+
+    sum += rec.data[data_off + data_size - 1];
+    pkts++;
+    bytes += data_size;
+  }
+
+  report("pcap:   ", pkts, bytes, nowNs() - start, sum);
+}
+
+static void walkRecord(PacketRecordReader& reader)
+{
+  size_t pkts = 0, bytes = 0;
+  uint32_t sum = 0;
+
+  reader.rewind();
+  uint64_t start = nowNs();
+
+  PacketRecord rec;
+  while (reader.next(rec))
+  {
+    sum += rec.data[rec.len - 1];
+    pkts++;
+    bytes += rec.len;
+  }
+
+  report("record: ", pkts, bytes, nowNs() - start, sum);
+}
+
+static bool convert(PcapReader& reader, const RSInputParam& param, const std::string& path, bool lz4)
+{
+  RSRecordParam record_param;
+  record_param.segment_lz4 = lz4;
+
+  PacketRecorder recorder;
+  if (!recorder.open(path, record_param))
+    return false;
+
+  size_t pkts = 0, bytes = 0;
+
+  reader.rewind();
+  uint64_t start = nowNs();
+
+  PcapRecord rec;
+  while (reader.next(rec))
+  {
+    size_t data_off, data_size;
+    if (!InputPcap::parsePacket(rec.link_type, rec, param, data_off, data_size))
+      continue;
+
+    const uint8_t* data = rec.data + data_off;
+    recorder.record(data, data_size, (data[0] == 0xA5), false, 0);
+    pkts++;
+    bytes += data_size;
+  }
+
+  recorder.close();
+  report(lz4 ? "write (lz4): " : "write: ", pkts, bytes, nowNs() - start, 0);
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    RS_MSG << "Usage: record_benchmark <pcap file> <record path> [lz4] [msop port] [difop port]" << RS_REND;
+    return 1;
+  }
+
+  bool lz4 = (argc > 3) && (std::stoul(argv[3]) != 0);
+
+  RSInputParam param;
+  param.msop_port = (argc > 4) ? (uint16_t)std::stoul(argv[4]) : 6699;
+  param.difop_port = (argc > 5) ? (uint16_t)std::stoul(argv[5]) : 7788;
+
+  PcapReader pcap_reader;
+  if (!pcap_reader.open(argv[1]))
+  {
+    RS_ERROR << "Failed to open " << argv[1] << RS_REND;
+    return 1;
+  }
+
+  // the first round brings the file into page cache.
+  walkPcap(pcap_reader, param);
+
+  if (!convert(pcap_reader, param, argv[2], lz4))
+  {
+    RS_ERROR << "Failed to create " << argv[2] << RS_REND;
+    return 1;
+  }
+
+  PacketRecordReader record_reader;
+  if (!record_reader.open(argv[2]))
+  {
+    return 1;
+  }
+
+  for (int i = 0; i < 2; i++)
+  {
+    walkPcap(pcap_reader, param);
+    walkRecord(record_reader);
+  }
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+# - Config file for the  package
+# It defines the following variables
+#  rs_driver_INCLUDE_DIRS - include directories for 
+#  rs_driver_LIBRARIES    - libraries to link against
+#  rs_driver_FOUND        - found flag
+
+if(WIN32)
+  if(CMAKE_SIZEOF_VOID_P EQUAL 8) # 64-bit
+    set(Boost_ARCHITECTURE "-x64")
+  elseif(CMAKE_SIZEOF_VOID_P EQUAL 4) # 32-bit
+    set(Boost_ARCHITECTURE "-x32")
+  endif()
+  set(Boost_USE_STATIC_LIBS ON)
+  set(Boost_USE_MULTITHREADED ON)
+  set(Boost_USE_STATIC_RUNTIME OFF)
+endif(WIN32)
+
+if(${ENABLE_TRANSFORM})
+  add_definitions("-DENABLE_TRANSFORM")
+endif(${ENABLE_TRANSFORM})
+
+if(${ENABLE_PCAP_GZIP})
+  add_definitions("-DENABLE_PCAP_GZIP")
+endif(${ENABLE_PCAP_GZIP})
+
+if(${ENABLE_PCAP_ZSTD})
+  add_definitions("-DENABLE_PCAP_ZSTD")
+endif(${ENABLE_PCAP_ZSTD})
+
+if(${ENABLE_RECORD_LZ4})
+  add_definitions("-DENABLE_RECORD_LZ4")
+endif(${ENABLE_RECORD_LZ4})
+
+set(rs_driver_INCLUDE_DIRS "/root/repo/src;/usr/local/rs_driver/include")
+set(RS_DRIVER_INCLUDE_DIRS "/root/repo/src;/usr/local/rs_driver/include")
+
+set(rs_driver_LIBRARIES "pthread;/usr/lib/x86_64-linux-gnu/libz.so;/root/miniconda/lib/libzstd.so;/root/miniconda/lib/liblz4.so")
+set(RS_DRIVER_LIBRARIES "pthread;/usr/lib/x86_64-linux-gnu/libz.so;/root/miniconda/lib/libzstd.so;/root/miniconda/lib/liblz4.so")
+
+set(rs_driver_FOUND true)
+set(RS_DRIVER_FOUND true)
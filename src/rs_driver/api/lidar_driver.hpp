@@ -34,6 +34,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rs_driver/driver/lidar_driver_impl.hpp>
 #include <rs_driver/msg/packet.hpp>
+#include <rs_driver/msg/packet_view.hpp>
 
 namespace robosense
 {
@@ -79,6 +80,28 @@ public:
     driver_ptr_->regPacketCallback(cb_put_pkt);
   }
 
+  /**
+   * @brief Register the packet view callback function to driver. It is called with every msop/difop packet, as a view
+   *        on the packet buffer of the driver, without the copy into Packet. The view is valid only during the call.
+   *        To keep the packet longer, take a PacketHandle with PacketView::hold()
+   * @param callback The callback function
+   */
+  inline void regPacketViewCallback(const std::function<void(const PacketView&)>& cb_put_pkt_view)
+  {
+    driver_ptr_->regPacketViewCallback(cb_put_pkt_view);
+  }
+
+  /**
+   * @brief Register the packet batch callback function to driver. It is called with the msop/difop packets of a frame
+   *        at once, when the next frame begins. The views are valid only during the call.
+   *        A frame that takes more than half of the packet pool is delivered in parts
+   * @param callback The callback function
+   */
+  inline void regPacketBatchCallback(const std::function<void(const std::vector<PacketView>&)>& cb_put_pkt_batch)
+  {
+    driver_ptr_->regPacketBatchCallback(cb_put_pkt_batch);
+  }
+
   /**
    * @brief Register the exception message callback function to driver. When error occurs, this function will be called
    * @param callback The callback function
@@ -109,7 +132,8 @@ public:
   }
 
   /**
-   * @brief Decode lidar msop/difop messages
+   * @brief Decode lidar msop/difop messages. It may be called from several threads,
+   *        except with RSDriverParam::decode_inline, which decodes in the calling thread.
    * @param pkt_msg The lidar msop/difop packet
    */
   inline void decodePacket(const Packet& pkt)
@@ -117,6 +141,39 @@ public:
     driver_ptr_->decodePacket(pkt);
   }
 
+#ifndef DISABLE_PCAP_PARSE
+  /**
+   * @brief Decode the pcap file on a pool of threads, for offline processing. Call it after init(), instead of start().
+   *        Point clouds are delivered in order on the calling thread. It returns after the file is decoded.
+   * @param thread_num Number of decoding threads. 0 means the number of CPU cores
+   * @return If successful, return true; else return false
+   */
+  inline bool decodePcap(uint32_t thread_num = 0)
+  {
+    return driver_ptr_->decodePcap(thread_num);
+  }
+#endif
+
+  /**
+   * @brief Record MSOP/DIFOP packets into a packet record, which can be replayed with InputType::RECORD_FILE. 
+   *        It may be called before or after start(). Recording a new record stops the current one.
+   * @param path Path of the record. Files <path>.idx, <path>.00000, <path>.00001, ... are created
+   * @param param Size and compression of segment files
+   * @return If successful, return true; else return false
+   */
+  inline bool startRecord(const std::string& path, const RSRecordParam& param = RSRecordParam())
+  {
+    return driver_ptr_->startRecord(path, param);
+  }
+
+  /**
+   * @brief Stop recording, and seal the last segment file
+   */
+  inline void stopRecord()
+  {
+    driver_ptr_->stopRecord();
+  }
+
   /**
    * @brief Get the current lidar temperature
    * @param temp The variable to store lidar temperature
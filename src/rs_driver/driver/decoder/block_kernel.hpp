@@ -0,0 +1,467 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/decoder/trigon.hpp>
+
+#include <cstdint>
+#include <string>
+
+#if !defined(DISABLE_SIMD_DECODE)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RS_BLOCK_KERNEL_X86
+#include <immintrin.h>
+#define RS_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RS_BLOCK_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Decode the channels of a mechanical LiDAR block into xyz, a block at a time.
+//
+// For each channel:
+//   distance = ntohs(channel.distance) * DISTANCE_RES
+//   angle_horiz = block_az + (int32_t)((float)block_az_diff * CHAN_AZIS[chan])
+//   angle_horiz_final = angle_horiz + horiz_angles[chan]
+//   x =  distance * vert_coss[chan] * COS(horiz_final) + RX * COS(horiz)
+//   y = -distance * vert_coss[chan] * SIN(horiz_final) - RX * SIN(horiz)
+//   z =  distance * vert_sins[chan] + RZ
+//
+// The SIMD kernels do the same float operations in the same order, and don't fuse multiply-add,
+// so their results are the same as the scalar one.
+//
+
+struct BlockKernelParam
+{
+  float dist_res;
+  float dist_min;
+  float dist_max;
+  float rx;
+  float rz;
+  const float* sins;  // indexed by angle, in [Trigon::ANGLE_MIN, Trigon::ANGLE_MAX)
+  const float* coss;
+};
+
+struct BlockKernelIn
+{
+  const uint8_t* chans;  // RSChannel array. 3 bytes each, distance in big endian, and intensity
+  uint16_t num;
+  int32_t block_az;
+  int32_t block_az_diff;
+  const float* chan_azis;
+  const float* vert_sins;  // sin/cos of vertical angles, per channel
+  const float* vert_coss;
+  const int32_t* horiz_angles;
+};
+
+struct BlockKernelOut
+{
+  constexpr static uint16_t MAX_CHANS = 128;
+
+  float x[MAX_CHANS];
+  float y[MAX_CHANS];
+  float z[MAX_CHANS];
+  int32_t angle_horiz[MAX_CHANS];  // angle_horiz_final, to check with the scan section
+  uint8_t valid[MAX_CHANS];        // distance in the distance section
+};
+
+// decode in.num channels into out, from out[off]
+typedef void (*BlockKernelFunc)(const BlockKernelParam& param, const BlockKernelIn& in, 
+    BlockKernelOut& out, uint16_t off);
+
+enum BlockKernelType
+{
+  BLOCK_KERNEL_SCALAR = 0,
+  BLOCK_KERNEL_SSE41,
+  BLOCK_KERNEL_AVX2,
+  BLOCK_KERNEL_NEON
+};
+
+inline void decodeChanScalar(const BlockKernelParam& param, const BlockKernelIn& in,
+    uint16_t chan, BlockKernelOut& out, uint16_t off)
+{
+  const uint8_t* c = in.chans + chan * 3;
+  float distance = (uint16_t)((c[0] << 8) | c[1]) * param.dist_res;
+
+  int32_t angle_horiz = in.block_az + (int32_t)((float)in.block_az_diff * in.chan_azis[chan]);
+  int32_t angle_horiz_final = angle_horiz + in.horiz_angles[chan];
+
+  int32_t hf = Trigon::clamp(angle_horiz_final);
+  int32_t h = Trigon::clamp(angle_horiz);
+
+  uint16_t i = off + chan;
+  out.x[i] =  distance * in.vert_coss[chan] * param.coss[hf] + param.rx * param.coss[h];
+  out.y[i] = -distance * in.vert_coss[chan] * param.sins[hf] - param.rx * param.sins[h];
+  out.z[i] =  distance * in.vert_sins[chan] + param.rz;
+  out.angle_horiz[i] = angle_horiz_final;
+  out.valid[i] = ((param.dist_min <= distance) && (distance <= param.dist_max));
+}
+
+inline void decodeBlockScalar(const BlockKernelParam& param, const BlockKernelIn& in, 
+    BlockKernelOut& out, uint16_t off)
+{
+  for (uint16_t chan = 0; chan < in.num; chan++)
+  {
+    decodeChanScalar(param, in, chan, out, off);
+  }
+}
+
+#ifdef RS_BLOCK_KERNEL_X86
+
+//
+// distances of 8 channels (24 bytes), swapped to 8 x uint16.
+// Two overlapped 16-byte loads, so as not to read beyond the 24 bytes.
+//
+RS_TARGET("sse4.1")
+inline __m128i loadDist8(const uint8_t* p)
+{
+  __m128i a = _mm_loadu_si128((const __m128i*)p);
+  __m128i b = _mm_loadu_si128((const __m128i*)(p + 8));
+
+  const __m128i sa = _mm_setr_epi8(1, 0, 4, 3, 7, 6, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i sb = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 5, 4, 8, 7, 11, 10, 14, 13);
+
+  return _mm_or_si128(_mm_shuffle_epi8(a, sa), _mm_shuffle_epi8(b, sb));
+}
+
+RS_TARGET("sse4.1")
+inline __m128i clampAngle4(__m128i a)
+{
+  const __m128i lo = _mm_set1_epi32(Trigon::ANGLE_MIN - 1);
+  const __m128i hi = _mm_set1_epi32(Trigon::ANGLE_MAX);
+  __m128i in = _mm_and_si128(_mm_cmpgt_epi32(a, lo), _mm_cmpgt_epi32(hi, a));
+  return _mm_and_si128(a, in);
+}
+
+RS_TARGET("sse4.1")
+inline __m128 gather4(const float* table, __m128i idx)
+{
+  alignas(16) int32_t i[4];
+  _mm_store_si128((__m128i*)i, idx);
+  return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+RS_TARGET("sse4.1")
+inline void decode4Sse41(const BlockKernelParam& param, const BlockKernelIn& in,
+    uint16_t chan, __m128i dist_u32, BlockKernelOut& out, uint16_t off)
+{
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 rx = _mm_set1_ps(param.rx);
+
+  __m128 dist = _mm_mul_ps(_mm_cvtepi32_ps(dist_u32), _mm_set1_ps(param.dist_res));
+  __m128 ok = _mm_and_ps(_mm_cmple_ps(_mm_set1_ps(param.dist_min), dist), 
+      _mm_cmple_ps(dist, _mm_set1_ps(param.dist_max)));
+
+  __m128 azi = _mm_mul_ps(_mm_set1_ps((float)in.block_az_diff), _mm_loadu_ps(in.chan_azis + chan));
+  __m128i horiz = _mm_add_epi32(_mm_set1_epi32(in.block_az), _mm_cvttps_epi32(azi));
+  __m128i horiz_final = _mm_add_epi32(horiz, _mm_loadu_si128((const __m128i*)(in.horiz_angles + chan)));
+
+  __m128i hf = clampAngle4(horiz_final);
+  __m128i h = clampAngle4(horiz);
+
+  __m128 cos_v = _mm_loadu_ps(in.vert_coss + chan);
+  __m128 dcv = _mm_mul_ps(dist, cos_v);
+  __m128 ndcv = _mm_mul_ps(_mm_xor_ps(dist, sign), cos_v);
+
+  __m128 x = _mm_add_ps(_mm_mul_ps(dcv, gather4(param.coss, hf)), _mm_mul_ps(rx, gather4(param.coss, h)));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(ndcv, gather4(param.sins, hf)), _mm_mul_ps(rx, gather4(param.sins, h)));
+  __m128 z = _mm_add_ps(_mm_mul_ps(dist, _mm_loadu_ps(in.vert_sins + chan)), _mm_set1_ps(param.rz));
+
+  uint16_t i = off + chan;
+  _mm_storeu_ps(out.x + i, x);
+  _mm_storeu_ps(out.y + i, y);
+  _mm_storeu_ps(out.z + i, z);
+  _mm_storeu_si128((__m128i*)(out.angle_horiz + i), horiz_final);
+
+  int mask = _mm_movemask_ps(ok);
+  for (int k = 0; k < 4; k++)
+  {
+    out.valid[i + k] = (mask >> k) & 1;
+  }
+}
+
+RS_TARGET("sse4.1")
+inline void decodeBlockSse41(const BlockKernelParam& param, const BlockKernelIn& in, 
+    BlockKernelOut& out, uint16_t off)
+{
+  uint16_t chan = 0;
+  for (; chan + 8 <= in.num; chan += 8)
+  {
+    __m128i dist = loadDist8(in.chans + chan * 3);
+    decode4Sse41(param, in, chan, _mm_cvtepu16_epi32(dist), out, off);
+    decode4Sse41(param, in, chan + 4, _mm_cvtepu16_epi32(_mm_srli_si128(dist, 8)), out, off);
+  }
+
+  for (; chan < in.num; chan++)
+  {
+    decodeChanScalar(param, in, chan, out, off);
+  }
+}
+
+RS_TARGET("avx2")
+inline __m256i clampAngle8(__m256i a)
+{
+  const __m256i lo = _mm256_set1_epi32(Trigon::ANGLE_MIN - 1);
+  const __m256i hi = _mm256_set1_epi32(Trigon::ANGLE_MAX);
+  __m256i in = _mm256_and_si256(_mm256_cmpgt_epi32(a, lo), _mm256_cmpgt_epi32(hi, a));
+  return _mm256_and_si256(a, in);
+}
+
+RS_TARGET("avx2")
+inline void decodeBlockAvx2(const BlockKernelParam& param, const BlockKernelIn& in, 
+    BlockKernelOut& out, uint16_t off)
+{
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 res = _mm256_set1_ps(param.dist_res);
+  const __m256 dist_min = _mm256_set1_ps(param.dist_min);
+  const __m256 dist_max = _mm256_set1_ps(param.dist_max);
+  const __m256 rx = _mm256_set1_ps(param.rx);
+  const __m256 rz = _mm256_set1_ps(param.rz);
+  const __m256 az_diff = _mm256_set1_ps((float)in.block_az_diff);
+  const __m256i az = _mm256_set1_epi32(in.block_az);
+
+  uint16_t chan = 0;
+  for (; chan + 8 <= in.num; chan += 8)
+  {
+    __m256i dist_u32 = _mm256_cvtepu16_epi32(loadDist8(in.chans + chan * 3));
+    __m256 dist = _mm256_mul_ps(_mm256_cvtepi32_ps(dist_u32), res);
+    __m256 ok = _mm256_and_ps(_mm256_cmp_ps(dist_min, dist, _CMP_LE_OQ), 
+        _mm256_cmp_ps(dist, dist_max, _CMP_LE_OQ));
+
+    __m256 azi = _mm256_mul_ps(az_diff, _mm256_loadu_ps(in.chan_azis + chan));
+    __m256i horiz = _mm256_add_epi32(az, _mm256_cvttps_epi32(azi));
+    __m256i horiz_final = 
+      _mm256_add_epi32(horiz, _mm256_loadu_si256((const __m256i*)(in.horiz_angles + chan)));
+
+    __m256i hf = clampAngle8(horiz_final);
+    __m256i h = clampAngle8(horiz);
+
+    __m256 cos_v = _mm256_loadu_ps(in.vert_coss + chan);
+    __m256 dcv = _mm256_mul_ps(dist, cos_v);
+    __m256 ndcv = _mm256_mul_ps(_mm256_xor_ps(dist, sign), cos_v);
+
+    __m256 x = _mm256_add_ps(_mm256_mul_ps(dcv, _mm256_i32gather_ps(param.coss, hf, 4)), 
+        _mm256_mul_ps(rx, _mm256_i32gather_ps(param.coss, h, 4)));
+    __m256 y = _mm256_sub_ps(_mm256_mul_ps(ndcv, _mm256_i32gather_ps(param.sins, hf, 4)), 
+        _mm256_mul_ps(rx, _mm256_i32gather_ps(param.sins, h, 4)));
+    __m256 z = _mm256_add_ps(_mm256_mul_ps(dist, _mm256_loadu_ps(in.vert_sins + chan)), rz);
+
+    uint16_t i = off + chan;
+    _mm256_storeu_ps(out.x + i, x);
+    _mm256_storeu_ps(out.y + i, y);
+    _mm256_storeu_ps(out.z + i, z);
+    _mm256_storeu_si256((__m256i*)(out.angle_horiz + i), horiz_final);
+
+    int mask = _mm256_movemask_ps(ok);
+    for (int k = 0; k < 8; k++)
+    {
+      out.valid[i + k] = (mask >> k) & 1;
+    }
+  }
+
+  for (; chan < in.num; chan++)
+  {
+    decodeChanScalar(param, in, chan, out, off);
+  }
+}
+
+#endif
+
+#ifdef RS_BLOCK_KERNEL_NEON
+
+inline int32x4_t clampAngle4(int32x4_t a)
+{
+  uint32x4_t in = vandq_u32(vcgeq_s32(a, vdupq_n_s32(Trigon::ANGLE_MIN)), 
+      vcltq_s32(a, vdupq_n_s32(Trigon::ANGLE_MAX)));
+  return vandq_s32(a, vreinterpretq_s32_u32(in));
+}
+
+inline float32x4_t gather4(const float* table, int32x4_t idx)
+{
+  int32_t i[4];
+  vst1q_s32(i, idx);
+  float f[4] = {table[i[0]], table[i[1]], table[i[2]], table[i[3]]};
+  return vld1q_f32(f);
+}
+
+inline void decode4Neon(const BlockKernelParam& param, const BlockKernelIn& in,
+    uint16_t chan, uint32x4_t dist_u32, BlockKernelOut& out, uint16_t off)
+{
+  const float32x4_t rx = vdupq_n_f32(param.rx);
+
+  float32x4_t dist = vmulq_f32(vcvtq_f32_u32(dist_u32), vdupq_n_f32(param.dist_res));
+  uint32x4_t ok = vandq_u32(vcleq_f32(vdupq_n_f32(param.dist_min), dist), 
+      vcleq_f32(dist, vdupq_n_f32(param.dist_max)));
+
+  float32x4_t azi = vmulq_f32(vdupq_n_f32((float)in.block_az_diff), vld1q_f32(in.chan_azis + chan));
+  int32x4_t horiz = vaddq_s32(vdupq_n_s32(in.block_az), vcvtq_s32_f32(azi));
+  int32x4_t horiz_final = vaddq_s32(horiz, vld1q_s32(in.horiz_angles + chan));
+
+  int32x4_t hf = clampAngle4(horiz_final);
+  int32x4_t h = clampAngle4(horiz);
+
+  float32x4_t cos_v = vld1q_f32(in.vert_coss + chan);
+  float32x4_t dcv = vmulq_f32(dist, cos_v);
+  float32x4_t ndcv = vmulq_f32(vnegq_f32(dist), cos_v);
+
+  float32x4_t x = vaddq_f32(vmulq_f32(dcv, gather4(param.coss, hf)), vmulq_f32(rx, gather4(param.coss, h)));
+  float32x4_t y = vsubq_f32(vmulq_f32(ndcv, gather4(param.sins, hf)), vmulq_f32(rx, gather4(param.sins, h)));
+  float32x4_t z = vaddq_f32(vmulq_f32(dist, vld1q_f32(in.vert_sins + chan)), vdupq_n_f32(param.rz));
+
+  uint16_t i = off + chan;
+  vst1q_f32(out.x + i, x);
+  vst1q_f32(out.y + i, y);
+  vst1q_f32(out.z + i, z);
+  vst1q_s32(out.angle_horiz + i, horiz_final);
+
+  uint32_t mask[4];
+  vst1q_u32(mask, ok);
+  for (int k = 0; k < 4; k++)
+  {
+    out.valid[i + k] = (mask[k] != 0);
+  }
+}
+
+inline void decodeBlockNeon(const BlockKernelParam& param, const BlockKernelIn& in, 
+    BlockKernelOut& out, uint16_t off)
+{
+  uint16_t chan = 0;
+  for (; chan + 8 <= in.num; chan += 8)
+  {
+    // deinterleave 8 channels: distance high byte, low byte, and intensity
+    uint8x8x3_t c = vld3_u8(in.chans + chan * 3);
+    uint16x8_t dist = vorrq_u16(vshll_n_u8(c.val[0], 8), vmovl_u8(c.val[1]));
+
+    decode4Neon(param, in, chan, vmovl_u16(vget_low_u16(dist)), out, off);
+    decode4Neon(param, in, chan + 4, vmovl_u16(vget_high_u16(dist)), out, off);
+  }
+
+  for (; chan < in.num; chan++)
+  {
+    decodeChanScalar(param, in, chan, out, off);
+  }
+}
+
+#endif
+
+inline bool blockKernelSupported(BlockKernelType type)
+{
+  switch (type)
+  {
+    case BLOCK_KERNEL_SCALAR:
+      return true;
+
+#ifdef RS_BLOCK_KERNEL_X86
+    case BLOCK_KERNEL_SSE41:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.1");
+
+    case BLOCK_KERNEL_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+
+#ifdef RS_BLOCK_KERNEL_NEON
+    case BLOCK_KERNEL_NEON:
+      return true;
+#endif
+
+    default:
+      return false;
+  }
+}
+
+inline BlockKernelFunc blockKernel(BlockKernelType type)
+{
+  if (!blockKernelSupported(type))
+  {
+    return NULL;
+  }
+
+  switch (type)
+  {
+#ifdef RS_BLOCK_KERNEL_X86
+    case BLOCK_KERNEL_SSE41:
+      return decodeBlockSse41;
+    case BLOCK_KERNEL_AVX2:
+      return decodeBlockAvx2;
+#endif
+
+#ifdef RS_BLOCK_KERNEL_NEON
+    case BLOCK_KERNEL_NEON:
+      return decodeBlockNeon;
+#endif
+
+    case BLOCK_KERNEL_SCALAR:
+    default:
+      return decodeBlockScalar;
+  }
+}
+
+inline BlockKernelType blockKernelBest()
+{
+  BlockKernelType types[] = {BLOCK_KERNEL_AVX2, BLOCK_KERNEL_SSE41, BLOCK_KERNEL_NEON};
+  for (auto type : types)
+  {
+    if (blockKernelSupported(type))
+      return type;
+  }
+
+  return BLOCK_KERNEL_SCALAR;
+}
+
+inline std::string blockKernelToStr(BlockKernelType type)
+{
+  switch (type)
+  {
+    case BLOCK_KERNEL_SSE41:
+      return "SSE4.1";
+    case BLOCK_KERNEL_AVX2:
+      return "AVX2";
+    case BLOCK_KERNEL_NEON:
+      return "NEON";
+    case BLOCK_KERNEL_SCALAR:
+    default:
+      return "SCALAR";
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -33,6 +33,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include <rs_driver/common/rs_common.hpp>
+#include <rs_driver/driver/decoder/trigon.hpp>
 
 #include <fstream>
 #include <cmath>
@@ -60,6 +61,7 @@ public:
     vert_angles_.resize(chan_num_);
     horiz_angles_.resize(chan_num_);
     user_chans_.resize(chan_num_);
+    genVertTrigon(vert_angles_, vert_sins_, vert_coss_);
   }
   
   int loadFromFile(const std::string& angle_path)
@@ -78,6 +80,7 @@ public:
     vert_angles_.swap(vert_angles);
     horiz_angles_.swap(horiz_angles);
     genUserChan(vert_angles_, user_chans_);
+    genVertTrigon(vert_angles_, vert_sins_, vert_coss_);
     return 0;
   }
 
@@ -94,6 +97,7 @@ public:
     vert_angles_.swap(vert_angles);
     horiz_angles_.swap(horiz_angles);
     genUserChan(vert_angles_, user_chans_);
+    genVertTrigon(vert_angles_, vert_sins_, vert_coss_);
     return 0;
   }
 
@@ -112,6 +116,25 @@ public:
     return vert_angles_[chan];
   }
 
+  //
+  // per-channel tables in decode order. 
+  // They are rebuilt when the angles are loaded, so get them again after that.
+  //
+  const float* vertSins() const
+  {
+    return vert_sins_.data();
+  }
+
+  const float* vertCoss() const
+  {
+    return vert_coss_.data();
+  }
+
+  const int32_t* horizAngles() const
+  {
+    return horiz_angles_.data();
+  }
+
   void print()
   {
     std::cout << "---------------------" << std::endl
@@ -131,6 +154,21 @@ public:
 private:
 #endif
 
+  static
+  void genVertTrigon(const std::vector<int32_t>& vert_angles, 
+      std::vector<float>& vert_sins, std::vector<float>& vert_coss)
+  {
+    vert_sins.resize(vert_angles.size());
+    vert_coss.resize(vert_angles.size());
+
+    for (size_t i = 0; i < vert_angles.size(); i++)
+    {
+      int32_t angle = Trigon::clamp(vert_angles[i]);
+      vert_sins[i] = Trigon::calcSin(angle);
+      vert_coss[i] = Trigon::calcCos(angle);
+    }
+  }
+
   static
   void genUserChan(const std::vector<int32_t>& vert_angles, std::vector<uint16_t>& user_chans)
   {
@@ -233,6 +271,8 @@ private:
   std::vector<int32_t> vert_angles_;
   std::vector<int32_t> horiz_angles_;
   std::vector<uint16_t> user_chans_;
+  std::vector<float> vert_sins_;
+  std::vector<float> vert_coss_;
 };
 
 }  // namespace lidar
@@ -256,6 +256,7 @@ public:
 
   virtual void decodeDifopPkt(const uint8_t* pkt, size_t size) = 0;
   virtual bool decodeMsopPkt(const uint8_t* pkt, size_t size) = 0;
+  virtual size_t pointsPerFrame();
   virtual ~Decoder() = default;
 
   void processDifopPkt(const uint8_t* pkt, size_t size);
@@ -268,6 +269,7 @@ public:
   bool getDeviceStatus(DeviceStatus& status);
   double getPacketDuration();
   void enableWritePktTs(bool value);
+  void setHostTs(uint64_t ts);
   double prevPktTs();
   void transformPoint(float& x, float& y, float& z);
 
@@ -282,12 +284,14 @@ protected:
 #endif
 
   double cloudTs();
+  inline uint64_t hostTime();
 
   RSDecoderConstParam const_param_; // const param
   RSDecoderParam param_; // user param
   std::function<void(uint16_t, double)> cb_split_frame_;
   std::function<void(const Error&)> cb_excep_;
   bool write_pkt_ts_;
+  uint64_t host_ts_; // arrival time of the packet to decode (us), stamped by the kernel. 0 if unknown
 
 #ifdef ENABLE_TRANSFORM
   Eigen::Matrix4d trans_;
@@ -298,6 +302,7 @@ protected:
 #define COS(angle) this->trigon_.cos(angle)
 
   double packet_duration_;
+  uint32_t pkts_per_frame_; // MSOP packets of a single-echo frame. 0 if unknown
   DistanceSection distance_section_; // invalid section of distance
 
   RSEchoMode echo_mode_; // echo mode (defined by return mode)
@@ -325,7 +330,9 @@ inline Decoder<T_PointCloud>::Decoder(const RSDecoderConstParam& const_param, co
   : const_param_(const_param)
   , param_(param)
   , write_pkt_ts_(false)
+  , host_ts_(0)
   , packet_duration_(0)
+  , pkts_per_frame_(0)
   , distance_section_(const_param.DISTANCE_MIN, const_param.DISTANCE_MAX, param.min_distance, param.max_distance)
   , echo_mode_(ECHO_SINGLE)
   , temperature_(0.0)
@@ -350,6 +357,22 @@ inline void Decoder<T_PointCloud>::enableWritePktTs(bool value)
   write_pkt_ts_ = value;
 }
 
+template <typename T_PointCloud>
+inline void Decoder<T_PointCloud>::setHostTs(uint64_t ts)
+{
+  host_ts_ = ts;
+}
+
+//
+// host time of the packet, if use_lidar_clock is false. It is the arrival time stamped by the kernel,
+// or the time it is decoded if there is no such stamp.
+//
+template <typename T_PointCloud>
+inline uint64_t Decoder<T_PointCloud>::hostTime()
+{
+  return (host_ts_ != 0) ? host_ts_ : getTimeHost();
+}
+
 template <typename T_PointCloud>
 inline float Decoder<T_PointCloud>::getTemperature()
 {
@@ -370,6 +393,17 @@ inline bool Decoder<T_PointCloud>::getDeviceStatus(DeviceStatus& status)
   return true;
 }
 
+//
+// Expected points of a frame, by the LiDAR geometry. 0 if unknown.
+// It is used to reserve point clouds, so a little more than real is OK.
+//
+template <typename T_PointCloud>
+inline size_t Decoder<T_PointCloud>::pointsPerFrame()
+{
+  size_t pkts = (echo_mode_ == RSEchoMode::ECHO_DUAL) ? ((size_t)pkts_per_frame_ << 1) : pkts_per_frame_;
+  return pkts * const_param_.BLOCKS_PER_PKT * const_param_.CHANNELS_PER_BLOCK;
+}
+
 template <typename T_PointCloud>
 inline double Decoder<T_PointCloud>::getPacketDuration()
 {
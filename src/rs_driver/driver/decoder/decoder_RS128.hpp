@@ -220,7 +220,7 @@ inline bool DecoderRS128<T_PointCloud>::internDecodeMsopPkt(const uint8_t* packe
   }
   else
   {
-    uint64_t ts = getTimeHost();
+    uint64_t ts = this->hostTime();
 
     // roll back to first block to approach lidar ts as near as possible.
     pkt_ts = ts * 1e-6 - this->getPacketDuration();
@@ -261,49 +261,8 @@ inline bool DecoderRS128<T_PointCloud>::internDecodeMsopPkt(const uint8_t* packe
       ret = true;
     }
 
-    for (uint16_t chan = 0; chan < this->const_param_.CHANNELS_PER_BLOCK; chan++)
-    {
-      const RSChannel& channel = block.channels[chan]; 
-      double chan_ts = block_ts + this->mech_const_param_.CHAN_TSS[chan];
-      int32_t angle_horiz = block_az + 
-        (int32_t)((float)block_az_diff * this->mech_const_param_.CHAN_AZIS[chan]);
-
-      int32_t angle_vert = this->chan_angles_.vertAdjust(chan);
-      int32_t angle_horiz_final = this->chan_angles_.horizAdjust(chan, angle_horiz);
-      float distance = ntohs(channel.distance) * this->const_param_.DISTANCE_RES;
-
-      if (this->distance_section_.in(distance) && this->scan_section_.in(angle_horiz_final))
-      {
-        float x =  distance * COS(angle_vert) * COS(angle_horiz_final) + this->mech_const_param_.RX * COS(angle_horiz);
-        float y = -distance * COS(angle_vert) * SIN(angle_horiz_final) - this->mech_const_param_.RX * SIN(angle_horiz);
-        float z =  distance * SIN(angle_vert) + this->mech_const_param_.RZ;
-        this->transformPoint(x, y, z);
-
-        typename T_PointCloud::PointT point;
-        setX(point, x);
-        setY(point, y);
-        setZ(point, z);
-        setIntensity(point, channel.intensity);
-        setTimestamp(point, chan_ts);
-        setRing(point, this->chan_angles_.toUserChan(chan));
-
-        this->point_cloud_->points.emplace_back(point);
-      }
-      else if (!this->param_.dense_points)
-      {
-        typename T_PointCloud::PointT point;
-        setX(point, NAN);
-        setY(point, NAN);
-        setZ(point, NAN);
-        setIntensity(point, 0);
-        setTimestamp(point, chan_ts);
-        setRing(point, this->chan_angles_.toUserChan(chan));
-
-        this->point_cloud_->points.emplace_back(point);
-      }
-
-      this->prev_point_ts_ = chan_ts;
-    }
+    this->decodeBlock(block.channels, this->const_param_.CHANNELS_PER_BLOCK, 
+        block_az, block_az_diff, block_ts);
   }
 
   this->prev_pkt_ts_ = pkt_ts;
@@ -185,6 +185,7 @@ inline DecoderRSM1<T_PointCloud>::DecoderRSM1(const RSDecoderParam& param)
   : Decoder<T_PointCloud>(getConstParam(), param)
 {
   this->packet_duration_ = FRAME_DURATION / SINGLE_PKT_NUM;
+  this->pkts_per_frame_ = SINGLE_PKT_NUM;
   this->angles_ready_ = true;
 }
 
@@ -236,10 +237,10 @@ inline bool DecoderRSM1<T_PointCloud>::decodeMsopPkt(const uint8_t* packet, size
   }
   else
   {
-    uint64_t ts = getTimeHost();
+    uint64_t ts = this->hostTime();
 
     // roll back to first block to approach lidar ts as near as possible.
-    pkt_ts = getTimeHost() * 1e-6 - this->getPacketDuration();
+    pkt_ts = ts * 1e-6 - this->getPacketDuration();
 
     if (this->write_pkt_ts_)
     {
@@ -123,6 +123,7 @@ inline DecoderRSM1_Jumbo<T_PointCloud>::DecoderRSM1_Jumbo(const RSDecoderParam&
   : Decoder<T_PointCloud>(getConstParam(), param)
 {
   this->packet_duration_ = FRAME_DURATION / SINGLE_PKT_NUM;
+  this->pkts_per_frame_ = SINGLE_PKT_NUM;
   this->angles_ready_ = true;
 }
 
@@ -186,10 +187,10 @@ inline bool DecoderRSM1_Jumbo<T_PointCloud>::internDecodeMsopPkt(const uint8_t*
   }
   else
   {
-    uint64_t ts = getTimeHost();
+    uint64_t ts = this->hostTime();
 
     // roll back to first block to approach lidar ts as near as possible.
-    pkt_ts = getTimeHost() * 1e-6 - this->getPacketDuration();
+    pkt_ts = ts * 1e-6 - this->getPacketDuration();
 
     if (this->write_pkt_ts_)
     {
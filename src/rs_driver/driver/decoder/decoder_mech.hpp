@@ -35,6 +35,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/driver/decoder/split_strategy.hpp>
 #include <rs_driver/driver/decoder/block_iterator.hpp>
 #include <rs_driver/driver/decoder/chan_angles.hpp>
+#include <rs_driver/driver/decoder/block_kernel.hpp>
 
 namespace robosense
 {
@@ -69,6 +70,19 @@ typedef struct
   RSCalibrationAngle horiz_angle_cali[32];
 } AdapterDifopPkt;
 
+//
+// Features of output points, known at init time.
+// DecoderMech picks an emitBlock() instantiation by them, so as to
+// keep the per-point loop free of these checks.
+//
+template <bool DENSE, bool TRANSFORM, bool CROP_ANGLE>
+struct DecodePolicy
+{
+  constexpr static bool DENSE_POINTS = DENSE;     // discard invalid points, or keep them as NAN points
+  constexpr static bool TRANSFORM_POINTS = TRANSFORM; // apply transform_param to points
+  constexpr static bool CROP_BY_ANGLE = CROP_ANGLE;   // discard points out of (start_angle, end_angle)
+};
+
 template <typename T_PointCloud>
 class DecoderMech : public Decoder<T_PointCloud>
 {
@@ -80,6 +94,7 @@ public:
 
   explicit DecoderMech(const RSDecoderMechConstParam& const_param, const RSDecoderParam& param);
 
+  virtual size_t pointsPerFrame();
   void print();
 
 #ifndef UNIT_TEST
@@ -89,6 +104,20 @@ protected:
   template <typename T_Difop>
   void decodeDifopCommon(const T_Difop& pkt);
 
+  void decodeBlock(const RSChannel* channels, uint16_t chan_num, 
+      int32_t block_az, int32_t block_az_diff, double block_ts);
+
+  template <typename T_Policy>
+  void emitBlock(const RSChannel* channels, uint16_t chan_num, double block_ts);
+
+  typedef void (DecoderMech::*EmitBlockFunc)(const RSChannel* channels, uint16_t chan_num, double block_ts);
+
+  void selectEmitBlock();
+  template <bool DENSE>
+  EmitBlockFunc selectEmitBlock(bool transform, bool crop_angle);
+  template <bool DENSE, bool TRANSFORM>
+  EmitBlockFunc selectEmitBlock(bool crop_angle);
+
   RSDecoderMechConstParam mech_const_param_; // const param 
   ChanAngles chan_angles_; // vert_angles/horiz_angles adjustment
   AzimuthSection scan_section_; // valid azimuth section
@@ -99,6 +128,12 @@ protected:
   uint16_t split_blks_per_frame_; // blocks in msop pkt per frame/round. 
   uint16_t block_az_diff_; // azimuth difference between adjacent blocks.
   double fov_blind_ts_diff_; // timestamp difference across blind section(defined by fov)
+
+  BlockKernelType kernel_type_; // SIMD kernel to decode blocks
+  BlockKernelFunc kernel_;
+  BlockKernelParam kernel_param_;
+  BlockKernelOut kernel_out_; // xyz of channels in current block
+  EmitBlockFunc emit_block_; // emit points of current block
 };
 
 template <typename T_PointCloud>
@@ -113,10 +148,22 @@ inline DecoderMech<T_PointCloud>::DecoderMech(const RSDecoderMechConstParam& con
   , split_blks_per_frame_(blks_per_frame_)
   , block_az_diff_(20)
   , fov_blind_ts_diff_(0.0)
+  , kernel_type_(blockKernelBest())
+  , kernel_(blockKernel(kernel_type_))
 {
   this->packet_duration_ = 
     this->mech_const_param_.BLOCK_DURATION * this->const_param_.BLOCKS_PER_PKT;
 
+  kernel_param_.dist_res = this->const_param_.DISTANCE_RES;
+  kernel_param_.dist_min = this->distance_section_.lower();
+  kernel_param_.dist_max = this->distance_section_.upper();
+  kernel_param_.rx = this->mech_const_param_.RX;
+  kernel_param_.rz = this->mech_const_param_.RZ;
+  kernel_param_.sins = this->trigon_.sinTable();
+  kernel_param_.coss = this->trigon_.cosTable();
+
+  selectEmitBlock();
+
   switch (this->param_.split_frame_mode)
   {
     case SplitFrameMode::SPLIT_BY_FIXED_BLKS:
@@ -149,6 +196,15 @@ inline DecoderMech<T_PointCloud>::DecoderMech(const RSDecoderMechConstParam& con
   }
 }
 
+template <typename T_PointCloud>
+inline size_t DecoderMech<T_PointCloud>::pointsPerFrame()
+{
+  // split_blks_per_frame_ is known after DIFOP is parsed. Leave room for one more packet,
+  // since frame splitting by angle may not be at exactly the same block.
+  size_t blks = (size_t)this->split_blks_per_frame_ + this->const_param_.BLOCKS_PER_PKT;
+  return blks * this->const_param_.CHANNELS_PER_BLOCK;
+}
+
 template <typename T_PointCloud>
 inline void DecoderMech<T_PointCloud>::print()
 {
@@ -160,11 +216,135 @@ inline void DecoderMech<T_PointCloud>::print()
     << "block_az_diff:\t\t" << this->block_az_diff_ << std::endl
     << "fov_blind_ts_diff:\t" << this->fov_blind_ts_diff_ << std::endl
     << "angle_from_file:\t" << this->param_.config_from_file << std::endl
-    << "angles_ready:\t\t" << this->angles_ready_ << std::endl;
+    << "angles_ready:\t\t" << this->angles_ready_ << std::endl
+    << "block_kernel:\t\t" << blockKernelToStr(this->kernel_type_) << std::endl;
 
   this->chan_angles_.print();
 }
 
+template <typename T_PointCloud>
+inline void DecoderMech<T_PointCloud>::selectEmitBlock()
+{
+#ifdef ENABLE_TRANSFORM
+  const RSTransformParam& trans = this->param_.transform_param;
+  bool transform = (trans.x != 0) || (trans.y != 0) || (trans.z != 0) || 
+    (trans.roll != 0) || (trans.pitch != 0) || (trans.yaw != 0);
+#else
+  bool transform = false;
+#endif
+
+  bool crop_angle = !this->scan_section_.fullRound();
+
+  if (this->param_.dense_points)
+    emit_block_ = selectEmitBlock<true>(transform, crop_angle);
+  else
+    emit_block_ = selectEmitBlock<false>(transform, crop_angle);
+}
+
+template <typename T_PointCloud>
+template <bool DENSE>
+inline typename DecoderMech<T_PointCloud>::EmitBlockFunc 
+DecoderMech<T_PointCloud>::selectEmitBlock(bool transform, bool crop_angle)
+{
+  if (transform)
+    return selectEmitBlock<DENSE, true>(crop_angle);
+  else
+    return selectEmitBlock<DENSE, false>(crop_angle);
+}
+
+template <typename T_PointCloud>
+template <bool DENSE, bool TRANSFORM>
+inline typename DecoderMech<T_PointCloud>::EmitBlockFunc 
+DecoderMech<T_PointCloud>::selectEmitBlock(bool crop_angle)
+{
+  if (crop_angle)
+    return &DecoderMech::template emitBlock<DecodePolicy<DENSE, TRANSFORM, true> >;
+  else
+    return &DecoderMech::template emitBlock<DecodePolicy<DENSE, TRANSFORM, false> >;
+}
+
+template <typename T_PointCloud>
+inline void DecoderMech<T_PointCloud>::decodeBlock(const RSChannel* channels, uint16_t chan_num,
+    int32_t block_az, int32_t block_az_diff, double block_ts)
+{
+  BlockKernelIn in;
+  in.block_az = block_az;
+  in.block_az_diff = block_az_diff;
+  in.vert_sins = this->chan_angles_.vertSins();
+  in.vert_coss = this->chan_angles_.vertCoss();
+  in.horiz_angles = this->chan_angles_.horizAngles();
+
+  //
+  // RS16 and RSHELIOS_16P fire all lasers twice in a block,
+  // so decode it as groups of LASER_NUM channels.
+  //
+  uint16_t laser_num = this->const_param_.LASER_NUM;
+  for (uint16_t off = 0; off < chan_num; off += laser_num)
+  {
+    in.chans = (const uint8_t*)(channels + off);
+    in.num = ((chan_num - off) < laser_num) ? (chan_num - off) : laser_num;
+    in.chan_azis = this->mech_const_param_.CHAN_AZIS + off;
+
+    this->kernel_(this->kernel_param_, in, this->kernel_out_, off);
+  }
+
+  (this->*emit_block_)(channels, chan_num, block_ts);
+}
+
+template <typename T_PointCloud>
+template <typename T_Policy>
+inline void DecoderMech<T_PointCloud>::emitBlock(const RSChannel* channels, uint16_t chan_num, double block_ts)
+{
+  const BlockKernelOut& out = this->kernel_out_;
+  uint16_t laser_num = this->const_param_.LASER_NUM;
+
+  for (uint16_t off = 0; off < chan_num; off += laser_num)
+  {
+    uint16_t num = ((chan_num - off) < laser_num) ? (chan_num - off) : laser_num;
+
+    for (uint16_t laser = 0; laser < num; laser++)
+    {
+      uint16_t chan = off + laser;
+
+      bool valid = (out.valid[chan] != 0);
+      if (T_Policy::CROP_BY_ANGLE)
+        valid = valid && this->scan_section_.in(out.angle_horiz[chan]);
+
+      if (T_Policy::DENSE_POINTS && !valid)
+        continue;
+
+      typename T_PointCloud::PointT point;
+      if (valid)
+      {
+        float x = out.x[chan];
+        float y = out.y[chan];
+        float z = out.z[chan];
+        if (T_Policy::TRANSFORM_POINTS)
+          this->transformPoint(x, y, z);
+
+        setX(point, x);
+        setY(point, y);
+        setZ(point, z);
+        setIntensity(point, channels[chan].intensity);
+      }
+      else
+      {
+        setX(point, NAN);
+        setY(point, NAN);
+        setZ(point, NAN);
+        setIntensity(point, 0);
+      }
+
+      setTimestamp(point, block_ts + this->mech_const_param_.CHAN_TSS[chan]);
+      setRing(point, (this->chan_angles_.toUserChan(laser)));
+
+      this->point_cloud_->points.emplace_back(point);
+    }
+  }
+
+  this->prev_point_ts_ = block_ts + this->mech_const_param_.CHAN_TSS[chan_num - 1];
+}
+
 template <typename T_PointCloud>
 template <typename T_Difop>
 inline void DecoderMech<T_PointCloud>::decodeDifopCommon(const T_Difop& pkt)
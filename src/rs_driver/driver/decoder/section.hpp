@@ -64,6 +64,11 @@ public:
     }
   }
 
+  bool fullRound() const
+  {
+    return full_round_;
+  }
+
 #ifndef UNIT_TEST
 private:
 #endif
@@ -94,6 +99,16 @@ public:
     return ((min_ <= distance) && (distance <= max_));
   }
 
+  float lower() const
+  {
+    return min_;
+  }
+
+  float upper() const
+  {
+    return max_;
+  }
+
 #ifndef UNIT_TEST
 private:
 #endif
@@ -35,14 +35,22 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/common/rs_common.hpp>
 
 #include <cmath>
+#include <iostream>
 
 namespace robosense
 {
 namespace lidar
 {
 
-//#define DBG
-
+//
+// sin/cos tables of angles in 0.01 degree, in [ANGLE_MIN, ANGLE_MAX).
+//
+// The tables are immutable, and shared by all decoders in the process. They are built at the
+// first use, so decoders which never look them up don't pay for them.
+//
+// With ENABLE_COMPACT_TRIGON, cos(a) is taken as sin(a + 90 degree), and the two tables overlap
+// in one buffer. This saves about 40% of memory, but the values may differ from std::cos() by 1 ulp.
+//
 class Trigon
 {
 public:
@@ -50,83 +58,113 @@ public:
   constexpr static int32_t ANGLE_MIN = -9000;
   constexpr static int32_t ANGLE_MAX = 45000;
 
-  Trigon()
+  float sin(int32_t angle)
   {
-    int32_t range = ANGLE_MAX - ANGLE_MIN;
-#ifdef DBG
-    o_angles_ = (int32_t*)malloc(range * sizeof(int32_t));
-#endif
-    o_sins_ = (float*)malloc(range * sizeof(float));
-    o_coss_ = (float*)malloc(range * sizeof(float));
-
-    for (int32_t i = ANGLE_MIN, j = 0; i < ANGLE_MAX; i++, j++)
-    {
-      double rad = DEGREE_TO_RADIAN(static_cast<double>(i) * 0.01);
+    return sinTable()[clamp(angle)];
+  }
 
-#ifdef DBG
-      o_angles_[j] = i;
-#endif
-      o_sins_[j] = (float)std::sin(rad);
-      o_coss_[j] = (float)std::cos(rad);
-    }
+  float cos(int32_t angle)
+  {
+    return cosTable()[clamp(angle)];
+  }
 
-#ifdef DBG
-    angles_ = o_angles_ - ANGLE_MIN;
-#endif
-    sins_ = o_sins_ - ANGLE_MIN;
-    coss_ = o_coss_ - ANGLE_MIN;
+  // tables indexed by angle, without range check
+  const float* sinTable() const
+  {
+    return table().sins;
   }
 
-  ~Trigon()
+  const float* cosTable() const
   {
-    free(o_coss_);
-    free(o_sins_);
-#ifdef DBG
-    free(o_angles_);
-#endif
+    return table().coss;
   }
 
-  float sin(int32_t angle)
+  // bytes of the tables
+  static size_t tableSize()
   {
-    if (angle < ANGLE_MIN || angle >= ANGLE_MAX)
-    {
-      angle = 0;
-    }
+    return table().size * sizeof(float);
+  }
 
-    return sins_[angle];
+  // angles out of the tables are taken as 0
+  static int32_t clamp(int32_t angle)
+  {
+    return ((angle < ANGLE_MIN) || (angle >= ANGLE_MAX)) ? 0 : angle;
   }
 
-  float cos(int32_t angle)
+  // the same values as in the tables
+  static float calcSin(int32_t angle)
   {
-    if (angle < ANGLE_MIN || angle >= ANGLE_MAX)
-    {
-      angle = 0;
-    }
+    return (float)std::sin(DEGREE_TO_RADIAN(static_cast<double>(angle) * 0.01));
+  }
 
-    return coss_[angle];
+  static float calcCos(int32_t angle)
+  {
+#ifdef ENABLE_COMPACT_TRIGON
+    return calcSin(angle + 9000);
+#else
+    return (float)std::cos(DEGREE_TO_RADIAN(static_cast<double>(angle) * 0.01));
+#endif
   }
 
   void print()
   {
     for (int32_t i = -10; i < 10; i++)
     {
-      std::cout << 
-#ifdef DBG 
-        angles_[i] << "\t" << 
-#endif
-        sins_[i] << "\t" << coss_[i] << std::endl;
+      std::cout << i << "\t" << sinTable()[i] << "\t" << cosTable()[i] << std::endl;
     }
   }
 
 private:
-#ifdef DBG 
-  int32_t* o_angles_;
-  int32_t* angles_;
+
+  struct Table
+  {
+    Table()
+    {
+      int32_t range = ANGLE_MAX - ANGLE_MIN;
+
+#ifdef ENABLE_COMPACT_TRIGON
+      size = range + 9000;
+      buf = (float*)malloc(size * sizeof(float));
+
+      for (int32_t i = ANGLE_MIN, j = 0; j < (int32_t)size; i++, j++)
+      {
+        buf[j] = calcSin(i);
+      }
+
+      sins = buf - ANGLE_MIN;
+      coss = sins + 9000;
+#else
+      size = range * 2;
+      buf = (float*)malloc(size * sizeof(float));
+
+      for (int32_t i = ANGLE_MIN, j = 0; i < ANGLE_MAX; i++, j++)
+      {
+        buf[j] = calcSin(i);
+        buf[range + j] = calcCos(i);
+      }
+
+      sins = buf - ANGLE_MIN;
+      coss = buf + range - ANGLE_MIN;
 #endif
-  float* o_sins_;
-  float* o_coss_;
-  float* sins_;
-  float* coss_;
+    }
+
+    ~Table()
+    {
+      free(buf);
+    }
+
+    float* buf;
+    size_t size;
+    const float* sins;
+    const float* coss;
+  };
+
+  static const Table& table()
+  {
+    // built once, thread-safe since C++11
+    static Table t;
+    return t;
+  }
 };
 
 }  // namespace lidar
@@ -215,7 +215,10 @@ enum InputType
 {
   ONLINE_LIDAR = 1,
   PCAP_FILE,
-  RAW_PACKET
+  RAW_PACKET,
+  ONLINE_LIDAR_MMAP,
+  RECORD_FILE,
+  ONLINE_LIDAR_XDP
 };
 
 inline std::string inputTypeToStr(const InputType& type)
@@ -232,6 +235,15 @@ inline std::string inputTypeToStr(const InputType& type)
     case InputType::RAW_PACKET:
       str = "RAW_PACKET";
       break;
+    case InputType::ONLINE_LIDAR_MMAP:
+      str = "ONLINE_LIDAR_MMAP";
+      break;
+    case InputType::RECORD_FILE:
+      str = "RECORD_FILE";
+      break;
+    case InputType::ONLINE_LIDAR_XDP:
+      str = "ONLINE_LIDAR_XDP";
+      break;
     default:
       str = "ERROR";
       RS_ERROR << "RS_ERROR" << RS_REND;
@@ -246,6 +258,94 @@ enum SplitFrameMode
   SPLIT_BY_CUSTOM_BLKS
 };
 
+enum PcapReplayMode
+{
+  PCAP_REPLAY_FIXED = 0,  ///< Sleep packet duration / pcap_rate after each packet
+  PCAP_REPLAY_TIMESTAMP,  ///< Pace by capture timestamps of packets, scaled by pcap_rate
+  PCAP_REPLAY_FAST        ///< As fast as possible. Wait for free buffers instead of dropping packets
+};
+
+inline std::string pcapReplayModeToStr(const PcapReplayMode& mode)
+{
+  std::string str = "";
+  switch (mode)
+  {
+    case PcapReplayMode::PCAP_REPLAY_FIXED:
+      str = "PCAP_REPLAY_FIXED";
+      break;
+    case PcapReplayMode::PCAP_REPLAY_TIMESTAMP:
+      str = "PCAP_REPLAY_TIMESTAMP";
+      break;
+    case PcapReplayMode::PCAP_REPLAY_FAST:
+      str = "PCAP_REPLAY_FAST";
+      break;
+    default:
+      str = "ERROR";
+      RS_ERROR << "RS_ERROR" << RS_REND;
+  }
+  return str;
+}
+
+enum PcapReadMode
+{
+  PCAP_READ_MMAP = 0,      ///< Map the file into memory. Packets are passed as views on it
+  PCAP_READ_AHEAD,         ///< Read large chunks ahead on a prefetch thread, into a bounded ring
+  PCAP_READ_AHEAD_DIRECT   ///< As PCAP_READ_AHEAD, with O_DIRECT, bypassing the page cache
+};
+
+inline std::string pcapReadModeToStr(const PcapReadMode& mode)
+{
+  std::string str = "";
+  switch (mode)
+  {
+    case PcapReadMode::PCAP_READ_MMAP:
+      str = "PCAP_READ_MMAP";
+      break;
+    case PcapReadMode::PCAP_READ_AHEAD:
+      str = "PCAP_READ_AHEAD";
+      break;
+    case PcapReadMode::PCAP_READ_AHEAD_DIRECT:
+      str = "PCAP_READ_AHEAD_DIRECT";
+      break;
+    default:
+      str = "ERROR";
+      RS_ERROR << "RS_ERROR" << RS_REND;
+  }
+  return str;
+}
+
+enum WaitPolicy
+{
+  WAIT_AUTO = 0,     ///< Choose by packet rate and CPU count
+  WAIT_BUSY_SPIN,    ///< Spin until packets come. Lowest latency, one CPU core busy
+  WAIT_SPIN_PARK,    ///< Spin for wait_spin_usec, and then sleep until packets come
+  WAIT_TIMED_BATCH   ///< Wake up every wait_batch_usec, and handle all packets in queue. Lowest CPU usage
+};
+
+inline std::string waitPolicyToStr(const WaitPolicy& policy)
+{
+  std::string str = "";
+  switch (policy)
+  {
+    case WaitPolicy::WAIT_AUTO:
+      str = "WAIT_AUTO";
+      break;
+    case WaitPolicy::WAIT_BUSY_SPIN:
+      str = "WAIT_BUSY_SPIN";
+      break;
+    case WaitPolicy::WAIT_SPIN_PARK:
+      str = "WAIT_SPIN_PARK";
+      break;
+    case WaitPolicy::WAIT_TIMED_BATCH:
+      str = "WAIT_TIMED_BATCH";
+      break;
+    default:
+      str = "ERROR";
+      RS_ERROR << "RS_ERROR" << RS_REND;
+  }
+  return str;
+}
+
 struct RSTransformParam  ///< The Point transform parameter
 {
   float x = 0.0f;      ///< unit, m
@@ -317,12 +417,27 @@ struct RSInputParam  ///< The LiDAR input parameter
   uint16_t difop_port = 7788;                  ///< Difop packet port number
   std::string host_address = "0.0.0.0";        ///< Address of host
   std::string group_address = "0.0.0.0";       ///< Address of multicast group
+  std::string device_name = "";                ///< Network device for ONLINE_LIDAR_MMAP (all devices if empty) and ONLINE_LIDAR_XDP
   std::string pcap_path = "";                  ///< Absolute path of pcap file
   bool pcap_repeat = true;                     ///< true: The pcap bag will repeat play
   float pcap_rate = 1.0f;                      ///< Rate to read the pcap file
+  PcapReplayMode pcap_replay_mode = PcapReplayMode::PCAP_REPLAY_FIXED; ///< How to pace packets of the pcap file
+  PcapReadMode pcap_read_mode = PcapReadMode::PCAP_READ_MMAP;        ///< How to read the pcap file
+  uint32_t pcap_frame_begin = 0;               ///< First frame to replay
+  uint32_t pcap_frame_end = 0;                 ///< Frame to stop before. 0 means the file end
+  double pcap_time_begin = 0.0;                ///< Replay from the frame of this LiDAR timestamp (second). If non-zero, it overrides frames
+  double pcap_time_end = 0.0;                  ///< Stop before the frame of this LiDAR timestamp (second). 0 means the file end
+  std::string pcap_sync_group = "";            ///< Replay in sync with the other drivers of this group. No sync if empty
+  uint16_t pcap_sync_num = 0;                  ///< Number of drivers in pcap_sync_group. Replay starts when all are started
+  std::string record_path = "";                ///< Path of packet record for RECORD_FILE, without suffix
   bool use_vlan = false;                       ///< Vlan on-off
   uint16_t user_layer_bytes = 0;    ///< Bytes of user layer. thers is no user layer if it is 0
   uint16_t tail_layer_bytes = 0;    ///< Bytes of tail layer. thers is no tail layer if it is 0
+  uint16_t recv_batch_num = 1;      ///< Max packets received per syscall. recvmmsg() is used if > 1 (epoll only)
+  std::string sock_reactor_group = ""; ///< Receive on one shared thread with the other drivers of this group (epoll only)
+  int16_t sock_reactor_cpu = -1;    ///< CPU core to pin the thread of sock_reactor_group to. Not pinned if < 0
+  bool sock_udp_gro = false;        ///< Receive datagrams coalesced by UDP_GRO, and split them into packets (epoll only)
+  bool sock_timestamp = false;      ///< Stamp packets with their arrival time in the kernel (in user space for ONLINE_LIDAR_XDP), instead of the decoding time
 
   void print() const
   {
@@ -332,17 +447,47 @@ struct RSInputParam  ///< The LiDAR input parameter
     RS_INFOL << "difop_port: " << difop_port << RS_REND;
     RS_INFOL << "host_address: " << host_address << RS_REND;
     RS_INFOL << "group_address: " << group_address << RS_REND;
+    RS_INFOL << "device_name: " << device_name << RS_REND;
     RS_INFOL << "pcap_path: " << pcap_path << RS_REND;
     RS_INFOL << "pcap_rate: " << pcap_rate << RS_REND;
     RS_INFOL << "pcap_repeat: " << pcap_repeat << RS_REND;
+    RS_INFOL << "pcap_replay_mode: " << pcapReplayModeToStr(pcap_replay_mode) << RS_REND;
+    RS_INFOL << "pcap_read_mode: " << pcapReadModeToStr(pcap_read_mode) << RS_REND;
+    RS_INFOL << "pcap_frame_begin: " << pcap_frame_begin << RS_REND;
+    RS_INFOL << "pcap_frame_end: " << pcap_frame_end << RS_REND;
+    RS_INFOL << "pcap_time_begin: " << pcap_time_begin << RS_REND;
+    RS_INFOL << "pcap_time_end: " << pcap_time_end << RS_REND;
+    RS_INFOL << "pcap_sync_group: " << pcap_sync_group << RS_REND;
+    RS_INFOL << "pcap_sync_num: " << pcap_sync_num << RS_REND;
+    RS_INFOL << "record_path: " << record_path << RS_REND;
     RS_INFOL << "use_vlan: " << use_vlan << RS_REND;
     RS_INFOL << "user_layer_bytes: " << user_layer_bytes << RS_REND;
     RS_INFOL << "tail_layer_bytes: " << tail_layer_bytes << RS_REND;
+    RS_INFOL << "recv_batch_num: " << recv_batch_num << RS_REND;
+    RS_INFOL << "sock_reactor_group: " << sock_reactor_group << RS_REND;
+    RS_INFOL << "sock_reactor_cpu: " << sock_reactor_cpu << RS_REND;
+    RS_INFOL << "sock_udp_gro: " << sock_udp_gro << RS_REND;
+    RS_INFOL << "sock_timestamp: " << sock_timestamp << RS_REND;
     RS_INFO << "------------------------------------------------------" << RS_REND;
   }
 
 };
 
+struct RSRecordParam  ///< The packet record parameter
+{
+  uint32_t segment_mb = 256;   ///< Size of a segment file (MB). Segment files are preallocated
+  bool segment_lz4 = false;    ///< Compress segments with LZ4. Requires the make option ENABLE_RECORD_LZ4
+
+  void print() const
+  {
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+    RS_INFO << "             RoboSense Record Parameters " << RS_REND;
+    RS_INFOL << "segment_mb: " << segment_mb << RS_REND;
+    RS_INFOL << "segment_lz4: " << segment_lz4 << RS_REND;
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+  }
+};
+
 struct RSDriverParam  ///< The LiDAR driver parameter
 {
   LidarType lidar_type = LidarType::RS16;  ///< Lidar type
@@ -350,6 +495,16 @@ struct RSDriverParam  ///< The LiDAR driver parameter
   std::string frame_id = "rslidar";  ///< The frame id of LiDAR mesage
   RSInputParam input_param;          ///< Input parameter
   RSDecoderParam decoder_param;      ///< Decoder parameter
+  uint32_t packet_pool_size = 0;     ///< Packet buffers preallocated at init. 0 means default by lidar type
+  bool packet_pool_hugepage = false; ///< Allocate packet buffers on huge pages
+#ifdef ENABLE_WAIT_IF_QUEUE_EMPTY
+  WaitPolicy wait_policy = WaitPolicy::WAIT_TIMED_BATCH; ///< How the handle thread waits for packets
+#else
+  WaitPolicy wait_policy = WaitPolicy::WAIT_AUTO;        ///< How the handle thread waits for packets
+#endif
+  uint32_t wait_spin_usec = 0;       ///< WAIT_SPIN_PARK: spin time. 0 means tuned by packet rate
+  uint32_t wait_batch_usec = 1000;   ///< WAIT_TIMED_BATCH: wakeup interval
+  bool decode_inline = false;        ///< Decode in the thread receiving packets (or calling decodePacket()). No handle thread
 
   void print() const
   {
@@ -358,6 +513,12 @@ struct RSDriverParam  ///< The LiDAR driver parameter
     RS_INFOL << "input type: " << inputTypeToStr(input_type) << RS_REND;
     RS_INFOL << "lidar_type: " << lidarTypeToStr(lidar_type) << RS_REND;
     RS_INFOL << "frame_id: "   << frame_id << RS_REND;
+    RS_INFOL << "packet_pool_size: " << packet_pool_size << RS_REND;
+    RS_INFOL << "packet_pool_hugepage: " << packet_pool_hugepage << RS_REND;
+    RS_INFOL << "wait_policy: " << waitPolicyToStr(wait_policy) << RS_REND;
+    RS_INFOL << "wait_spin_usec: " << wait_spin_usec << RS_REND;
+    RS_INFOL << "wait_batch_usec: " << wait_batch_usec << RS_REND;
+    RS_INFOL << "decode_inline: " << decode_inline << RS_REND;
     RS_INFOL << "------------------------------------------------------" << RS_REND;
 
     input_param.print();
@@ -32,6 +32,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <rs_driver/common/error_code.hpp>
 #include <rs_driver/driver/driver_param.hpp>
 #include <rs_driver/utility/buffer.hpp>
 
@@ -56,8 +57,16 @@ public:
 
   inline void regCallback(
       const std::function<void(const Error&)>& cb_excep,
-      const std::function<std::shared_ptr<Buffer>(size_t)>& cb_get_pkt,
-      const std::function<void(std::shared_ptr<Buffer>, bool)>& cb_put_pkt);
+      const std::function<Buffer*(size_t)>& cb_get_pkt,
+      const std::function<void(Buffer*, bool)>& cb_put_pkt);
+
+  //
+  // the decoder rewrites packet timestamps in place. Packets are not handed out as views on files then.
+  //
+  void enableWritePktTs(bool value)
+  {
+    write_pkt_ts_ = value;
+  }
 
   virtual bool init() = 0;
   virtual bool start() = 0;
@@ -67,28 +76,32 @@ public:
   }
 
 protected:
-  inline void pushPacket(std::shared_ptr<Buffer> pkt, bool stuffed = true);
+  inline Buffer* getPacket(size_t size);
+  inline void pushPacket(Buffer* pkt, bool stuffed = true);
+  inline void dropPacket(Buffer* pkt);
 
   RSInputParam input_param_;
-  std::function<std::shared_ptr<Buffer>(size_t size)> cb_get_pkt_;
-  std::function<void(std::shared_ptr<Buffer>, bool)> cb_put_pkt_;
+  std::function<Buffer*(size_t size)> cb_get_pkt_;
+  std::function<void(Buffer*, bool)> cb_put_pkt_;
   std::function<void(const Error&)> cb_excep_;
   std::thread recv_thread_;
   bool to_exit_recv_;
   bool init_flag_;
   bool start_flag_;
+  bool write_pkt_ts_;
+  Buffer drop_pkt_;  // receive into it if no buffer is available, and drop.
 };
 
 inline Input::Input(const RSInputParam& input_param)
   : input_param_(input_param), to_exit_recv_(false), 
-  init_flag_(false), start_flag_(false)
+  init_flag_(false), start_flag_(false), write_pkt_ts_(false), drop_pkt_(IP_LEN)
 {
 }
 
 inline void Input::regCallback(
     const std::function<void(const Error&)>& cb_excep,
-    const std::function<std::shared_ptr<Buffer>(size_t)>& cb_get_pkt, 
-    const std::function<void(std::shared_ptr<Buffer>, bool)>& cb_put_pkt)
+    const std::function<Buffer*(size_t)>& cb_get_pkt, 
+    const std::function<void(Buffer*, bool)>& cb_put_pkt)
 {
   cb_excep_   = cb_excep;
   cb_get_pkt_ = cb_get_pkt;
@@ -106,10 +119,41 @@ inline void Input::stop()
   }
 }
 
-inline void Input::pushPacket(std::shared_ptr<Buffer> pkt, bool stuffed)
+//
+// never return NULL. If the packet pool is exhausted, return drop_pkt_, which
+// pushPacket() discards.
+//
+inline Buffer* Input::getPacket(size_t size)
+{
+  Buffer* pkt = cb_get_pkt_(size);
+  if (pkt == NULL)
+  {
+    drop_pkt_.setData(0, 0);
+    return &drop_pkt_;
+  }
+
+  return pkt;
+}
+
+inline void Input::pushPacket(Buffer* pkt, bool stuffed)
 {
+  if (pkt == &drop_pkt_)
+  {
+    return;
+  }
+
   cb_put_pkt_(pkt, stuffed);
 }
 
+inline void Input::dropPacket(Buffer* pkt)
+{
+  if (pkt == &drop_pkt_)
+  {
+    return;
+  }
+
+  pkt->unref();
+}
+
 }  // namespace lidar
 }  // namespace robosense
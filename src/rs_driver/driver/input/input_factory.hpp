@@ -35,9 +35,20 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/driver/input/input.hpp>
 #include <rs_driver/driver/input/input_raw.hpp>
 #include <rs_driver/driver/input/input_raw_jumbo.hpp>
+#include <rs_driver/driver/input/input_record.hpp>
 #include <rs_driver/driver/input/input_sock.hpp>
 #include <rs_driver/driver/input/input_sock_jumbo.hpp>
 
+#ifdef __linux__
+#include <rs_driver/driver/input/unix/input_packet_mmap.hpp>
+#ifdef ENABLE_IO_URING_RECEIVE
+#include <rs_driver/driver/input/unix/input_sock_uring.hpp>
+#endif
+#ifdef ENABLE_XDP_RECEIVE
+#include <rs_driver/driver/input/unix/input_xdp.hpp>
+#endif
+#endif
+
 #ifndef DISABLE_PCAP_PARSE
 #include <rs_driver/driver/input/input_pcap.hpp>
 #include <rs_driver/driver/input/input_pcap_jumbo.hpp>
@@ -64,10 +75,60 @@ inline std::shared_ptr<Input> InputFactory::createInput(InputType type, const RS
   {
     case InputType::ONLINE_LIDAR:
       {
+#if !defined(ENABLE_EPOLL_RECEIVE) && !defined(ENABLE_IO_URING_RECEIVE)
+        if (!param.sock_reactor_group.empty())
+        {
+          RS_WARNING << "sock_reactor_group requires ENABLE_EPOLL_RECEIVE. Receive alone." << RS_REND;
+        }
+#endif
+
+#if defined(__linux__) && defined(ENABLE_IO_URING_RECEIVE)
+        input = std::make_shared<InputSockUring>(param, isJumbo);
+#else
         if (isJumbo)
           input = std::make_shared<InputSockJumbo>(param);
         else
           input = std::make_shared<InputSock>(param);
+#endif
+      }
+      break;
+
+#ifdef __linux__
+    case InputType::ONLINE_LIDAR_MMAP:
+      {
+        if (isJumbo)
+        {
+          // fragments have to be reassembled anyway. no gain with the ring.
+          RS_WARNING << "InputType::ONLINE_LIDAR_MMAP doesn't support jumbo packets. Use ONLINE_LIDAR instead." << RS_REND;
+          input = std::make_shared<InputSockJumbo>(param);
+        }
+        else
+        {
+          input = std::make_shared<InputPacketMmap>(param);
+        }
+      }
+      break;
+#endif
+
+    case InputType::ONLINE_LIDAR_XDP:
+      {
+#if defined(__linux__) && defined(ENABLE_XDP_RECEIVE)
+        if (isJumbo)
+        {
+          RS_WARNING << "InputType::ONLINE_LIDAR_XDP doesn't support jumbo packets. Use ONLINE_LIDAR instead." << RS_REND;
+          input = std::make_shared<InputSockJumbo>(param);
+        }
+        else
+        {
+          input = std::make_shared<InputXdp>(param);
+        }
+#else
+        RS_WARNING << "InputType::ONLINE_LIDAR_XDP requires ENABLE_XDP_RECEIVE. Use ONLINE_LIDAR instead." << RS_REND;
+        if (isJumbo)
+          input = std::make_shared<InputSockJumbo>(param);
+        else
+          input = std::make_shared<InputSock>(param);
+#endif
       }
       break;
 
@@ -82,6 +143,12 @@ inline std::shared_ptr<Input> InputFactory::createInput(InputType type, const RS
       break;
 #endif
 
+    case InputType::RECORD_FILE:
+      {
+        input = std::make_shared<InputRecord>(param, sec_to_delay);
+      }
+      break;
+
     case InputType::RAW_PACKET:
       {
         std::shared_ptr<InputRaw> inputRaw;
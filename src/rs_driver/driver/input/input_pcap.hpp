@@ -32,66 +32,90 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 #include <rs_driver/driver/input/input.hpp>
+#include <rs_driver/driver/input/pcap_pacer.hpp>
+#include <rs_driver/driver/input/pcap_reader.hpp>
+#include <rs_driver/driver/input/pcap_sync.hpp>
 
-#include <sstream>
-
-#ifdef _WIN32
-#define WIN32
-#else //__linux__
-#endif
-
-#include <pcap.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace robosense
 {
 namespace lidar
 {
-class InputPcap : public Input
+
+//
+// Replay a pcap/pcapng file. MSOP/DIFOP packets are handed to the decoder as views on the mapped file.
+// With PCAP_READ_AHEAD, or if the file is compressed, it is read on a prefetch thread, and packets are copied.
+// With pcap_sync_group, it is replayed by the thread of PcapSyncGroup, in sync with other drivers.
+//
+class InputPcap : public Input, public BufferRecycler, public PcapSyncSource
 {
 public:
   InputPcap(const RSInputParam& input_param, double sec_to_delay)
-    : Input(input_param), pcap_(NULL), pcap_offset_(ETH_HDR_LEN), pcap_tail_(0), difop_filter_valid_(false), 
-    msec_to_delay_((uint64_t)(sec_to_delay / input_param.pcap_rate * 1000000))
+    : Input(input_param), pacer_(input_param.pcap_replay_mode, sec_to_delay, input_param.pcap_rate),
+    range_begin_(0), range_end_(0), range_difop_(0), difop_pending_(false), seek_pending_(false), resync_pending_(false)
   {
-    if (input_param.use_vlan)
-    {
-      pcap_offset_ += VLAN_HDR_LEN;
-    }
+  }
 
-    pcap_offset_ += input_param.user_layer_bytes;
-    pcap_tail_   += input_param.tail_layer_bytes;
+  virtual bool init();
+  virtual bool start();
+  virtual void stop();
+  virtual void recycle(Buffer* pkt);
+  virtual ~InputPcap();
 
-    std::stringstream msop_stream, difop_stream;
-    if (input_param_.use_vlan)
-    {
-      msop_stream << "vlan && ";
-      difop_stream << "vlan && ";
-    }
+  virtual bool syncNext(PcapRecord& rec, size_t& data_off, size_t& data_size)
+  {
+    return nextPacket(rec, data_off, data_size);
+  }
 
-    msop_stream << "udp dst port " << input_param_.msop_port;
-    difop_stream << "udp dst port " << input_param_.difop_port;
+  virtual void syncPut(const PcapRecord& rec, size_t data_off, size_t data_size)
+  {
+    putPacket(rec, data_off, data_size);
+  }
 
-    msop_filter_str_ = msop_stream.str();
-    difop_filter_str_ = difop_stream.str();
+  virtual void syncEnd(bool repeat)
+  {
+    reachEnd(repeat);
   }
 
-  virtual bool init();
-  virtual bool start();
-  virtual ~InputPcap();
+  //
+  // called after init(). replay records in [begin, end] only. end is included, since it closes the last frame.
+  // The record at difop is replayed before begin, so that angles are ready for the first frame.
+  // Offsets are from PcapIndex. 0 means no limit.
+  //
+  void setRange(uint64_t begin, uint64_t end, uint64_t difop);
+
+  //
+  // find MSOP/DIFOP payload in a record, without user layer and tail layer.
+  //
+  static inline bool parsePacket(uint32_t link_type, const PcapRecord& rec, const RSInputParam& param, 
+      size_t& data_off, size_t& data_size);
 
 private:
   void recvPacket();
+  inline bool nextPacket(PcapRecord& rec, size_t& data_off, size_t& data_size);
+  inline void putPacket(const PcapRecord& rec, size_t data_off, size_t data_size);
+  inline void reachEnd(bool repeat);
+  inline void rewind();
+  inline Buffer* getView();
+
+  constexpr static size_t VIEW_NUM = 1024;
 
 private:
-  pcap_t* pcap_;
-  size_t pcap_offset_;
-  size_t pcap_tail_;
-  std::string msop_filter_str_;
-  std::string difop_filter_str_;
-  bpf_program msop_filter_;
-  bpf_program difop_filter_;
-  bool difop_filter_valid_;
-  uint64_t msec_to_delay_;
+  PcapReader reader_;
+  PcapPacer pacer_;
+  uint64_t range_begin_;
+  uint64_t range_end_;
+  uint64_t range_difop_;
+  bool difop_pending_;  // the next record is the DIFOP record
+  bool seek_pending_;   // seek to range_begin_ before reading the next record
+  bool resync_pending_; // mark the next packet as the first after seeking to the range
+  std::shared_ptr<PcapSyncGroup> sync_;
+  std::vector<std::unique_ptr<Buffer>> views_;
+  std::vector<Buffer*> free_views_;
+  std::mutex views_mtx_;
 };
 
 inline bool InputPcap::init()
@@ -99,20 +123,23 @@ inline bool InputPcap::init()
   if (init_flag_)
     return true;
 
-  char errbuf[PCAP_ERRBUF_SIZE];
-  pcap_ = pcap_open_offline(input_param_.pcap_path.c_str(), errbuf);
-  if (pcap_ == NULL)
+  if (!reader_.open(input_param_.pcap_path, input_param_.pcap_read_mode))
   {
     cb_excep_(Error(ERRCODE_PCAPWRONGPATH));
     return false;
   }
 
-  pcap_compile(pcap_, &msop_filter_, msop_filter_str_.c_str(), 1, 0xFFFFFFFF);
+  views_.reserve(VIEW_NUM);
+  free_views_.reserve(VIEW_NUM);
+  for (size_t i = 0; i < VIEW_NUM; i++)
+  {
+    views_.emplace_back(new Buffer(static_cast<BufferRecycler*>(this)));
+    free_views_.push_back(views_.back().get());
+  }
 
-  if ((input_param_.difop_port != 0) && (input_param_.difop_port != input_param_.msop_port))
+  if (!input_param_.pcap_sync_group.empty())
   {
-    pcap_compile(pcap_, &difop_filter_, difop_filter_str_.c_str(), 1, 0xFFFFFFFF);
-    difop_filter_valid_ = true;
+    sync_ = PcapSyncGroup::join(input_param_);
   }
 
   init_flag_ = true;
@@ -130,71 +157,202 @@ inline bool InputPcap::start()
     return false;
   }
 
-  to_exit_recv_ = false;
-  recv_thread_ = std::thread(std::bind(&InputPcap::recvPacket, this));
+  if (sync_ != nullptr)
+  {
+    sync_->start(this);
+  }
+  else
+  {
+    to_exit_recv_ = false;
+    recv_thread_ = std::thread(std::bind(&InputPcap::recvPacket, this));
+  }
 
   start_flag_ = true;
   return true;
 }
 
+inline void InputPcap::stop()
+{
+  if (start_flag_ && (sync_ != nullptr))
+  {
+    sync_->stop(this);
+    start_flag_ = false;
+    return;
+  }
+
+  Input::stop();
+}
+
 inline InputPcap::~InputPcap()
 {
   stop();
+}
+
+inline void InputPcap::setRange(uint64_t begin, uint64_t end, uint64_t difop)
+{
+  range_begin_ = begin;
+  range_end_ = end;
+  range_difop_ = difop;
+
+  rewind();
+}
 
-  if (pcap_ != NULL)
+inline void InputPcap::rewind()
+{
+  pacer_.reset();
+  seek_pending_ = false;
+
+  if (range_begin_ == 0)
   {
-    pcap_close(pcap_);
-    pcap_ = NULL;
+    reader_.rewind();
+    return;
   }
+
+  difop_pending_ = (range_difop_ != 0);
+  resync_pending_ = true;
+  reader_.seek(difop_pending_ ? range_difop_ : range_begin_);
 }
 
-inline void InputPcap::recvPacket()
+inline bool InputPcap::parsePacket(uint32_t link_type, const PcapRecord& rec, const RSInputParam& param, 
+    size_t& data_off, size_t& data_size)
 {
-  while (!to_exit_recv_)
+  // MSOP/DIFOP packets are never fragmented.
+  PcapUdp udp;
+  if (!PcapReader::parseUdp(link_type, rec.data, rec.caplen, udp) || (udp.frag_off != 0) || udp.more_frags)
+  {
+    return false;
+  }
+
+  if ((udp.dst_port != param.msop_port) && ((param.difop_port == 0) || (udp.dst_port != param.difop_port)))
+  {
+    return false;
+  }
+
+  if (udp.payload_len <= (size_t)param.user_layer_bytes + param.tail_layer_bytes)
   {
-    struct pcap_pkthdr* header;
-    const u_char* pkt_data;
-    int ret = pcap_next_ex(pcap_, &header, &pkt_data);
-    if (ret < 0)  // reach file end.
+    return false;
+  }
+
+  data_off = (size_t)(udp.payload - rec.data) + param.user_layer_bytes;
+  data_size = udp.payload_len - param.user_layer_bytes - param.tail_layer_bytes;
+  return true;
+}
+
+inline void InputPcap::recycle(Buffer* pkt)
+{
+  std::lock_guard<std::mutex> lg(views_mtx_);
+  free_views_.push_back(pkt);
+}
+
+inline Buffer* InputPcap::getView()
+{
+  std::lock_guard<std::mutex> lg(views_mtx_);
+  if (free_views_.empty())
+    return NULL;
+
+  Buffer* pkt = free_views_.back();
+  free_views_.pop_back();
+  return pkt;
+}
+
+//
+// read the next MSOP/DIFOP packet in the range. return false at the end.
+//
+inline bool InputPcap::nextPacket(PcapRecord& rec, size_t& data_off, size_t& data_size)
+{
+  while (1)
+  {
+    if (seek_pending_)
     {
-      pcap_close(pcap_);
-      pcap_ = NULL;
+      // the DIFOP record is handled. Go to the range. 
+      // Not at once, since seeking may invalidate the record read ahead.
+      seek_pending_ = false;
+      reader_.seek(range_begin_);
+    }
 
-      if (input_param_.pcap_repeat)
-      {
-        cb_excep_(Error(ERRCODE_PCAPREPEAT));
+    bool range_end = (range_end_ != 0) && (reader_.tell() > range_end_);
+    if (range_end || !reader_.next(rec))  // reach file end.
+    {
+      return false;
+    }
 
-        char errbuf[PCAP_ERRBUF_SIZE];
-        pcap_ = pcap_open_offline(input_param_.pcap_path.c_str(), errbuf);
-        continue;
-      }
-      else
-      {
-        cb_excep_(Error(ERRCODE_PCAPEXIT));
-        break;
-      }
+    if (difop_pending_)
+    {
+      difop_pending_ = false;
+      seek_pending_ = true;
     }
 
-    if (pcap_offline_filter(&msop_filter_, header, pkt_data) != 0)
+    if (parsePacket(rec.link_type, rec, input_param_, data_off, data_size))
     {
-      std::shared_ptr<Buffer> pkt = cb_get_pkt_(ETH_LEN);
-      memcpy(pkt->data(), pkt_data + pcap_offset_, header->len - pcap_offset_ - pcap_tail_);
-      pkt->setData(0, header->len - pcap_offset_ - pcap_tail_);
-      pushPacket(pkt);
+      return true;
     }
-    else if (difop_filter_valid_ && (pcap_offline_filter(&difop_filter_, header, pkt_data) != 0))
+  }
+}
+
+inline void InputPcap::putPacket(const PcapRecord& rec, size_t data_off, size_t data_size)
+{
+  // records read ahead are in the blocks of PcapStream. They are reused soon.
+  // A packet to be rewritten would dirty the private mapping of the file.
+  Buffer* pkt = (reader_.isMapped() && !write_pkt_ts_) ? getView() : NULL;
+  if (pkt != NULL)
+  {
+    pkt->ref();
+    pkt->attach(rec.data, rec.caplen);
+    pkt->setData(data_off, data_size);
+  }
+  else
+  {
+    // out of views, not mapped, or to be rewritten. copy it.
+    pkt = getPacket(ETH_LEN);
+    if (data_size > pkt->bufSize())
     {
-      std::shared_ptr<Buffer> pkt = cb_get_pkt_(ETH_LEN);
-      memcpy(pkt->data(), pkt_data + pcap_offset_, header->len - pcap_offset_ - pcap_tail_);
-      pkt->setData(0, header->len - pcap_offset_ - pcap_tail_);
-      pushPacket(pkt);
+      dropPacket(pkt);
+      return;
     }
-    else
+
+    pkt->setData(0, data_size);
+    memcpy(pkt->data(), rec.data + data_off, data_size);
+  }
+
+  // the range begins in the middle of a frame.
+  pkt->setResync(resync_pending_);
+  if (pkt != &drop_pkt_)
+  {
+    resync_pending_ = false;
+  }
+
+  pushPacket(pkt);
+}
+
+inline void InputPcap::reachEnd(bool repeat)
+{
+  if (repeat)
+  {
+    cb_excep_(Error(ERRCODE_PCAPREPEAT));
+    rewind();
+  }
+  else
+  {
+    cb_excep_(Error(ERRCODE_PCAPEXIT));
+  }
+}
+
+inline void InputPcap::recvPacket()
+{
+  while (!to_exit_recv_)
+  {
+    PcapRecord rec;
+    size_t data_off, data_size;
+    if (!nextPacket(rec, data_off, data_size))
     {
-      continue;
+      reachEnd(input_param_.pcap_repeat);
+      if (input_param_.pcap_repeat)
+        continue;
+      break;
     }
 
-    std::this_thread::sleep_for(std::chrono::microseconds(msec_to_delay_));
+    pacer_.wait(rec.ts_ns);
+    putPacket(rec, data_off, data_size);
   }
 }
 
@@ -33,15 +33,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 #include <rs_driver/driver/input/input.hpp>
 #include <rs_driver/driver/input/jumbo.hpp>
-
-#include <sstream>
-
-#ifdef _WIN32
-#define WIN32
-#else //__linux__
-#endif
-
-#include <pcap.h>
+#include <rs_driver/driver/input/pcap_pacer.hpp>
+#include <rs_driver/driver/input/pcap_reader.hpp>
 
 namespace robosense
 {
@@ -51,26 +44,8 @@ class InputPcapJumbo : public Input
 {
 public:
   InputPcapJumbo(const RSInputParam& input_param, double sec_to_delay)
-    : Input(input_param), pcap_(NULL), pcap_offset_(ETH_HDR_LEN), pcap_tail_(0), difop_filter_valid_(false), 
-    msec_to_delay_((uint64_t)(sec_to_delay / input_param.pcap_rate * 1000000))
+    : Input(input_param), pacer_(input_param.pcap_replay_mode, sec_to_delay, input_param.pcap_rate)
   {
-    if (input_param.use_vlan)
-    {
-      pcap_offset_ += VLAN_HDR_LEN;
-    }
-
-    pcap_offset_ += input_param.user_layer_bytes;
-    pcap_tail_   += input_param.tail_layer_bytes;
-
-    std::stringstream msop_stream;
-    if (input_param_.use_vlan)
-    {
-      msop_stream << "vlan && ";
-    }
-
-    msop_stream << "udp";
-
-    msop_filter_str_ = msop_stream.str();
   }
 
   virtual bool init();
@@ -81,14 +56,8 @@ private:
   void recvPacket();
 
 private:
-  pcap_t* pcap_;
-  size_t pcap_offset_;
-  size_t pcap_tail_;
-  std::string msop_filter_str_;
-  bpf_program msop_filter_;
-  bpf_program difop_filter_;
-  bool difop_filter_valid_;
-  uint64_t msec_to_delay_;
+  PcapReader reader_;
+  PcapPacer pacer_;
 
   Jumbo jumbo_;
 };
@@ -98,15 +67,16 @@ inline bool InputPcapJumbo::init()
   if (init_flag_)
     return true;
 
-  char errbuf[PCAP_ERRBUF_SIZE];
-  pcap_ = pcap_open_offline(input_param_.pcap_path.c_str(), errbuf);
-  if (pcap_ == NULL)
+  if (!reader_.open(input_param_.pcap_path, input_param_.pcap_read_mode))
   {
     cb_excep_(Error(ERRCODE_PCAPWRONGPATH));
     return false;
   }
 
-  pcap_compile(pcap_, &msop_filter_, msop_filter_str_.c_str(), 1, 0xFFFFFFFF);
+  if (!input_param_.pcap_sync_group.empty())
+  {
+    RS_WARNING << "pcap_sync_group is not supported for jumbo packets. Replay alone." << RS_REND;
+  }
 
   init_flag_ = true;
   return true;
@@ -133,32 +103,21 @@ inline bool InputPcapJumbo::start()
 inline InputPcapJumbo::~InputPcapJumbo()
 {
   stop();
-
-  if (pcap_ != NULL)
-  {
-    pcap_close(pcap_);
-    pcap_ = NULL;
-  }
 }
 
 inline void InputPcapJumbo::recvPacket()
 {
   while (!to_exit_recv_)
   {
-    struct pcap_pkthdr* header;
-    const uint8_t* pkt_data;
-    int ret = pcap_next_ex(pcap_, &header, &pkt_data);
-    if (ret < 0)  // reach file end.
+    PcapRecord rec;
+    if (!reader_.next(rec))  // reach file end.
     {
-      pcap_close(pcap_);
-      pcap_ = NULL;
-
       if (input_param_.pcap_repeat)
       {
         cb_excep_(Error(ERRCODE_PCAPREPEAT));
 
-        char errbuf[PCAP_ERRBUF_SIZE];
-        pcap_ = pcap_open_offline(input_param_.pcap_path.c_str(), errbuf);
+        reader_.rewind();
+        pacer_.reset();
         continue;
       }
       else
@@ -168,29 +127,30 @@ inline void InputPcapJumbo::recvPacket()
       }
     }
 
-    if (pcap_offline_filter(&msop_filter_, header, pkt_data) != 0)
-    {
-      uint16_t udp_port = 0;
-      const uint8_t* udp_data = NULL;
-      size_t udp_data_len = 0;
-      bool new_pkt = jumbo_.new_fragment(pkt_data, header->len, &udp_port, &udp_data, &udp_data_len);
-      if (new_pkt)
-      {
-        if ((udp_port == input_param_.msop_port) || (udp_port == input_param_.difop_port))
-        {
-          std::shared_ptr<Buffer> pkt = cb_get_pkt_(IP_LEN);
-          memcpy(pkt->data(), udp_data, udp_data_len);
-          pkt->setData(0, udp_data_len);
-          pushPacket(pkt);
-        }
-      }
-    }
-    else
+    // Jumbo reassembles fragments of Ethernet/IPv4/UDP only.
+    PcapUdp udp;
+    if (!PcapReader::parseUdp(rec.link_type, rec.data, rec.caplen, udp) || 
+        (rec.link_type != PcapReader::LINKTYPE_ETHERNET) || udp.vlan)
     {
       continue;
     }
 
-    std::this_thread::sleep_for(std::chrono::microseconds(msec_to_delay_));
+    pacer_.wait(rec.ts_ns);
+
+    uint16_t udp_port = 0;
+    const uint8_t* udp_data = NULL;
+    size_t udp_data_len = 0;
+    bool new_pkt = jumbo_.new_fragment(rec.data, rec.caplen, &udp_port, &udp_data, &udp_data_len);
+    if (new_pkt)
+    {
+      if ((udp_port == input_param_.msop_port) || (udp_port == input_param_.difop_port))
+      {
+        Buffer* pkt = getPacket(IP_LEN);
+        memcpy(pkt->data(), udp_data, udp_data_len);
+        pkt->setData(0, udp_data_len);
+        pushPacket(pkt);
+      }
+    }
   }
 }
 
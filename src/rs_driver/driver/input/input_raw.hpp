@@ -34,6 +34,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rs_driver/driver/input/input.hpp>
 
+#include <mutex>
+
 namespace robosense
 {
 namespace lidar
@@ -55,6 +57,7 @@ protected:
   size_t pkt_buf_len_;
   size_t raw_offset_;
   size_t raw_tail_;
+  std::mutex feed_mtx_;  // the packet queue takes one producer. decodePacket() may be called from several threads
 };
 
 inline InputRaw::InputRaw(const RSInputParam& input_param)
@@ -67,7 +70,9 @@ inline InputRaw::InputRaw(const RSInputParam& input_param)
 
 inline void InputRaw::feedPacket(const uint8_t* data, size_t size)
 {
-  std::shared_ptr<Buffer> pkt = cb_get_pkt_(pkt_buf_len_);
+  std::lock_guard<std::mutex> lg(feed_mtx_);
+
+  Buffer* pkt = getPacket(pkt_buf_len_);
   memcpy(pkt->data(), data + raw_offset_, size - raw_offset_ - raw_tail_);
   pkt->setData(0, size - raw_offset_ - raw_tail_);
   pushPacket(pkt);
@@ -0,0 +1,301 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/input/input.hpp>
+#include <rs_driver/driver/input/packet_record.hpp>
+#include <rs_driver/driver/input/pcap_pacer.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Replay a packet record. Packets are handed to the decoder as views on the mapped segments.
+// Packets of LZ4 compressed segments are copied.
+// It is paced as PCAP_FILE, and seeks to a range of frames by the frame index saved with the record.
+//
+class InputRecord : public Input, public BufferRecycler
+{
+public:
+  InputRecord(const RSInputParam& input_param, double sec_to_delay)
+    : Input(input_param), pacer_(input_param.pcap_replay_mode, sec_to_delay, input_param.pcap_rate),
+    range_begin_(0), range_end_(0), range_difop_(0), difop_pending_(false), seek_pending_(false), resync_pending_(false)
+  {
+  }
+
+  virtual bool init();
+  virtual bool start();
+  virtual void recycle(Buffer* pkt);
+  virtual ~InputRecord();
+
+private:
+  inline bool initRange();
+  void recvPacket();
+  inline bool nextPacket(PacketRecord& rec);
+  inline void putPacket(const PacketRecord& rec);
+  inline void rewind();
+  inline Buffer* getView();
+
+  constexpr static size_t VIEW_NUM = 1024;
+
+private:
+  PacketRecordReader reader_;
+  PcapPacer pacer_;
+  uint64_t range_begin_;   // positions in the record. 0 means no limit
+  uint64_t range_end_;
+  uint64_t range_difop_;
+  bool difop_pending_;     // the next record is the DIFOP record
+  bool seek_pending_;      // seek to range_begin_ before reading the next record
+  bool resync_pending_;    // mark the next packet as the first after seeking to the range
+  std::vector<std::unique_ptr<Buffer>> views_;
+  std::vector<Buffer*> free_views_;
+  std::mutex views_mtx_;
+};
+
+inline bool InputRecord::init()
+{
+  if (init_flag_)
+    return true;
+
+  if (!reader_.open(input_param_.record_path))
+  {
+    cb_excep_(Error(ERRCODE_PCAPWRONGPATH));
+    return false;
+  }
+
+  if (!initRange())
+  {
+    return false;
+  }
+
+  if (!input_param_.pcap_sync_group.empty())
+  {
+    RS_WARNING << "InputType::RECORD_FILE doesn't support pcap_sync_group. Replay alone." << RS_REND;
+  }
+
+  views_.reserve(VIEW_NUM);
+  free_views_.reserve(VIEW_NUM);
+  for (size_t i = 0; i < VIEW_NUM; i++)
+  {
+    views_.emplace_back(new Buffer(static_cast<BufferRecycler*>(this)));
+    free_views_.push_back(views_.back().get());
+  }
+
+  init_flag_ = true;
+  return true;
+}
+
+//
+// select frames by pcap_frame_begin/end or pcap_time_begin/end, with the frame index of the record.
+//
+inline bool InputRecord::initRange()
+{
+  if ((input_param_.pcap_frame_begin == 0) && (input_param_.pcap_frame_end == 0) &&
+      (input_param_.pcap_time_begin == 0.0) && (input_param_.pcap_time_end == 0.0))
+  {
+    return true;
+  }
+
+  const PcapIndex& index = reader_.index();
+
+  size_t begin, end;
+  if (!index.range(input_param_, begin, end))
+  {
+    RS_ERROR << "No frame in the range. The packet record has " << index.size() << " frames." << RS_REND;
+    return false;
+  }
+
+  RS_INFO << "Replay frames [" << begin << ", " << end << ") of " << index.size() << "." << RS_REND;
+
+  range_begin_ = index[begin].offset;
+  range_end_ = (end < index.size()) ? index[end].offset : 0;
+  range_difop_ = index[begin].difop_offset;
+
+  rewind();
+  return true;
+}
+
+inline bool InputRecord::start()
+{
+  if (start_flag_)
+    return true;
+
+  if (!init_flag_)
+  {
+    cb_excep_(Error(ERRCODE_STARTBEFOREINIT));
+    return false;
+  }
+
+  to_exit_recv_ = false;
+  recv_thread_ = std::thread(std::bind(&InputRecord::recvPacket, this));
+
+  start_flag_ = true;
+  return true;
+}
+
+inline InputRecord::~InputRecord()
+{
+  stop();
+}
+
+inline void InputRecord::rewind()
+{
+  pacer_.reset();
+  seek_pending_ = false;
+
+  if (range_begin_ == 0)
+  {
+    reader_.rewind();
+    return;
+  }
+
+  difop_pending_ = (range_difop_ != 0);
+  resync_pending_ = true;
+  reader_.seek(difop_pending_ ? range_difop_ : range_begin_);
+}
+
+inline void InputRecord::recycle(Buffer* pkt)
+{
+  std::lock_guard<std::mutex> lg(views_mtx_);
+  free_views_.push_back(pkt);
+}
+
+inline Buffer* InputRecord::getView()
+{
+  std::lock_guard<std::mutex> lg(views_mtx_);
+  if (free_views_.empty())
+    return NULL;
+
+  Buffer* pkt = free_views_.back();
+  free_views_.pop_back();
+  return pkt;
+}
+
+//
+// read the next packet in the range. return false at the end.
+//
+inline bool InputRecord::nextPacket(PacketRecord& rec)
+{
+  if (seek_pending_)
+  {
+    // the DIFOP record is handled. Go to the range.
+    // Not at once, since the DIFOP record may be in a compressed segment, which is replaced by seeking.
+    seek_pending_ = false;
+    reader_.seek(range_begin_);
+  }
+
+  if ((range_end_ != 0) && (reader_.tell() > range_end_))
+  {
+    return false;
+  }
+
+  if (!reader_.next(rec))
+  {
+    return false;
+  }
+
+  if (difop_pending_)
+  {
+    difop_pending_ = false;
+    seek_pending_ = true;
+  }
+
+  return true;
+}
+
+inline void InputRecord::putPacket(const PacketRecord& rec)
+{
+  // a compressed segment is decompressed into a buffer, which is reused by the next one.
+  // A packet to be rewritten would dirty the private mapping of the file.
+  Buffer* pkt = (reader_.isMapped() && !write_pkt_ts_) ? getView() : NULL;
+  if (pkt != NULL)
+  {
+    pkt->ref();
+    pkt->attach(rec.data, rec.len);
+    pkt->setData(0, rec.len);
+  }
+  else
+  {
+    // out of views, not mapped, or to be rewritten. copy it.
+    pkt = getPacket(rec.len);
+    if (rec.len > pkt->bufSize())
+    {
+      dropPacket(pkt);
+      return;
+    }
+
+    pkt->setData(0, rec.len);
+    memcpy(pkt->data(), rec.data, rec.len);
+  }
+
+  // the range begins in the middle of a frame.
+  pkt->setResync(resync_pending_);
+  if (pkt != &drop_pkt_)
+  {
+    resync_pending_ = false;
+  }
+
+  pushPacket(pkt);
+}
+
+inline void InputRecord::recvPacket()
+{
+  while (!to_exit_recv_)
+  {
+    PacketRecord rec;
+    if (!nextPacket(rec))
+    {
+      if (input_param_.pcap_repeat)
+      {
+        cb_excep_(Error(ERRCODE_PCAPREPEAT));
+        rewind();
+        continue;
+      }
+
+      cb_excep_(Error(ERRCODE_PCAPEXIT));
+      break;
+    }
+
+    pacer_.wait(rec.ts_ns);
+    putPacket(rec);
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
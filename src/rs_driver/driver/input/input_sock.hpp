@@ -7,7 +7,7 @@
 
 #else  //__linux__
 
-#ifdef ENABLE_EPOLL_RECEIVE
+#if defined(ENABLE_EPOLL_RECEIVE) || defined(ENABLE_IO_URING_RECEIVE)
 #include <rs_driver/driver/input/unix/input_sock_epoll.hpp>
 #else
 #include <rs_driver/driver/input/unix/input_sock_select.hpp>
@@ -0,0 +1,447 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/common/rs_log.hpp>
+#include <rs_driver/driver/input/pcap_index.hpp>
+#include <rs_driver/utility/mapped_file.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef ENABLE_RECORD_LZ4
+#include <lz4.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Packet record, a compact alternative to pcap files for MSOP/DIFOP packets. A record made of
+// path "rec" is:
+//
+//   rec.idx               frame index. RecordIndexHeader + PcapFrame entries, appended while recording.
+//   rec.00000, rec.00001  segments. RecordSegmentHeader + records.
+//
+// A record is a RecordHeader of 16 bytes and the UDP payload, padded to 8 bytes. A segment is
+// preallocated and written in place. It is sealed by updating its header and truncating it.
+// If the recorder stops abnormally, the last segment is not sealed, and a reader stops at the
+// first record of zero length, i.e. the preallocated but unused space.
+//
+// With LZ4, a segment is buffered in memory, and compressed as a whole when it is sealed.
+//
+// A position in the record is (segment << 40) | offset, where offset is from the start of the segment
+// (decompressed). It is never 0, and is used as the offset in PcapFrame, so PcapIndex works on it.
+//
+// All files are in the host byte order.
+//
+
+struct RecordSegmentHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;          // RECORD_SEGMENT_LZ4
+  uint64_t data_bytes;     // bytes of records, decompressed. 0 if the segment isn't sealed
+  uint64_t stored_bytes;   // bytes after the header in file
+  uint64_t record_num;
+  int64_t ts_first_ns;
+  int64_t ts_last_ns;
+  uint64_t reserved;
+};
+
+struct RecordIndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t frame_size;
+};
+
+struct RecordHeader
+{
+  int64_t ts_ns;    // host time when the packet is recorded
+  uint32_t len;     // bytes of packet
+  uint16_t type;    // RECORD_TYPE_MSOP or RECORD_TYPE_DIFOP
+  uint16_t flags;   // RECORD_FRAME_BEGIN
+};
+
+//
+// A packet in the record. data points into the mapped segment, or into the decompressed one.
+//
+struct PacketRecord
+{
+  int64_t ts_ns;
+  uint32_t len;
+  uint16_t type;
+  uint16_t flags;
+  uint8_t* data;
+};
+
+class PacketRecordFormat
+{
+public:
+
+  constexpr static uint32_t VERSION = 1;
+
+  constexpr static uint32_t RECORD_SEGMENT_LZ4 = 0x1;
+
+  constexpr static uint16_t RECORD_TYPE_MSOP = 0;
+  constexpr static uint16_t RECORD_TYPE_DIFOP = 1;
+  constexpr static uint16_t RECORD_FRAME_BEGIN = 0x1;
+
+  constexpr static size_t SEGMENT_HDR_LEN = sizeof(RecordSegmentHeader);
+  constexpr static size_t RECORD_HDR_LEN = sizeof(RecordHeader);
+  constexpr static uint32_t POS_OFF_BITS = 40;
+
+  static const char* segmentMagic()
+  {
+    return "RSPKTSEG";
+  }
+
+  static const char* indexMagic()
+  {
+    return "RSPKTIDX";
+  }
+
+  static std::string indexPath(const std::string& path)
+  {
+    return path + ".idx";
+  }
+
+  static std::string segmentPath(const std::string& path, uint32_t seg)
+  {
+    char name[16];
+    snprintf(name, sizeof(name), ".%05u", seg);
+    return path + name;
+  }
+
+  static size_t recordLen(size_t data_len)
+  {
+    return RECORD_HDR_LEN + ((data_len + 7) & ~(size_t)7);
+  }
+
+  static uint64_t pos(uint32_t seg, uint64_t off)
+  {
+    return ((uint64_t)seg << POS_OFF_BITS) | off;
+  }
+
+  static uint32_t posSegment(uint64_t pos)
+  {
+    return (uint32_t)(pos >> POS_OFF_BITS);
+  }
+
+  static uint64_t posOffset(uint64_t pos)
+  {
+    return pos & (((uint64_t)1 << POS_OFF_BITS) - 1);
+  }
+};
+
+//
+// Read a packet record. Uncompressed segments are mapped copy-on-write, and their records stay
+// valid until close(). A compressed segment is decompressed into memory when it is reached, and
+// its records are valid only until the next segment is reached.
+//
+class PacketRecordReader
+{
+public:
+
+  PacketRecordReader()
+    : seg_(0), off_(0), data_(NULL), data_end_(0), inflated_seg_(-1)
+  {
+  }
+
+  PacketRecordReader(const PacketRecordReader&) = delete;
+  PacketRecordReader& operator=(const PacketRecordReader&) = delete;
+
+  inline bool open(const std::string& path);
+  inline void close();
+
+  size_t segmentNum() const
+  {
+    return segs_.size();
+  }
+
+  //
+  // frames in the index. It may be empty, if the index is missing.
+  //
+  const PcapIndex& index() const
+  {
+    return index_;
+  }
+
+  //
+  // records of the current segment are in the mapped file.
+  //
+  bool isMapped() const
+  {
+    return (seg_ < segs_.size()) && !segs_[seg_]->lz4;
+  }
+
+  inline bool next(PacketRecord& rec);
+
+  uint64_t tell() const
+  {
+    return PacketRecordFormat::pos(seg_, off_);
+  }
+
+  inline void seek(uint64_t pos);
+
+  void rewind()
+  {
+    seek(PacketRecordFormat::pos(0, PacketRecordFormat::SEGMENT_HDR_LEN));
+  }
+
+private:
+
+  struct Segment
+  {
+    MappedFile file;
+    bool lz4;
+    size_t data_bytes;  // 0 if not sealed
+  };
+
+  inline bool loadIndex(const std::string& path);
+  inline bool mapSegment(const std::string& path, uint32_t seg);
+  inline bool enterSegment();
+
+  std::vector<std::unique_ptr<Segment>> segs_;
+  PcapIndex index_;
+  uint32_t seg_;
+  size_t off_;
+  uint8_t* data_;       // start of the current segment, decompressed
+  size_t data_end_;
+  int64_t inflated_seg_;
+  std::vector<uint8_t> inflate_buf_;
+};
+
+inline bool PacketRecordReader::open(const std::string& path)
+{
+  close();
+
+  for (uint32_t seg = 0; ; seg++)
+  {
+    if (!mapSegment(PacketRecordFormat::segmentPath(path, seg), seg))
+      break;
+  }
+
+  if (segs_.empty())
+  {
+    RS_ERROR << "No segment of packet record " << path << RS_REND;
+    return false;
+  }
+
+  if (!loadIndex(PacketRecordFormat::indexPath(path)))
+  {
+    RS_WARNING << "No frame index of packet record " << path << ". Ranges of frames are not supported." << RS_REND;
+  }
+
+  rewind();
+  return true;
+}
+
+inline void PacketRecordReader::close()
+{
+  segs_.clear();
+  index_.reset(PcapIndexKey());
+  seg_ = 0;
+  off_ = 0;
+  data_ = NULL;
+  data_end_ = 0;
+  inflated_seg_ = -1;
+  inflate_buf_.clear();
+}
+
+inline bool PacketRecordReader::mapSegment(const std::string& path, uint32_t seg)
+{
+  std::unique_ptr<Segment> segment(new Segment);
+  if (!segment->file.map(path))
+    return false;
+
+  const RecordSegmentHeader* hdr = (const RecordSegmentHeader*)segment->file.data();
+  if ((segment->file.size() < PacketRecordFormat::SEGMENT_HDR_LEN) ||
+      (memcmp(hdr->magic, PacketRecordFormat::segmentMagic(), sizeof(hdr->magic)) != 0) ||
+      (hdr->version != PacketRecordFormat::VERSION))
+  {
+    RS_WARNING << path << " is not a segment of packet record. Stop at it." << RS_REND;
+    return false;
+  }
+
+  segment->lz4 = ((hdr->flags & PacketRecordFormat::RECORD_SEGMENT_LZ4) != 0);
+  segment->data_bytes = hdr->data_bytes;
+
+#ifndef ENABLE_RECORD_LZ4
+  if (segment->lz4)
+  {
+    RS_WARNING << path << " is LZ4 compressed. Please specify the make option ENABLE_RECORD_LZ4. Stop at it." << RS_REND;
+    return false;
+  }
+#endif
+
+  segs_.emplace_back(std::move(segment));
+  return true;
+}
+
+inline bool PacketRecordReader::loadIndex(const std::string& path)
+{
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (fp == NULL)
+    goto failOpen;
+
+  {
+    RecordIndexHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+      goto failRead;
+
+    if ((memcmp(hdr.magic, PacketRecordFormat::indexMagic(), sizeof(hdr.magic)) != 0) ||
+        (hdr.version != PacketRecordFormat::VERSION) || (hdr.frame_size != sizeof(PcapFrame)))
+      goto failRead;
+
+    // entries are appended while recording. A partial one at the end is ignored, and so are frames
+    // in segments lost.
+    PcapFrame frame;
+    while (fread(&frame, sizeof(frame), 1, fp) == 1)
+    {
+      if (PacketRecordFormat::posSegment(frame.offset) >= segs_.size())
+        break;
+
+      index_.add(frame);
+    }
+  }
+
+  fclose(fp);
+  return true;
+
+failRead:
+  fclose(fp);
+failOpen:
+  return false;
+}
+
+//
+// make the current segment ready to read. return false if it is broken.
+//
+inline bool PacketRecordReader::enterSegment()
+{
+  Segment& segment = *segs_[seg_];
+  size_t file_size = segment.file.size();
+
+  if (!segment.lz4)
+  {
+    data_ = segment.file.data();
+    data_end_ = (segment.data_bytes == 0) ? file_size :
+      std::min(file_size, PacketRecordFormat::SEGMENT_HDR_LEN + segment.data_bytes);
+    return true;
+  }
+
+#ifdef ENABLE_RECORD_LZ4
+  if (inflated_seg_ != (int64_t)seg_)
+  {
+    const RecordSegmentHeader* hdr = (const RecordSegmentHeader*)segment.file.data();
+    size_t stored_bytes = (size_t)hdr->stored_bytes;
+    size_t data_bytes = (size_t)hdr->data_bytes;
+    if (file_size - PacketRecordFormat::SEGMENT_HDR_LEN < stored_bytes)
+      return false;
+
+    inflate_buf_.resize(PacketRecordFormat::SEGMENT_HDR_LEN + data_bytes);
+    memcpy(inflate_buf_.data(), hdr, PacketRecordFormat::SEGMENT_HDR_LEN);
+
+    int ret = LZ4_decompress_safe((const char*)segment.file.data() + PacketRecordFormat::SEGMENT_HDR_LEN,
+        (char*)inflate_buf_.data() + PacketRecordFormat::SEGMENT_HDR_LEN, (int)stored_bytes, (int)data_bytes);
+    if (ret != (int)data_bytes)
+      return false;
+
+    inflated_seg_ = seg_;
+  }
+
+  data_ = inflate_buf_.data();
+  data_end_ = inflate_buf_.size();
+  return true;
+#else
+  return false;
+#endif
+}
+
+inline void PacketRecordReader::seek(uint64_t pos)
+{
+  seg_ = PacketRecordFormat::posSegment(pos);
+  off_ = (size_t)PacketRecordFormat::posOffset(pos);
+  data_ = NULL;
+}
+
+inline bool PacketRecordReader::next(PacketRecord& rec)
+{
+  while (seg_ < segs_.size())
+  {
+    if ((data_ == NULL) && !enterSegment())
+    {
+      RS_WARNING << "Segment " << seg_ << " of packet record is broken. Skip it." << RS_REND;
+      goto nextSegment;
+    }
+
+    if ((off_ <= data_end_) && (data_end_ - off_ >= PacketRecordFormat::RECORD_HDR_LEN))
+    {
+      RecordHeader hdr;
+      memcpy(&hdr, data_ + off_, sizeof(hdr));
+
+      // zero length means the unused space of a segment not sealed.
+      size_t rec_len = PacketRecordFormat::recordLen(hdr.len);
+      if ((hdr.len != 0) && (rec_len <= data_end_ - off_))
+      {
+        rec.ts_ns = hdr.ts_ns;
+        rec.len = hdr.len;
+        rec.type = hdr.type;
+        rec.flags = hdr.flags;
+        rec.data = data_ + off_ + PacketRecordFormat::RECORD_HDR_LEN;
+
+        off_ += rec_len;
+        return true;
+      }
+    }
+
+nextSegment:
+    seg_++;
+    off_ = PacketRecordFormat::SEGMENT_HDR_LEN;
+    data_ = NULL;
+  }
+
+  return false;
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,277 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// A frame in pcap file, i.e. a point cloud of the driver.
+//
+struct PcapFrame
+{
+  double ts;              // timestamp of point cloud, by LiDAR clock
+  uint64_t offset;        // record to replay from. It may also carry the tail of the previous frame.
+  uint64_t difop_offset;  // last DIFOP record before offset. 0 if none
+};
+
+//
+// What the frames depend on. If any of them changes, the index has to be rebuilt.
+// All members are 64 bits, so there is no padding, and the struct can be compared as bytes.
+//
+struct PcapIndexKey
+{
+  uint64_t file_size;
+  int64_t file_mtime;
+  uint64_t lidar_type;
+  uint64_t msop_port;
+  uint64_t difop_port;
+  uint64_t user_layer_bytes;
+  uint64_t tail_layer_bytes;
+  uint64_t split_frame_mode;
+  int64_t split_angle;      // 0.01 degree
+  uint64_t num_blks_split;
+  uint64_t wait_for_difop;
+  uint64_t ts_first_point;
+  int64_t start_angle;      // 0.01 degree
+  int64_t end_angle;        // 0.01 degree
+  int64_t min_distance;     // mm
+  int64_t max_distance;     // mm
+};
+
+//
+// Frame index of a pcap file. It is built once, and cached as a sidecar file next to the pcap file,
+// so that replay can start from any frame or timestamp, without decoding the packets before it.
+//
+// The sidecar file is in the host byte order. It is a cache, not an exchange format.
+//
+class PcapIndex
+{
+public:
+
+  static std::string sidecarPath(const std::string& pcap_path)
+  {
+    return pcap_path + ".rsidx";
+  }
+
+  static inline bool makeKey(const RSDriverParam& param, PcapIndexKey& key);
+
+  inline bool load(const std::string& path, const PcapIndexKey& key);
+  inline bool save(const std::string& path) const;
+
+  void reset(const PcapIndexKey& key)
+  {
+    key_ = key;
+    frames_.clear();
+  }
+
+  void add(const PcapFrame& frame)
+  {
+    frames_.push_back(frame);
+  }
+
+  size_t size() const
+  {
+    return frames_.size();
+  }
+
+  const PcapFrame& operator[](size_t i) const
+  {
+    return frames_[i];
+  }
+
+  //
+  // frames [begin, end) selected by pcap_frame_begin/end or pcap_time_begin/end.
+  // return false if no frame is selected.
+  //
+  inline bool range(const RSInputParam& param, size_t& begin, size_t& end) const;
+
+private:
+
+  constexpr static uint32_t VERSION = 2;
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t frame_size;
+    PcapIndexKey key;
+    uint64_t frame_num;
+  };
+
+  static const char* magic()
+  {
+    return "RSPCAPIX";
+  }
+
+  PcapIndexKey key_;
+  std::vector<PcapFrame> frames_;
+};
+
+inline bool PcapIndex::makeKey(const RSDriverParam& param, PcapIndexKey& key)
+{
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_stat64(param.input_param.pcap_path.c_str(), &st) != 0)
+    return false;
+#else
+  struct stat st;
+  if (stat(param.input_param.pcap_path.c_str(), &st) != 0)
+    return false;
+#endif
+
+  memset(&key, 0, sizeof(key));
+  key.file_size = (uint64_t)st.st_size;
+  key.file_mtime = (int64_t)st.st_mtime;
+  key.lidar_type = (uint64_t)param.lidar_type;
+  key.msop_port = param.input_param.msop_port;
+  key.difop_port = param.input_param.difop_port;
+  key.user_layer_bytes = param.input_param.user_layer_bytes;
+  key.tail_layer_bytes = param.input_param.tail_layer_bytes;
+  key.split_frame_mode = (uint64_t)param.decoder_param.split_frame_mode;
+  key.split_angle = (int64_t)(param.decoder_param.split_angle * 100);
+  key.num_blks_split = param.decoder_param.num_blks_split;
+  key.wait_for_difop = param.decoder_param.wait_for_difop;
+  key.ts_first_point = param.decoder_param.ts_first_point;
+  key.start_angle = (int64_t)(param.decoder_param.start_angle * 100);
+  key.end_angle = (int64_t)(param.decoder_param.end_angle * 100);
+  key.min_distance = (int64_t)(param.decoder_param.min_distance * 1000);
+  key.max_distance = (int64_t)(param.decoder_param.max_distance * 1000);
+  return true;
+}
+
+inline bool PcapIndex::load(const std::string& path, const PcapIndexKey& key)
+{
+  frames_.clear();
+
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (fp == NULL)
+    goto failOpen;
+
+  {
+    Header hdr;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+      goto failRead;
+
+    if ((memcmp(hdr.magic, magic(), sizeof(hdr.magic)) != 0) || (hdr.version != VERSION) || 
+        (hdr.frame_size != sizeof(PcapFrame)) || (memcmp(&hdr.key, &key, sizeof(key)) != 0))
+      goto failRead;
+
+    frames_.resize(hdr.frame_num);
+    if ((hdr.frame_num > 0) && (fread(frames_.data(), sizeof(PcapFrame), frames_.size(), fp) != frames_.size()))
+      goto failRead;
+  }
+
+  key_ = key;
+  fclose(fp);
+  return true;
+
+failRead:
+  frames_.clear();
+  fclose(fp);
+failOpen:
+  return false;
+}
+
+inline bool PcapIndex::save(const std::string& path) const
+{
+  Header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, magic(), sizeof(hdr.magic));
+  hdr.version = VERSION;
+  hdr.frame_size = sizeof(PcapFrame);
+  hdr.key = key_;
+  hdr.frame_num = frames_.size();
+
+  // write to a temporary file, and rename it, so that a reader never sees a partial index.
+  std::string tmp_path = path + ".tmp";
+  FILE* fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == NULL)
+    goto failOpen;
+
+  if ((fwrite(&hdr, sizeof(hdr), 1, fp) != 1) || 
+      ((frames_.size() > 0) && (fwrite(frames_.data(), sizeof(PcapFrame), frames_.size(), fp) != frames_.size())))
+    goto failWrite;
+
+  if (fclose(fp) != 0)
+    goto failClose;
+
+  remove(path.c_str());
+  if (rename(tmp_path.c_str(), path.c_str()) != 0)
+    goto failClose;
+
+  return true;
+
+failWrite:
+  fclose(fp);
+failClose:
+  remove(tmp_path.c_str());
+failOpen:
+  return false;
+}
+
+inline bool PcapIndex::range(const RSInputParam& param, size_t& begin, size_t& end) const
+{
+  if ((param.pcap_time_begin != 0.0) || (param.pcap_time_end != 0.0))
+  {
+    auto ts_less = [](const PcapFrame& frame, double ts) { return frame.ts < ts; };
+
+    begin = std::lower_bound(frames_.begin(), frames_.end(), param.pcap_time_begin, ts_less) - frames_.begin();
+    end = (param.pcap_time_end == 0.0) ? frames_.size() : 
+      (std::lower_bound(frames_.begin(), frames_.end(), param.pcap_time_end, ts_less) - frames_.begin());
+  }
+  else
+  {
+    begin = std::min((size_t)param.pcap_frame_begin, frames_.size());
+    end = (param.pcap_frame_end == 0) ? frames_.size() : std::min((size_t)param.pcap_frame_end, frames_.size());
+  }
+
+  return (begin < end);
+}
+
+}  // namespace lidar
+}  // namespace robosense
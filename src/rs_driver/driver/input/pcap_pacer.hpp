@@ -0,0 +1,139 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+
+#include <chrono>
+#include <thread>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Pace packets read from a pcap file, by PcapReplayMode.
+//
+class PcapPacer
+{
+public:
+
+  constexpr static int64_t GAP_MAX_NS = 1000000000; // longer gaps in capture are skipped
+
+  PcapPacer(PcapReplayMode mode, double sec_to_delay, float rate)
+    : mode_(mode), rate_((rate > 0) ? rate : 1.0f), 
+    usec_to_delay_((uint64_t)(sec_to_delay / rate_ * 1000000)), started_(false), 
+    base_pkt_ns_(0), prev_pkt_ns_(0)
+  {
+  }
+
+  PcapReplayMode mode() const
+  {
+    return mode_;
+  }
+
+  //
+  // restart pacing, e.g. the pcap file is reopened.
+  //
+  void reset()
+  {
+    started_ = false;
+  }
+
+  //
+  // called before a matched packet is pushed. pkt_ns is its capture timestamp.
+  //
+  inline void wait(int64_t pkt_ns);
+
+private:
+
+  inline void waitTimestamp(int64_t pkt_ns);
+
+  PcapReplayMode mode_;
+  float rate_;
+  uint64_t usec_to_delay_;
+
+  // PCAP_REPLAY_TIMESTAMP
+  bool started_;
+  int64_t base_pkt_ns_;
+  int64_t prev_pkt_ns_;
+  std::chrono::steady_clock::time_point base_time_;
+};
+
+inline void PcapPacer::wait(int64_t pkt_ns)
+{
+  switch (mode_)
+  {
+    case PcapReplayMode::PCAP_REPLAY_FAST:
+      break;
+
+    case PcapReplayMode::PCAP_REPLAY_TIMESTAMP:
+      waitTimestamp(pkt_ns);
+      break;
+
+    case PcapReplayMode::PCAP_REPLAY_FIXED:
+    default:
+      std::this_thread::sleep_for(std::chrono::microseconds(usec_to_delay_));
+      break;
+  }
+}
+
+//
+// Sleep until an absolute deadline, i.e. base time + (capture timestamp - base timestamp) / rate.
+// Overshoot of one sleep is not accumulated to later packets.
+//
+inline void PcapPacer::waitTimestamp(int64_t pkt_ns)
+{
+  int64_t gap = pkt_ns - prev_pkt_ns_;
+  prev_pkt_ns_ = pkt_ns;
+
+  // rebase on the first packet, timestamp going back, or a long gap in capture.
+  if (!started_ || (gap < 0) || (gap > GAP_MAX_NS))
+  {
+    started_ = true;
+    base_pkt_ns_ = pkt_ns;
+    base_time_ = std::chrono::steady_clock::now();
+    return;
+  }
+
+  int64_t offset_ns = (int64_t)((double)(pkt_ns - base_pkt_ns_) / rate_);
+  std::chrono::steady_clock::time_point deadline = base_time_ + std::chrono::nanoseconds(offset_ns);
+  if (deadline > std::chrono::steady_clock::now())
+  {
+    std::this_thread::sleep_until(deadline);
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,746 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/common/rs_log.hpp>
+#include <rs_driver/driver/driver_param.hpp>
+#include <rs_driver/driver/input/pcap_stream.hpp>
+#include <rs_driver/utility/mapped_file.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// A record of pcap file. data points to the link-layer frame in the mapped file, or in the 
+// decompressed stream.
+//
+struct PcapRecord
+{
+  int64_t ts_ns;       // capture timestamp
+  uint32_t caplen;     // bytes in file
+  uint32_t len;        // bytes on wire
+  uint32_t link_type;  // link type of the interface
+  uint8_t* data;
+};
+
+//
+// Headers of a UDP packet in a frame. Only the first fragment of an IP packet has UDP header.
+//
+struct PcapUdp
+{
+  size_t ip_off;        // offset of IP header in frame
+  bool vlan;            // with VLAN tag(s)
+  bool more_frags;      // IP flag MF
+  uint16_t frag_off;    // offset of IP fragment, in bytes
+  uint16_t dst_port;    // 0 if not the first fragment
+  uint8_t* payload;     // UDP payload. NULL if not the first fragment
+  size_t payload_len;
+};
+
+//
+// Read pcap and pcapng files without libpcap. The file is mapped copy-on-write, so the decoder
+// may rewrite packets (e.g. timestamp) in place, without changing the file.
+//
+// With PCAP_READ_AHEAD, or if the file is compressed (gzip/zstd), it is read (and decompressed) by
+// PcapStream on a prefetch thread instead. Then a record is valid only until the next call of next(),
+// and seek() in a compressed file has to decompress from the beginning.
+//
+class PcapReader
+{
+public:
+
+  constexpr static uint32_t LINKTYPE_ETHERNET = 1;
+  constexpr static uint32_t LINKTYPE_LINUX_SLL = 113;
+
+  PcapReader()
+    : mem_(NULL), size_(0), off_(0), first_off_(0), pcapng_(false), swapped_(false), first_swapped_(false), 
+    nsec_(false), link_type_(0), last_ts_ns_(0)
+  {
+  }
+
+  ~PcapReader()
+  {
+    close();
+  }
+
+  PcapReader(const PcapReader&) = delete;
+  PcapReader& operator=(const PcapReader&) = delete;
+
+  bool open(const std::string& path, PcapReadMode mode = PcapReadMode::PCAP_READ_MMAP);
+  void close();
+
+  bool isOpen() const
+  {
+    return (mem_ != NULL) || (stream_ != nullptr);
+  }
+
+  //
+  // records are in the mapped file, and stay valid until close().
+  //
+  bool isMapped() const
+  {
+    return (mem_ != NULL);
+  }
+
+  //
+  // read the first record again.
+  //
+  inline void rewind();
+
+  //
+  // link type of the pcap file header, or of the last interface of pcapng file.
+  // Use PcapRecord::link_type, since interfaces of pcapng file may differ.
+  //
+  uint32_t linkType() const
+  {
+    return link_type_;
+  }
+
+  //
+  // offset of the next record, in the (decompressed) file.
+  //
+  size_t tell() const
+  {
+    return off_;
+  }
+
+  //
+  // read from the record at off, which is returned by tell() before.
+  //
+  inline bool seek(size_t off);
+
+  //
+  // return false at the end of file, or on a truncated or corrupted record.
+  //
+  inline bool next(PcapRecord& rec);
+
+  static inline bool parseUdp(uint32_t link_type, uint8_t* frame, size_t len, PcapUdp& udp);
+
+private:
+
+  //
+  // interface of pcapng file
+  //
+  struct PcapIface
+  {
+    uint32_t link_type;
+    bool tsresol_pow2;   // timestamp unit is 2^-tsresol second, or 10^-tsresol second
+    uint8_t tsresol;
+    int64_t tsoffset_ns;
+
+    inline int64_t toNs(uint64_t ts) const;
+  };
+
+  inline bool readFileHeader(const std::string& path);
+  inline bool nextPcap(PcapRecord& rec);
+  inline bool nextPcapng(PcapRecord& rec);
+  inline bool readSectionHeader(const uint8_t* blk_len);
+  inline void readIface(const uint8_t* body, size_t len);
+  inline bool skipBlocks(size_t off);
+
+  //
+  // a record is truncated or corrupted. Stay at it, if the file is mapped.
+  //
+  inline bool failRecord(size_t off)
+  {
+    if (stream_ == nullptr)
+      off_ = off;
+    return false;
+  }
+
+  //
+  // return n bytes at off_, and move off_ after them.
+  //
+  inline uint8_t* read(size_t n)
+  {
+    if (stream_ != nullptr)
+    {
+      uint8_t* p = stream_->read(n);
+      if (p != NULL)
+        off_ += n;
+      return p;
+    }
+
+    if (size_ - off_ < n)
+      return NULL;
+
+    uint8_t* p = mem_ + off_;
+    off_ += n;
+    return p;
+  }
+
+  inline bool skip(size_t n)
+  {
+    if (stream_ != nullptr)
+    {
+      if (!stream_->skip(n))
+        return false;
+    }
+    else if (size_ - off_ < n)
+    {
+      return false;
+    }
+
+    off_ += n;
+    return true;
+  }
+
+  inline uint32_t rd32(const uint8_t* p) const
+  {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped_ ? (((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v >> 8) & 0xFF00) | (v >> 24)) : v;
+  }
+
+  inline uint16_t rd16(const uint8_t* p) const
+  {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped_ ? (uint16_t)((v << 8) | (v >> 8)) : v;
+  }
+
+  inline uint64_t rd64(const uint8_t* p) const
+  {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    if (swapped_)
+    {
+      uint64_t r = 0;
+      for (size_t i = 0; i < sizeof(v); i++, v >>= 8)
+        r = (r << 8) | (v & 0xFF);
+      v = r;
+    }
+    return v;
+  }
+
+  static inline uint16_t rdBe16(const uint8_t* p)
+  {
+    return (uint16_t)((p[0] << 8) | p[1]);
+  }
+
+  constexpr static size_t FILE_HDR_LEN = 24;
+  constexpr static size_t REC_HDR_LEN = 16;
+
+  constexpr static uint32_t BLOCK_SHB = 0x0A0D0D0A;  // section header block
+  constexpr static uint32_t BLOCK_IDB = 1;           // interface description block
+  constexpr static uint32_t BLOCK_SPB = 3;           // simple packet block
+  constexpr static uint32_t BLOCK_EPB = 6;           // enhanced packet block
+  constexpr static uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+  constexpr static size_t BLOCK_HDR_LEN = 8;         // block type, block length
+  constexpr static size_t BLOCK_MIN_LEN = 12;        // and the trailing block length
+  constexpr static size_t SHB_MIN_LEN = 28;
+  constexpr static uint32_t MAX_CAPLEN = 262144;     // the largest snap length of libpcap
+  constexpr static uint32_t MAX_BLOCK_LEN = MAX_CAPLEN + 65536;  // a packet block with options
+
+  uint8_t* mem_;
+  size_t size_;
+  size_t off_;
+  size_t first_off_;
+  bool pcapng_;
+  bool swapped_;
+  bool first_swapped_;
+  bool nsec_;
+  uint32_t link_type_;
+  int64_t last_ts_ns_;
+  std::vector<PcapIface> ifaces_;
+  std::unique_ptr<PcapStream> stream_;
+  MappedFile file_;
+};
+
+inline bool PcapReader::open(const std::string& path, PcapReadMode mode)
+{
+  close();
+
+  if (!file_.map(path))
+    goto failMap;
+
+  mem_ = file_.data();
+  size_ = file_.size();
+
+  {
+    PcapStream::Codec codec = PcapStream::probe(mem_, size_);
+    if ((codec != PcapStream::CODEC_NONE) || (mode != PcapReadMode::PCAP_READ_MMAP))
+    {
+      close();
+
+      stream_.reset(new PcapStream);
+      if (!stream_->open(path, codec, (mode == PcapReadMode::PCAP_READ_AHEAD_DIRECT)))
+        goto failHeader;
+    }
+  }
+
+  if (!readFileHeader(path))
+    goto failHeader;
+
+  first_off_ = off_;
+  first_swapped_ = swapped_;
+  return true;
+
+failHeader:
+  close();
+failMap:
+  return false;
+}
+
+inline bool PcapReader::readFileHeader(const std::string& path)
+{
+  const uint8_t* p = read(sizeof(uint32_t));
+  if (p == NULL)
+    goto failMagic;
+
+  uint32_t magic;
+  memcpy(&magic, p, sizeof(magic));
+
+  if (magic == BLOCK_SHB)
+  {
+    pcapng_ = true;
+
+    p = read(sizeof(uint32_t));
+    if ((p == NULL) || !readSectionHeader(p))
+      goto failMagic;
+
+    return true;
+  }
+
+  switch (magic)
+  {
+    case 0xA1B2C3D4: swapped_ = false; nsec_ = false; break;
+    case 0xA1B23C4D: swapped_ = false; nsec_ = true;  break;
+    case 0xD4C3B2A1: swapped_ = true;  nsec_ = false; break;
+    case 0x4D3CB2A1: swapped_ = true;  nsec_ = true;  break;
+    default:
+      goto failMagic;
+  }
+
+  p = read(FILE_HDR_LEN - sizeof(magic));
+  if (p == NULL)
+    goto failMagic;
+
+  link_type_ = rd32(p + 16) & 0x0FFFFFFF;
+  if ((link_type_ != LINKTYPE_ETHERNET) && (link_type_ != LINKTYPE_LINUX_SLL))
+  {
+    RS_ERROR << "Unsupported link type " << link_type_ << " of pcap file: " << path << RS_REND;
+    return false;
+  }
+
+  return true;
+
+failMagic:
+  RS_ERROR << "Not a pcap file: " << path << RS_REND;
+  return false;
+}
+
+//
+// read the rest of section header block, after block type and block length. blk_len is not swapped 
+// yet, since byte order of the section is unknown.
+//
+inline bool PcapReader::readSectionHeader(const uint8_t* blk_len)
+{
+  uint32_t len;
+  memcpy(&len, blk_len, sizeof(len));
+
+  const uint8_t* p = read(sizeof(uint32_t));  // byte order magic
+  if (p == NULL)
+    return false;
+
+  uint32_t bom;
+  memcpy(&bom, p, sizeof(bom));
+  if (bom == BYTE_ORDER_MAGIC)
+    swapped_ = false;
+  else if (bom == 0x4D3C2B1A)
+    swapped_ = true;
+  else
+    return false;
+
+  len = rd32((const uint8_t*)&len);
+  if ((len < SHB_MIN_LEN) || ((len & 3) != 0) || !skip(len - BLOCK_MIN_LEN))
+    return false;
+
+  // interfaces are numbered within a section.
+  ifaces_.clear();
+  return true;
+}
+
+inline void PcapReader::readIface(const uint8_t* body, size_t len)
+{
+  PcapIface iface;
+  iface.link_type = rd16(body);
+  iface.tsresol_pow2 = false;
+  iface.tsresol = 6;
+  iface.tsoffset_ns = 0;
+
+  // options, after link type, reserved, snap length
+  for (size_t off = 8; off + 4 <= len; )
+  {
+    uint16_t code = rd16(body + off);
+    uint16_t opt_len = rd16(body + off + 2);
+    const uint8_t* val = body + off + 4;
+    if ((code == 0) || (off + 4 + opt_len > len))  // opt_endofopt
+      break;
+
+    if ((code == 9) && (opt_len >= 1))  // if_tsresol
+    {
+      iface.tsresol_pow2 = ((val[0] & 0x80) != 0);
+      iface.tsresol = (uint8_t)(val[0] & 0x7F);
+    }
+    else if ((code == 14) && (opt_len >= 8))  // if_tsoffset, in seconds
+    {
+      iface.tsoffset_ns = (int64_t)rd64(val) * 1000000000;
+    }
+
+    off += 4 + ((opt_len + 3) & ~3);
+  }
+
+  link_type_ = iface.link_type;
+  ifaces_.push_back(iface);
+}
+
+inline int64_t PcapReader::PcapIface::toNs(uint64_t ts) const
+{
+  static const uint64_t pow10[] = {1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 
+    10000000ull, 100000000ull, 1000000000ull};
+
+  int64_t ns;
+  if (!tsresol_pow2)
+  {
+    if (tsresol <= 9)
+      ns = (int64_t)(ts * pow10[9 - tsresol]);
+    else
+      ns = (int64_t)(ts / pow10[std::min(tsresol - 9, 9)]);
+  }
+  else
+  {
+    uint8_t shift = std::min<uint8_t>(tsresol, 63);
+    uint64_t frac = ts & ((1ull << shift) - 1);
+    uint8_t frac_shift = shift;
+    if (frac_shift > 30)
+    {
+      frac >>= (frac_shift - 30);
+      frac_shift = 30;
+    }
+
+    ns = (int64_t)((ts >> shift) * 1000000000ull + ((frac * 1000000000ull) >> frac_shift));
+  }
+
+  return ns + tsoffset_ns;
+}
+
+inline void PcapReader::close()
+{
+  file_.unmap();
+  mem_ = NULL;
+  size_ = 0;
+  stream_.reset();
+
+  off_ = first_off_ = 0;
+  pcapng_ = false;
+  ifaces_.clear();
+}
+
+inline void PcapReader::rewind()
+{
+  if (stream_ != nullptr)
+  {
+    stream_->restart(first_off_);
+  }
+
+  off_ = first_off_;
+  swapped_ = first_swapped_;
+  ifaces_.clear();
+}
+
+inline bool PcapReader::seek(size_t off)
+{
+  if (off < first_off_)
+    return false;
+
+  // records of pcapng file depend on the interfaces before. Walk through blocks.
+  if (pcapng_)
+  {
+    if (off < off_)
+      rewind();
+
+    return skipBlocks(off);
+  }
+
+  if (stream_ != nullptr)
+  {
+    // a compressed file is decompressed on the way.
+    if (stream_->seekable() || (off < off_))
+    {
+      off_ = off;
+      return stream_->restart(off);
+    }
+
+    return skip(off - off_);
+  }
+
+  if (off > size_)
+    return false;
+
+  off_ = off;
+  return true;
+}
+
+//
+// walk through blocks of pcapng file till off, and read section headers and interfaces on the way.
+//
+inline bool PcapReader::skipBlocks(size_t off)
+{
+  while (off_ < off)
+  {
+    const uint8_t* p = read(BLOCK_HDR_LEN);
+    if (p == NULL)
+      return false;
+
+    uint32_t blk_type = rd32(p);
+    if (blk_type == BLOCK_SHB)
+    {
+      if (!readSectionHeader(p + 4))
+        return false;
+      continue;
+    }
+
+    uint32_t blk_len = rd32(p + 4);
+    if ((blk_len < BLOCK_MIN_LEN) || ((blk_len & 3) != 0))
+      return false;
+
+    if (blk_type == BLOCK_IDB)
+    {
+      if (blk_len > MAX_BLOCK_LEN)
+        return false;
+
+      const uint8_t* body = read(blk_len - BLOCK_HDR_LEN);
+      if ((body == NULL) || (blk_len < BLOCK_MIN_LEN + 8))
+        return false;
+
+      readIface(body, blk_len - BLOCK_MIN_LEN);
+    }
+    else if (!skip(blk_len - BLOCK_HDR_LEN))
+    {
+      return false;
+    }
+  }
+
+  return (off_ == off);
+}
+
+inline bool PcapReader::next(PcapRecord& rec)
+{
+  return pcapng_ ? nextPcapng(rec) : nextPcap(rec);
+}
+
+inline bool PcapReader::nextPcap(PcapRecord& rec)
+{
+  size_t off = off_;
+
+  const uint8_t* hdr = read(REC_HDR_LEN);
+  if (hdr == NULL)
+    return false;
+
+  int64_t sec = rd32(hdr);
+  int64_t frac = rd32(hdr + 4);
+  uint32_t caplen = rd32(hdr + 8);
+  uint32_t len = rd32(hdr + 12);
+
+  // a corrupted length. Don't read (or spill in the stream) the rest of the file as one record.
+  if (caplen > MAX_CAPLEN)
+    return failRecord(off);
+
+  uint8_t* data = read(caplen);
+  if (data == NULL)
+    return failRecord(off);
+
+  rec.ts_ns = sec * 1000000000 + (nsec_ ? frac : frac * 1000);
+  rec.caplen = caplen;
+  rec.len = len;
+  rec.link_type = link_type_;
+  rec.data = data;
+  return true;
+}
+
+inline bool PcapReader::nextPcapng(PcapRecord& rec)
+{
+  while (1)
+  {
+    size_t off = off_;
+
+    const uint8_t* p = read(BLOCK_HDR_LEN);
+    if (p == NULL)
+      return false;
+
+    uint32_t blk_type = rd32(p);
+    if (blk_type == BLOCK_SHB)
+    {
+      if (!readSectionHeader(p + 4))
+        return failRecord(off);
+      continue;
+    }
+
+    uint32_t blk_len = rd32(p + 4);
+    if ((blk_len < BLOCK_MIN_LEN) || ((blk_len & 3) != 0))
+      return failRecord(off);
+
+    if ((blk_type != BLOCK_IDB) && (blk_type != BLOCK_EPB) && (blk_type != BLOCK_SPB))
+    {
+      if (!skip(blk_len - BLOCK_HDR_LEN))
+        return failRecord(off);
+      continue;
+    }
+
+    // blocks to skip may be large. Those to read are bounded.
+    if (blk_len > MAX_BLOCK_LEN)
+      return failRecord(off);
+
+    uint8_t* body = read(blk_len - BLOCK_HDR_LEN);
+    size_t body_len = blk_len - BLOCK_MIN_LEN;  // without the trailing block length
+    if (body == NULL)
+      return failRecord(off);
+
+    if (blk_type == BLOCK_IDB)
+    {
+      if (body_len < 8)
+        return failRecord(off);
+
+      readIface(body, body_len);
+    }
+    else if (blk_type == BLOCK_EPB)
+    {
+      if (body_len < 20)
+        return failRecord(off);
+
+      uint32_t if_id = rd32(body);
+      uint32_t caplen = rd32(body + 12);
+      if ((if_id >= ifaces_.size()) || (caplen > body_len - 20))
+        continue;
+
+      const PcapIface& iface = ifaces_[if_id];
+      uint64_t ts = ((uint64_t)rd32(body + 4) << 32) | rd32(body + 8);
+      rec.ts_ns = last_ts_ns_ = iface.toNs(ts);
+      rec.caplen = caplen;
+      rec.len = rd32(body + 16);
+      rec.link_type = iface.link_type;
+      rec.data = body + 20;
+      return true;
+    }
+    else
+    {
+      // simple packet block. It is from the first interface, and has no timestamp.
+      if ((body_len < 4) || ifaces_.empty())
+        continue;
+
+      uint32_t len = rd32(body);
+      rec.ts_ns = last_ts_ns_;
+      rec.caplen = std::min<uint32_t>(len, (uint32_t)(body_len - 4));
+      rec.len = len;
+      rec.link_type = ifaces_[0].link_type;
+      rec.data = body + 4;
+      return true;
+    }
+  }
+}
+
+inline bool PcapReader::parseUdp(uint32_t link_type, uint8_t* frame, size_t len, PcapUdp& udp)
+{
+  size_t off;
+  uint16_t eth_type;
+  if (link_type == LINKTYPE_ETHERNET)
+  {
+    if (len < 14)
+      return false;
+    eth_type = rdBe16(frame + 12);
+    off = 14;
+  }
+  else if (link_type == LINKTYPE_LINUX_SLL)
+  {
+    if (len < 16)
+      return false;
+    eth_type = rdBe16(frame + 14);
+    off = 16;
+  }
+  else
+  {
+    return false;
+  }
+
+  udp.vlan = false;
+  while ((eth_type == 0x8100) || (eth_type == 0x88A8))
+  {
+    if (len < off + 4)
+      return false;
+    eth_type = rdBe16(frame + off + 2);
+    off += 4;
+    udp.vlan = true;
+  }
+
+  if (eth_type != 0x0800)
+    return false;
+
+  // IPv4, UDP
+  const uint8_t* ip = frame + off;
+  if ((len < off + 20) || ((ip[0] >> 4) != 4) || (ip[9] != 17))
+    return false;
+
+  uint16_t frag = rdBe16(ip + 6);
+  udp.ip_off = off;
+  udp.more_frags = ((frag & 0x2000) != 0);
+  udp.frag_off = (uint16_t)((frag & 0x1FFF) * 8);
+  udp.dst_port = 0;
+  udp.payload = NULL;
+  udp.payload_len = 0;
+  if (udp.frag_off != 0)
+    return true;
+
+  size_t udp_off = off + (ip[0] & 0x0F) * 4;
+  if (len < udp_off + 8)
+    return false;
+
+  size_t avail = len - udp_off - 8;
+  size_t udp_len = rdBe16(frame + udp_off + 4);
+  udp.dst_port = rdBe16(frame + udp_off + 2);
+  udp.payload = frame + udp_off + 8;
+  udp.payload_len = ((udp_len >= 8) && (udp_len - 8 < avail)) ? (udp_len - 8) : avail;
+  return true;
+}
+
+}  // namespace lidar
+}  // namespace robosense
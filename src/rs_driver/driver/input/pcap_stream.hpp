@@ -0,0 +1,704 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/common/rs_log.hpp>
+#include <rs_driver/utility/spsc_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef ENABLE_PCAP_GZIP
+#include <zlib.h>
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+#include <zstd.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Read a capture file ahead on a prefetch thread, into a bounded ring of large blocks, and decompress 
+// it if it is compressed (.pcap.gz, .pcap.zst, ...). The consumer reads the bytes in order. 
+// A plain file can be restarted at any offset. A compressed one is decompressed from the beginning.
+//
+class PcapStream
+{
+public:
+
+  enum Codec
+  {
+    CODEC_NONE = 0,  // not compressed
+    CODEC_GZIP,
+    CODEC_ZSTD
+  };
+
+  //
+  // codec of a file by its leading bytes.
+  //
+  static inline Codec probe(const uint8_t* magic, size_t len);
+
+  PcapStream()
+    : codec_(CODEC_NONE), fd_(-1), direct_(false), to_exit_(false), filled_(BLOCK_NUM), free_(BLOCK_NUM),
+    in_pos_(0), in_len_(0), in_eof_(false), cur_(NULL), pos_(0), end_(false)
+#ifdef ENABLE_PCAP_ZSTD
+    , zstd_(NULL)
+#endif
+  {
+  }
+
+  ~PcapStream()
+  {
+    close();
+  }
+
+  PcapStream(const PcapStream&) = delete;
+  PcapStream& operator=(const PcapStream&) = delete;
+
+  //
+  // direct: read a plain file with O_DIRECT, if the file system supports it.
+  //
+  inline bool open(const std::string& path, Codec codec, bool direct = false);
+  inline void close();
+
+  //
+  // read from off again. 
+  //
+  inline bool restart(uint64_t off = 0);
+
+  //
+  // return n contiguous bytes, or NULL at the end of stream. They are valid until the next read().
+  //
+  inline uint8_t* read(size_t n)
+  {
+    if ((cur_ != NULL) && (cur_->size - pos_ >= n))
+    {
+      uint8_t* p = cur_->data + pos_;
+      pos_ += n;
+      return p;
+    }
+
+    return readSlow(n);
+  }
+
+  //
+  // skip n bytes. return false at the end of stream.
+  //
+  inline bool skip(size_t n);
+
+  //
+  // restart() at an offset is cheap.
+  //
+  bool seekable() const
+  {
+    return (codec_ == CODEC_NONE);
+  }
+
+private:
+
+  struct Block
+  {
+    std::vector<uint8_t> mem;
+    uint8_t* data;  // aligned for O_DIRECT
+    size_t cap;
+    size_t size;
+    bool last;      // end of stream, or an error
+  };
+
+  inline uint8_t* readSlow(size_t n);
+  inline Block* nextBlock();
+  inline void putBlock(Block* blk);
+
+  inline void startPrefetch();
+  inline void stopPrefetch();
+  inline void prefetch();
+  inline bool fill(Block* blk);
+  inline bool readBlock(Block* blk);
+
+  inline bool openFile(const std::string& path);
+  inline void closeFile();
+  inline bool seekFile(uint64_t off);
+  inline int64_t readFile(uint8_t* buf, size_t len);
+
+  inline bool initCodec();
+  inline void resetCodec();
+  inline void freeCodec();
+  inline bool decompress(Block* blk, size_t& produced);
+
+  constexpr static size_t BLOCK_BYTES = 1024 * 1024;
+  constexpr static size_t BLOCK_NUM = 16;
+  constexpr static size_t ALIGN = 4096;
+  constexpr static size_t IN_BYTES = 256 * 1024;
+  constexpr static unsigned int WAIT_USEC = 100000;
+
+  Codec codec_;
+  int fd_;
+  bool direct_;
+
+  // prefetch thread
+  std::thread thread_;
+  std::atomic<bool> to_exit_;
+  std::vector<std::unique_ptr<Block>> blocks_;
+  SpscQueue<Block*> filled_;
+  SpscQueue<Block*> free_;
+  std::vector<uint8_t> in_;
+  size_t in_pos_;
+  size_t in_len_;
+  bool in_eof_;
+
+  // consumer
+  Block* cur_;
+  size_t pos_;
+  bool end_;
+  std::vector<uint8_t> spill_;  // bytes across blocks
+
+#ifdef ENABLE_PCAP_GZIP
+  z_stream gzip_;
+#endif
+#ifdef ENABLE_PCAP_ZSTD
+  ZSTD_DStream* zstd_;
+#endif
+};
+
+inline PcapStream::Codec PcapStream::probe(const uint8_t* magic, size_t len)
+{
+  if ((len >= 2) && (magic[0] == 0x1F) && (magic[1] == 0x8B))
+    return CODEC_GZIP;
+
+  if ((len >= 4) && (magic[0] == 0x28) && (magic[1] == 0xB5) && (magic[2] == 0x2F) && (magic[3] == 0xFD))
+    return CODEC_ZSTD;
+
+  return CODEC_NONE;
+}
+
+inline bool PcapStream::open(const std::string& path, Codec codec, bool direct)
+{
+  close();
+
+  codec_ = codec;
+  direct_ = direct && (codec == CODEC_NONE);
+  if (!initCodec())
+    goto failCodec;
+
+  if (!openFile(path))
+    goto failOpen;
+
+  in_.resize((codec_ == CODEC_NONE) ? 0 : IN_BYTES);
+  blocks_.reserve(BLOCK_NUM);
+  for (size_t i = 0; i < BLOCK_NUM; i++)
+  {
+    Block* blk = new Block;
+    blk->mem.resize(BLOCK_BYTES + ALIGN);
+    blk->data = blk->mem.data() + ((ALIGN - ((uintptr_t)blk->mem.data() & (ALIGN - 1))) & (ALIGN - 1));
+    blk->cap = BLOCK_BYTES;
+    blocks_.emplace_back(blk);
+  }
+  spill_.reserve(64 * 1024);
+
+  startPrefetch();
+  return true;
+
+failOpen:
+  freeCodec();
+failCodec:
+  codec_ = CODEC_NONE;
+  return false;
+}
+
+inline void PcapStream::close()
+{
+  if (fd_ < 0)
+    return;
+
+  stopPrefetch();
+  closeFile();
+
+  freeCodec();
+  codec_ = CODEC_NONE;
+  blocks_.clear();
+}
+
+inline bool PcapStream::restart(uint64_t off)
+{
+  if (fd_ < 0)
+    return false;
+
+  stopPrefetch();
+
+  // a plain file is read from the aligned offset before off. A compressed one from the beginning.
+  uint64_t start = (codec_ == CODEC_NONE) ? (off & ~(uint64_t)(ALIGN - 1)) : 0;
+  if (!seekFile(start))
+    return false;
+
+  resetCodec();
+  startPrefetch();
+  return skip((size_t)(off - start));
+}
+
+inline void PcapStream::startPrefetch()
+{
+  filled_.clear();
+  free_.clear();
+  for (auto& blk : blocks_)
+  {
+    free_.push(blk.get());
+  }
+
+  in_pos_ = in_len_ = 0;
+  in_eof_ = false;
+
+  cur_ = NULL;
+  pos_ = 0;
+  end_ = false;
+  spill_.clear();
+
+  to_exit_ = false;
+  thread_ = std::thread(std::bind(&PcapStream::prefetch, this));
+}
+
+inline void PcapStream::stopPrefetch()
+{
+  to_exit_ = true;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+inline void PcapStream::prefetch()
+{
+  while (!to_exit_)
+  {
+    Block* blk = free_.popWait(WAIT_USEC);
+    if (blk == NULL)
+      continue;
+
+    bool last = !fill(blk);
+    filled_.push(blk);  // never full. There are only BLOCK_NUM blocks.
+
+    if (last)
+      break;
+  }
+}
+
+//
+// decompress into a whole block. return false at the end of stream, or on an error.
+//
+inline bool PcapStream::fill(Block* blk)
+{
+  blk->size = 0;
+  blk->last = false;
+
+  if (codec_ == CODEC_NONE)
+    return readBlock(blk);
+
+  while (blk->size < blk->cap)
+  {
+    if ((in_pos_ == in_len_) && !in_eof_)
+    {
+      int64_t ret = readFile(in_.data(), in_.size());
+      in_pos_ = 0;
+      in_len_ = (ret > 0) ? (size_t)ret : 0;
+      if (ret <= 0)
+      {
+        in_eof_ = true;
+      }
+    }
+
+    size_t produced = 0;
+    if (!decompress(blk, produced))
+    {
+      RS_ERROR << "Failed to decompress the pcap file." << RS_REND;
+      blk->last = true;
+      break;
+    }
+
+    if (in_eof_ && (produced == 0))
+    {
+      blk->last = true;
+      break;
+    }
+  }
+
+  return !blk->last;
+}
+
+//
+// read a plain file into a whole block. return false at the end of file, or on an error.
+//
+inline bool PcapStream::readBlock(Block* blk)
+{
+  while (blk->size < blk->cap)
+  {
+    int64_t ret = readFile(blk->data + blk->size, blk->cap - blk->size);
+    if (ret < 0)
+    {
+      RS_ERROR << "Failed to read the pcap file." << RS_REND;
+    }
+
+    if (ret <= 0)
+    {
+      blk->last = true;
+      break;
+    }
+
+    blk->size += (size_t)ret;
+  }
+
+  return !blk->last;
+}
+
+inline PcapStream::Block* PcapStream::nextBlock()
+{
+  if (end_)
+    return NULL;
+
+  Block* blk = NULL;
+  while (blk == NULL)
+  {
+    blk = filled_.popWait(WAIT_USEC);
+  }
+
+  end_ = blk->last;
+  if (blk->size == 0)
+  {
+    putBlock(blk);
+    return NULL;
+  }
+
+  return blk;
+}
+
+inline void PcapStream::putBlock(Block* blk)
+{
+  free_.push(blk);
+}
+
+inline uint8_t* PcapStream::readSlow(size_t n)
+{
+  spill_.clear();
+  if (cur_ != NULL)
+  {
+    spill_.insert(spill_.end(), cur_->data + pos_, cur_->data + cur_->size);
+    putBlock(cur_);
+    cur_ = NULL;
+  }
+
+  while (spill_.size() < n)
+  {
+    Block* blk = nextBlock();
+    if (blk == NULL)
+      return NULL;
+
+    if (spill_.empty() && (blk->size >= n))
+    {
+      // no copy if bytes are in one block.
+      cur_ = blk;
+      pos_ = n;
+      return blk->data;
+    }
+
+    size_t take = std::min(n - spill_.size(), blk->size);
+    spill_.insert(spill_.end(), blk->data, blk->data + take);
+
+    if (take < blk->size)
+    {
+      cur_ = blk;
+      pos_ = take;
+    }
+    else
+    {
+      putBlock(blk);
+    }
+  }
+
+  return spill_.data();
+}
+
+inline bool PcapStream::skip(size_t n)
+{
+  while (n > 0)
+  {
+    if ((cur_ == NULL) || (pos_ == cur_->size))
+    {
+      if (cur_ != NULL)
+      {
+        putBlock(cur_);
+      }
+
+      pos_ = 0;
+      cur_ = nextBlock();
+      if (cur_ == NULL)
+        return false;
+    }
+
+    size_t take = std::min(n, cur_->size - pos_);
+    pos_ += take;
+    n -= take;
+  }
+
+  return true;
+}
+
+inline bool PcapStream::initCodec()
+{
+  switch (codec_)
+  {
+    case CODEC_NONE:
+      return true;
+
+#ifdef ENABLE_PCAP_GZIP
+    case CODEC_GZIP:
+      memset(&gzip_, 0, sizeof(gzip_));
+      return (inflateInit2(&gzip_, 15 + 32) == Z_OK);  // gzip or zlib header
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+    case CODEC_ZSTD:
+      zstd_ = ZSTD_createDStream();
+      return (zstd_ != NULL) && !ZSTD_isError(ZSTD_initDStream(zstd_));
+#endif
+
+    default:
+      RS_ERROR << "Compressed pcap file is not supported. Build with " 
+        << ((codec_ == CODEC_ZSTD) ? "ENABLE_PCAP_ZSTD." : "ENABLE_PCAP_GZIP.") << RS_REND;
+      return false;
+  }
+}
+
+inline void PcapStream::resetCodec()
+{
+  switch (codec_)
+  {
+#ifdef ENABLE_PCAP_GZIP
+    case CODEC_GZIP:
+      inflateReset(&gzip_);
+      break;
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+    case CODEC_ZSTD:
+      ZSTD_initDStream(zstd_);
+      break;
+#endif
+
+    default:
+      break;
+  }
+}
+
+inline void PcapStream::freeCodec()
+{
+  switch (codec_)
+  {
+#ifdef ENABLE_PCAP_GZIP
+    case CODEC_GZIP:
+      inflateEnd(&gzip_);
+      break;
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+    case CODEC_ZSTD:
+      ZSTD_freeDStream(zstd_);
+      zstd_ = NULL;
+      break;
+#endif
+
+    default:
+      break;
+  }
+}
+
+//
+// decompress from in_ into the free space of blk. produced is the number of bytes decompressed.
+//
+inline bool PcapStream::decompress(Block* blk, size_t& produced)
+{
+  uint8_t* out = blk->data + blk->size;
+  size_t out_len = blk->cap - blk->size;
+
+  switch (codec_)
+  {
+#ifdef ENABLE_PCAP_GZIP
+    case CODEC_GZIP:
+    {
+      gzip_.next_in = in_.data() + in_pos_;
+      gzip_.avail_in = (uInt)(in_len_ - in_pos_);
+      gzip_.next_out = out;
+      gzip_.avail_out = (uInt)out_len;
+
+      int ret = inflate(&gzip_, Z_NO_FLUSH);
+      in_pos_ = in_len_ - gzip_.avail_in;
+      produced = out_len - gzip_.avail_out;
+
+      if (ret == Z_STREAM_END)
+      {
+        inflateReset(&gzip_);  // more members may follow
+      }
+      else if ((ret != Z_OK) && (ret != Z_BUF_ERROR))
+      {
+        return false;
+      }
+      break;
+    }
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+    case CODEC_ZSTD:
+    {
+      ZSTD_inBuffer in = {in_.data() + in_pos_, in_len_ - in_pos_, 0};
+      ZSTD_outBuffer dst = {out, out_len, 0};
+
+      size_t ret = ZSTD_decompressStream(zstd_, &dst, &in);
+      if (ZSTD_isError(ret))
+        return false;
+
+      in_pos_ += in.pos;
+      produced = dst.pos;
+      break;
+    }
+#endif
+
+    default:
+      (void)out;
+      (void)out_len;
+      return false;
+  }
+
+  blk->size += produced;
+  return true;
+}
+
+#ifdef _WIN32
+
+inline bool PcapStream::openFile(const std::string& path)
+{
+  fd_ = _open(path.c_str(), _O_RDONLY | _O_BINARY | _O_SEQUENTIAL);
+  return (fd_ >= 0);
+}
+
+inline void PcapStream::closeFile()
+{
+  _close(fd_);
+  fd_ = -1;
+}
+
+inline bool PcapStream::seekFile(uint64_t off)
+{
+  return (_lseeki64(fd_, (__int64)off, SEEK_SET) >= 0);
+}
+
+inline int64_t PcapStream::readFile(uint8_t* buf, size_t len)
+{
+  return _read(fd_, buf, (unsigned int)std::min<size_t>(len, 0x40000000));
+}
+
+#else
+
+inline bool PcapStream::openFile(const std::string& path)
+{
+  int flags = O_RDONLY;
+#ifdef O_DIRECT
+  if (direct_)
+    flags |= O_DIRECT;
+#endif
+
+  fd_ = ::open(path.c_str(), flags);
+  if ((fd_ < 0) && direct_)
+  {
+    RS_WARNING << "Failed to open the pcap file with O_DIRECT. Read it through page cache." << RS_REND;
+    direct_ = false;
+    fd_ = ::open(path.c_str(), O_RDONLY);
+  }
+
+  if (fd_ < 0)
+    return false;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  if (!direct_)
+  {
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+#endif
+
+  return true;
+}
+
+inline void PcapStream::closeFile()
+{
+  ::close(fd_);
+  fd_ = -1;
+}
+
+inline bool PcapStream::seekFile(uint64_t off)
+{
+  return (lseek(fd_, (off_t)off, SEEK_SET) >= 0);
+}
+
+inline int64_t PcapStream::readFile(uint8_t* buf, size_t len)
+{
+  while (1)
+  {
+    ssize_t ret = ::read(fd_, buf, len);
+    if ((ret < 0) && (errno == EINTR))
+      continue;
+
+    return (int64_t)ret;
+  }
+}
+
+#endif
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,298 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/input/pcap_pacer.hpp>
+#include <rs_driver/driver/input/pcap_reader.hpp>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// A pcap input replayed by PcapSyncGroup. Its methods are called on the thread of the group.
+//
+class PcapSyncSource
+{
+public:
+
+  //
+  // read the next MSOP/DIFOP packet. return false at the end of file (or range).
+  //
+  virtual bool syncNext(PcapRecord& rec, size_t& data_off, size_t& data_size) = 0;
+
+  //
+  // hand the packet to the decoder. rec is from the last syncNext().
+  //
+  virtual void syncPut(const PcapRecord& rec, size_t data_off, size_t data_size) = 0;
+
+  //
+  // reach the end. If repeat is true, rewind to replay again.
+  //
+  virtual void syncEnd(bool repeat) = 0;
+
+  virtual ~PcapSyncSource()
+  {
+  }
+};
+
+//
+// Replay pcap files of a multi-LiDAR capture in sync. Drivers with the same pcap_sync_group share 
+// a group. It merges their packets by capture timestamp with a k-way heap, and paces them with one
+// PcapPacer, on one thread. Replay starts when pcap_sync_num sources are started.
+//
+class PcapSyncGroup
+{
+public:
+
+  //
+  // the group of param.pcap_sync_group. It is created by the first source.
+  //
+  static inline std::shared_ptr<PcapSyncGroup> join(const RSInputParam& param);
+
+  PcapSyncGroup(const RSInputParam& param);
+
+  ~PcapSyncGroup()
+  {
+    stopReplay();
+  }
+
+  //
+  // add a started source. Replay starts when all sources are added. 
+  // A source added later, e.g. a restarted driver, joins the replay.
+  //
+  inline void start(PcapSyncSource* src);
+
+  //
+  // remove a source. The others go on.
+  //
+  inline void stop(PcapSyncSource* src);
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  struct Member
+  {
+    PcapSyncSource* src;
+    bool pending;  // rec is read, but not put yet
+    PcapRecord rec;
+    size_t data_off;
+    size_t data_size;
+  };
+
+  inline void startReplay();
+  inline void stopReplay();
+  inline void replay();
+
+  std::string name_;
+  uint16_t num_;
+  PcapReplayMode mode_;
+  bool repeat_;
+  PcapPacer pacer_;
+
+  std::mutex mtx_;
+  std::vector<Member> members_;
+  bool replaying_;
+  std::thread thread_;
+  std::atomic<bool> to_exit_;
+};
+
+inline std::shared_ptr<PcapSyncGroup> PcapSyncGroup::join(const RSInputParam& param)
+{
+  static std::mutex mtx;
+  static std::map<std::string, std::weak_ptr<PcapSyncGroup>> groups;
+
+  std::lock_guard<std::mutex> lg(mtx);
+
+  std::shared_ptr<PcapSyncGroup> group = groups[param.pcap_sync_group].lock();
+  if (group == nullptr)
+  {
+    group = std::make_shared<PcapSyncGroup>(param);
+    groups[param.pcap_sync_group] = group;
+  }
+  else if ((group->num_ != param.pcap_sync_num) || (group->mode_ != param.pcap_replay_mode))
+  {
+    RS_WARNING << "pcap_sync_num/pcap_replay_mode differs in pcap sync group " << param.pcap_sync_group 
+      << ". Use those of the first driver." << RS_REND;
+  }
+
+  return group;
+}
+
+//
+// PCAP_REPLAY_FIXED paces packets of one LiDAR. A group is paced by capture timestamps instead.
+//
+inline PcapSyncGroup::PcapSyncGroup(const RSInputParam& param)
+  : name_(param.pcap_sync_group), num_(param.pcap_sync_num), mode_(param.pcap_replay_mode), repeat_(param.pcap_repeat), 
+  pacer_((param.pcap_replay_mode == PcapReplayMode::PCAP_REPLAY_FAST) ? 
+      PcapReplayMode::PCAP_REPLAY_FAST : PcapReplayMode::PCAP_REPLAY_TIMESTAMP, 0.0, param.pcap_rate),
+  replaying_(false), to_exit_(false)
+{
+}
+
+inline void PcapSyncGroup::start(PcapSyncSource* src)
+{
+  std::lock_guard<std::mutex> lg(mtx_);
+
+  // replay() refers to members_. Stop it before changing members_. 
+  // This also joins the thread if it has ended at the end of files.
+  stopReplay();
+
+  members_.push_back(Member{src, false, PcapRecord(), 0, 0});
+  if (members_.size() >= num_)
+  {
+    replaying_ = true;
+  }
+
+  if (replaying_)
+  {
+    startReplay();
+  }
+}
+
+inline void PcapSyncGroup::stop(PcapSyncSource* src)
+{
+  std::lock_guard<std::mutex> lg(mtx_);
+
+  stopReplay();
+
+  for (auto it = members_.begin(); it != members_.end(); it++)
+  {
+    if (it->src == src)
+    {
+      members_.erase(it);
+      break;
+    }
+  }
+
+  if (replaying_ && !members_.empty())
+  {
+    startReplay();
+  }
+}
+
+inline void PcapSyncGroup::startReplay()
+{
+  // pace from the next packet, instead of catching up the time it was stopped.
+  pacer_.reset();
+  to_exit_ = false;
+  thread_ = std::thread(std::bind(&PcapSyncGroup::replay, this));
+}
+
+inline void PcapSyncGroup::stopReplay()
+{
+  to_exit_ = true;
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+inline void PcapSyncGroup::replay()
+{
+  // the earliest packet first. Ties go by member order, so the replay is deterministic.
+  typedef std::pair<int64_t, size_t> Entry;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+  for (size_t i = 0; i < members_.size(); i++)
+  {
+    Member& m = members_[i];
+    if (!m.pending)
+    {
+      m.pending = m.src->syncNext(m.rec, m.data_off, m.data_size);
+    }
+
+    if (m.pending)
+    {
+      heap.push(Entry(m.rec.ts_ns, i));
+    }
+  }
+
+  while (!to_exit_)
+  {
+    if (heap.empty())  // all files end.
+    {
+      if (!repeat_)
+        break;
+
+      pacer_.reset();
+      for (size_t i = 0; i < members_.size(); i++)
+      {
+        Member& m = members_[i];
+        m.src->syncEnd(true);
+
+        m.pending = m.src->syncNext(m.rec, m.data_off, m.data_size);
+        if (m.pending)
+        {
+          heap.push(Entry(m.rec.ts_ns, i));
+        }
+      }
+
+      if (heap.empty())
+        break;
+      continue;
+    }
+
+    size_t i = heap.top().second;
+    heap.pop();
+
+    Member& m = members_[i];
+    pacer_.wait(m.rec.ts_ns);
+    m.src->syncPut(m.rec, m.data_off, m.data_size);
+
+    m.pending = m.src->syncNext(m.rec, m.data_off, m.data_size);
+    if (m.pending)
+    {
+      heap.push(Entry(m.rec.ts_ns, i));
+    }
+    else if (!repeat_)
+    {
+      m.src->syncEnd(false);
+    }
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
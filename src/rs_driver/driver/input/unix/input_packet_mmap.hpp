@@ -0,0 +1,506 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/input/input.hpp>
+
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Receive MSOP/DIFOP packets with an AF_PACKET socket and a TPACKET_V3 ring.
+//
+// The kernel filters packets with a BPF program on UDP destination ports, and fills
+// them into ring blocks. Packets are handed to the decoder as views on the ring. A block
+// goes back to the kernel when all its views are recycled.
+//
+class InputPacketMmap : public Input, public BufferRecycler
+{
+public:
+  InputPacketMmap(const RSInputParam& input_param)
+    : Input(input_param), fd_(-1), ring_(NULL), blk_idx_(0),
+      pkt_offset_(ETH_HDR_LEN), pkt_tail_(0)
+  {
+    pkt_offset_ += input_param.user_layer_bytes;
+    pkt_tail_   += input_param.tail_layer_bytes;
+  }
+
+  virtual bool init();
+  virtual bool start();
+  virtual void recycle(Buffer* pkt);
+  virtual ~InputPacketMmap();
+
+private:
+  inline void recvPacket();
+  inline void walkBlock(uint32_t blk);
+  inline void putBlock(uint32_t blk);
+  inline int createSocket();
+  inline bool attachFilter(int fd);
+
+  constexpr static uint32_t BLOCK_SIZE = (1 << 20);
+  constexpr static uint32_t BLOCK_NUM = 16;
+  constexpr static uint32_t FRAME_SIZE = 2048;
+  constexpr static uint32_t FRAME_NUM = (BLOCK_SIZE / FRAME_SIZE) * BLOCK_NUM;
+  constexpr static uint32_t BLOCK_TIMEOUT_MS = 2;
+
+protected:
+  int fd_;
+  uint8_t* ring_;
+  uint32_t blk_idx_;
+  size_t pkt_offset_;
+  size_t pkt_tail_;
+  std::vector<std::atomic<uint32_t>> blk_refs_;
+  std::vector<std::atomic<bool>> blk_held_;
+  std::vector<std::unique_ptr<Buffer>> views_;
+  std::vector<Buffer*> free_views_;
+  std::mutex views_mtx_;
+};
+
+inline bool InputPacketMmap::init()
+{
+  if (init_flag_)
+  {
+    return true;
+  }
+
+  int fd = createSocket();
+  if (fd < 0)
+    goto failSocket;
+
+  {
+    void* ring = mmap(NULL, (size_t)BLOCK_SIZE * BLOCK_NUM, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+      perror("mmap: ");
+      goto failMmap;
+    }
+
+    ring_ = (uint8_t*)ring;
+  }
+
+  {
+    std::vector<std::atomic<uint32_t>> refs(BLOCK_NUM);
+    std::vector<std::atomic<bool>> held(BLOCK_NUM);
+    blk_refs_.swap(refs);
+    blk_held_.swap(held);
+    for (uint32_t i = 0; i < BLOCK_NUM; i++)
+    {
+      blk_refs_[i] = 0;
+      blk_held_[i] = false;
+    }
+
+    views_.reserve(FRAME_NUM);
+    free_views_.reserve(FRAME_NUM);
+    for (uint32_t i = 0; i < FRAME_NUM; i++)
+    {
+      views_.emplace_back(new Buffer(static_cast<BufferRecycler*>(this)));
+      free_views_.push_back(views_.back().get());
+    }
+  }
+
+  fd_ = fd;
+
+  init_flag_ = true;
+  return true;
+
+failMmap:
+  close(fd);
+failSocket:
+  return false;
+}
+
+inline bool InputPacketMmap::start()
+{
+  if (start_flag_)
+  {
+    return true;
+  }
+
+  if (!init_flag_)
+  {
+    cb_excep_(Error(ERRCODE_STARTBEFOREINIT));
+    return false;
+  }
+
+  to_exit_recv_ = false;
+  recv_thread_ = std::thread(std::bind(&InputPacketMmap::recvPacket, this));
+
+  start_flag_ = true;
+  return true;
+}
+
+inline InputPacketMmap::~InputPacketMmap()
+{
+  stop();
+
+  if (ring_ != NULL)
+  {
+    munmap(ring_, (size_t)BLOCK_SIZE * BLOCK_NUM);
+    close(fd_);
+  }
+}
+
+inline bool InputPacketMmap::attachFilter(int fd)
+{
+  //
+  // IPv4 && UDP && !fragment && (udp dst port msop || udp dst port difop),
+  // with or without VLAN tag.
+  //
+  // jump targets are absolute indexes, or one of the labels below.
+  //
+  constexpr int NEXT = -1;
+  constexpr int ACCEPT = -2;
+  constexpr int DROP = -3;
+
+  struct Insn
+  {
+    uint16_t code;
+    uint32_t k;
+    int jt;
+    int jf;
+  };
+
+  std::vector<Insn> insns;
+
+  auto genMatch = [&](uint32_t off)
+  {
+    insns.push_back({BPF_LD | BPF_H | BPF_ABS, off + 12, 0, 0});                  // ether type
+    insns.push_back({BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, NEXT, DROP});
+    insns.push_back({BPF_LD | BPF_B | BPF_ABS, off + 23, 0, 0});                  // ip protocol
+    insns.push_back({BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, NEXT, DROP});
+    insns.push_back({BPF_LD | BPF_H | BPF_ABS, off + 20, 0, 0});                  // fragment offset
+    insns.push_back({BPF_JMP | BPF_JSET | BPF_K, 0x1FFF, DROP, NEXT});
+    insns.push_back({BPF_LD | BPF_H | BPF_ABS, off + 36, 0, 0});                  // udp dst port
+    insns.push_back({BPF_JMP | BPF_JEQ | BPF_K, input_param_.msop_port, ACCEPT, NEXT});
+    insns.push_back({BPF_JMP | BPF_JEQ | BPF_K, input_param_.difop_port, ACCEPT, DROP});
+  };
+
+  if (input_param_.use_vlan)
+  {
+    insns.push_back({BPF_LD | BPF_H | BPF_ABS, 12, 0, 0});
+    insns.push_back({BPF_JMP | BPF_JEQ | BPF_K, ETH_P_8021Q, 0, NEXT});
+
+    size_t vlan_jmp = insns.size() - 1;
+    genMatch(0);
+    insns[vlan_jmp].jt = (int)insns.size();
+    genMatch(VLAN_HDR_LEN);
+  }
+  else
+  {
+    genMatch(0);
+  }
+
+  int accept = (int)insns.size();
+  insns.push_back({BPF_RET | BPF_K, 0x40000, 0, 0});
+  int drop = (int)insns.size();
+  insns.push_back({BPF_RET | BPF_K, 0, 0, 0});
+
+  auto offset = [&](int i, int target) -> uint8_t
+  {
+    if (target == NEXT)
+      return 0;
+
+    if (target == ACCEPT)
+      target = accept;
+    else if (target == DROP)
+      target = drop;
+
+    return (uint8_t)(target - i - 1);
+  };
+
+  std::vector<struct sock_filter> code(insns.size());
+  for (size_t i = 0; i < insns.size(); i++)
+  {
+    code[i].code = insns[i].code;
+    code[i].k = insns[i].k;
+    code[i].jt = 0;
+    code[i].jf = 0;
+
+    if (BPF_CLASS(insns[i].code) == BPF_JMP)
+    {
+      code[i].jt = offset((int)i, insns[i].jt);
+      code[i].jf = offset((int)i, insns[i].jf);
+    }
+  }
+
+  struct sock_fprog prog;
+  prog.len = (unsigned short)code.size();
+  prog.filter = code.data();
+
+  int ret = setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+  if (ret < 0)
+  {
+    perror("setsockopt(SO_ATTACH_FILTER): ");
+    return false;
+  }
+
+  return true;
+}
+
+inline int InputPacketMmap::createSocket()
+{
+  int fd;
+  int ret;
+
+  //
+  // protocol 0 receives nothing until bind(), so no packet passes by the filter.
+  //
+  fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (fd < 0)
+  {
+    perror("socket(AF_PACKET): ");
+    goto failSocket;
+  }
+
+  if (!attachFilter(fd))
+    goto failOption;
+
+  {
+    int ver = TPACKET_V3;
+    ret = setsockopt(fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver));
+    if (ret < 0)
+    {
+      perror("setsockopt(PACKET_VERSION): ");
+      goto failOption;
+    }
+  }
+
+#ifdef PACKET_IGNORE_OUTGOING
+  {
+    int ignore = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &ignore, sizeof(ignore));
+  }
+#endif
+
+  {
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = BLOCK_SIZE;
+    req.tp_block_nr = BLOCK_NUM;
+    req.tp_frame_size = FRAME_SIZE;
+    req.tp_frame_nr = FRAME_NUM;
+    req.tp_retire_blk_tov = BLOCK_TIMEOUT_MS;
+    ret = setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+    if (ret < 0)
+    {
+      perror("setsockopt(PACKET_RX_RING): ");
+      goto failOption;
+    }
+  }
+
+  {
+    struct sockaddr_ll ll;
+    memset(&ll, 0, sizeof(ll));
+    ll.sll_family = AF_PACKET;
+    ll.sll_protocol = htons(ETH_P_ALL);
+    ll.sll_ifindex = 0;
+    if (!input_param_.device_name.empty())
+    {
+      ll.sll_ifindex = (int)if_nametoindex(input_param_.device_name.c_str());
+      if (ll.sll_ifindex == 0)
+      {
+        perror("if_nametoindex: ");
+        goto failBind;
+      }
+    }
+
+    ret = bind(fd, (struct sockaddr*)&ll, sizeof(ll));
+    if (ret < 0)
+    {
+      perror("bind: ");
+      goto failBind;
+    }
+  }
+
+  return fd;
+
+failBind:
+failOption:
+  close(fd);
+failSocket:
+  return -1;
+}
+
+inline void InputPacketMmap::recycle(Buffer* pkt)
+{
+  uint32_t blk = (uint32_t)((pkt->buf() - ring_) / BLOCK_SIZE);
+
+  {
+    std::lock_guard<std::mutex> lg(views_mtx_);
+    free_views_.push_back(pkt);
+  }
+
+  if (blk_refs_[blk].fetch_sub(1) == 1)
+  {
+    putBlock(blk);
+  }
+}
+
+inline void InputPacketMmap::putBlock(uint32_t blk)
+{
+  struct tpacket_block_desc* desc = (struct tpacket_block_desc*)(ring_ + (size_t)blk * BLOCK_SIZE);
+
+  __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+  blk_held_[blk].store(false, std::memory_order_release);
+}
+
+inline void InputPacketMmap::walkBlock(uint32_t blk)
+{
+  struct tpacket_block_desc* desc = (struct tpacket_block_desc*)(ring_ + (size_t)blk * BLOCK_SIZE);
+
+  // one extra reference while walking, so the block is not put back half way.
+  blk_held_[blk] = true;
+  blk_refs_[blk] = 1;
+
+  uint32_t num = desc->hdr.bh1.num_pkts;
+  uint8_t* p = (uint8_t*)desc + desc->hdr.bh1.offset_to_first_pkt;
+
+  for (uint32_t i = 0; i < num; i++)
+  {
+    struct tpacket3_hdr* hdr = (struct tpacket3_hdr*)p;
+    struct sockaddr_ll* ll = (struct sockaddr_ll*)(p + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+    uint8_t* frame = p + hdr->tp_mac;
+    size_t len = hdr->tp_snaplen;
+
+    p += hdr->tp_next_offset;
+
+    if (ll->sll_pkttype == PACKET_OUTGOING)
+      continue;
+
+    size_t offset = pkt_offset_;
+    if (input_param_.use_vlan && (len > 14) && (frame[12] == 0x81) && (frame[13] == 0x00))
+    {
+      offset += VLAN_HDR_LEN;
+    }
+
+    if (len <= offset + pkt_tail_)
+      continue;
+
+    uint64_t ts = input_param_.sock_timestamp ? ((uint64_t)hdr->tp_sec * 1000000000 + hdr->tp_nsec) : 0;
+
+    Buffer* pkt = NULL;
+    {
+      std::lock_guard<std::mutex> lg(views_mtx_);
+      if (!free_views_.empty())
+      {
+        pkt = free_views_.back();
+        free_views_.pop_back();
+      }
+    }
+
+    if (pkt != NULL)
+    {
+      pkt->ref();
+      pkt->attach(frame, len);
+      pkt->setData(offset, len - offset - pkt_tail_);
+      blk_refs_[blk]++;
+    }
+    else
+    {
+      // out of views. copy it.
+      pkt = getPacket(ETH_LEN);
+      memcpy(pkt->data(), frame + offset, len - offset - pkt_tail_);
+      pkt->setData(0, len - offset - pkt_tail_);
+    }
+
+    pkt->setTimestamp(ts);
+    pushPacket(pkt);
+  }
+
+  if (blk_refs_[blk].fetch_sub(1) == 1)
+  {
+    putBlock(blk);
+  }
+}
+
+inline void InputPacketMmap::recvPacket()
+{
+  while (!to_exit_recv_)
+  {
+    struct tpacket_block_desc* desc = (struct tpacket_block_desc*)(ring_ + (size_t)blk_idx_ * BLOCK_SIZE);
+
+    // still held by the decoder since last round
+    if (blk_held_[blk_idx_].load(std::memory_order_acquire))
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      continue;
+    }
+
+    if ((__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+    {
+      struct pollfd pfd;
+      pfd.fd = fd_;
+      pfd.events = POLLIN | POLLERR;
+      pfd.revents = 0;
+
+      int retval = poll(&pfd, 1, 1000);
+      if (retval == 0)
+      {
+        cb_excep_(Error(ERRCODE_MSOPTIMEOUT));
+      }
+      else if (retval < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        perror("poll: ");
+        break;
+      }
+
+      continue;
+    }
+
+    walkBlock(blk_idx_);
+    blk_idx_ = (blk_idx_ + 1) % BLOCK_NUM;
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -33,24 +33,39 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include <rs_driver/driver/input/input.hpp>
+#include <rs_driver/driver/input/unix/sock_reactor.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <arpa/inet.h>
+#include <netinet/udp.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/epoll.h>
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
 namespace robosense
 {
 namespace lidar
 {
-class InputSock : public Input
+//
+// With sock_reactor_group, the sockets are received by the thread of SockReactor, with other drivers.
+//
+class InputSock : public Input, public SockReactorSource, public BufferRecycler
 {
 public:
   InputSock(const RSInputParam& input_param)
     : Input(input_param), pkt_buf_len_(ETH_LEN), 
-      sock_offset_(0), sock_tail_(0)
+      sock_offset_(0), sock_tail_(0), gro_(false), recv_syscalls_(0), recv_pkts_(0)
   {
     sock_offset_ += input_param.user_layer_bytes;
     sock_tail_   += input_param.tail_layer_bytes;
@@ -58,18 +73,87 @@ public:
 
   virtual bool init();
   virtual bool start();
+  virtual void stop();
   virtual ~InputSock();
 
-private:
+  virtual bool reactorRecv(int fd)
+  {
+    if (gro_)
+    {
+      return (recvGro(fd) >= 0);
+    }
+
+    return (((batch_pkts_.size() > 1) ? recvBatch(fd) : recvOne(fd)) >= 0);
+  }
+
+  virtual void reactorTimeout()
+  {
+    cb_excep_(Error(ERRCODE_MSOPTIMEOUT));
+  }
+
+  virtual void recycle(Buffer* pkt);
+
+protected:
   inline void recvPacket();
+  inline void initBatch();
+  inline void endRecv();
+  static inline uint64_t cmsgTimestamp(struct msghdr* msg);
+
+  // control messages of a datagram: UDP_GRO segment size, and SO_TIMESTAMPNS arrival time.
+  constexpr static size_t CTRL_LEN = CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(struct timespec));
+
+private:
+  //
+  // a packet in a datagram coalesced by UDP_GRO, as a view on the buffer of the datagram.
+  //
+  struct SegmentView : public Buffer
+  {
+    SegmentView(BufferRecycler* recycler)
+      : Buffer(recycler), parent(NULL)
+    {
+    }
+
+    Buffer* parent;
+  };
+
+  inline ssize_t recvOne(int fd);
+  inline ssize_t recvBatch(int fd);
+  inline ssize_t recvGro(int fd);
+  inline bool initGro();
+  inline void putSegment(Buffer* gro_pkt, size_t off, size_t len, uint64_t ts);
+  inline SegmentView* getView();
   inline int createSocket(uint16_t port, const std::string& hostIp, const std::string& grpIp);
 
+  constexpr static size_t GRO_BUF_NUM = 32;    // coalesced datagrams in use, by the decoder or the queue
+  constexpr static size_t GRO_VIEW_NUM = 1024;
+
 protected:
   size_t pkt_buf_len_;
   int epfd_;
   int fds_[2];
   size_t sock_offset_;
   size_t sock_tail_;
+  std::shared_ptr<SockReactor> reactor_;
+
+  //
+  // recvmmsg() batch. slots keep their buffers until a packet is received into them.
+  //
+  std::vector<Buffer*> batch_pkts_;
+  std::vector<struct mmsghdr> batch_msgs_;
+  std::vector<struct iovec> batch_iovs_;
+  std::vector<uint8_t> batch_ctrls_;
+
+  //
+  // UDP_GRO. A coalesced datagram is received into a buffer of gro_pool_, and split into views on it.
+  //
+  bool gro_;
+  BufferPool gro_pool_;
+  std::vector<std::unique_ptr<SegmentView>> gro_views_;
+  std::vector<SegmentView*> free_views_;
+  std::mutex views_mtx_;
+
+  uint64_t recv_syscalls_;
+  uint64_t recv_pkts_;
 };
 
 inline bool InputSock::init()
@@ -79,6 +163,11 @@ inline bool InputSock::init()
     return true;
   }
 
+  if (input_param_.sock_udp_gro)
+  {
+    gro_ = initGro();
+  }
+
   int msop_fd = -1, difop_fd = -1;
   int epfd = epoll_create(1);
   if (epfd < 0)
@@ -117,6 +206,11 @@ inline bool InputSock::init()
   fds_[0] = msop_fd;
   fds_[1] = difop_fd;
 
+  if (!input_param_.sock_reactor_group.empty())
+  {
+    reactor_ = SockReactor::join(input_param_);
+  }
+
   init_flag_ = true;
   return true;
 
@@ -141,13 +235,39 @@ inline bool InputSock::start()
     return false;
   }
 
-  to_exit_recv_ = false;
-  recv_thread_ = std::thread(std::bind(&InputSock::recvPacket, this));
+  initBatch();
+
+  if (reactor_ != nullptr)
+  {
+    if (!reactor_->start(this, fds_, (fds_[1] >= 0) ? 2 : 1))
+    {
+      endRecv();
+      return false;
+    }
+  }
+  else
+  {
+    to_exit_recv_ = false;
+    recv_thread_ = std::thread(std::bind(&InputSock::recvPacket, this));
+  }
 
   start_flag_ = true;
   return true;
 }
 
+inline void InputSock::stop()
+{
+  if (start_flag_ && (reactor_ != nullptr))
+  {
+    reactor_->stop(this);
+    endRecv();
+    start_flag_ = false;
+    return;
+  }
+
+  Input::stop();
+}
+
 inline InputSock::~InputSock()
 {
   stop();
@@ -216,6 +336,28 @@ inline int InputSock::createSocket(uint16_t port, const std::string& hostIp, con
     }
   }
 
+  if (gro_)
+  {
+    int on = 1;
+    ret = setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on));
+    if (ret < 0)
+    {
+      perror("setsockopt(UDP_GRO): ");
+      goto failGro;
+    }
+  }
+
+  if (input_param_.sock_timestamp)
+  {
+    int on = 1;
+    ret = setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    if (ret < 0)
+    {
+      perror("setsockopt(SO_TIMESTAMPNS): ");
+      goto failTimestamp;
+    }
+  }
+
   {
     int flags = fcntl(fd, F_GETFL, 0);
     ret = fcntl(fd, F_SETFL, flags | O_NONBLOCK);
@@ -229,6 +371,8 @@ inline int InputSock::createSocket(uint16_t port, const std::string& hostIp, con
   return fd;
 
 failNonBlock:
+failTimestamp:
+failGro:
 failGroup:
 failBind:
 failOption:
@@ -237,6 +381,329 @@ failSocket:
   return -1;
 }
 
+inline ssize_t InputSock::recvOne(int fd)
+{
+  Buffer* pkt = getPacket(pkt_buf_len_);
+
+  struct iovec iov;
+  iov.iov_base = pkt->buf();
+  iov.iov_len = pkt->bufSize();
+
+  union
+  {
+    char buf[CTRL_LEN];
+    struct cmsghdr align;
+  } ctrl;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (input_param_.sock_timestamp)
+  {
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+  }
+
+  ssize_t ret = recvmsg(fd, &msg, 0);
+  if (ret < 0)
+  {
+    dropPacket(pkt);
+    perror("recvmsg: ");
+    return -1;
+  }
+
+  recv_syscalls_++;
+  if (ret > 0)
+  {
+    recv_pkts_++;
+    pkt->setData(sock_offset_, ret - sock_offset_ - sock_tail_);
+    pkt->setTimestamp(cmsgTimestamp(&msg));
+    pushPacket(pkt);
+  }
+  else
+  {
+    dropPacket(pkt);
+  }
+
+  return ret;
+}
+
+inline ssize_t InputSock::recvBatch(int fd)
+{
+  size_t num = batch_pkts_.size();
+
+  //
+  // refill the slots consumed by last call only.
+  //
+  for (size_t i = 0; i < num; i++)
+  {
+    if (batch_pkts_[i] == NULL)
+    {
+      batch_pkts_[i] = getPacket(pkt_buf_len_);
+      batch_iovs_[i].iov_base = batch_pkts_[i]->buf();
+      batch_iovs_[i].iov_len = batch_pkts_[i]->bufSize();
+    }
+
+    if (!batch_ctrls_.empty())
+    {
+      batch_msgs_[i].msg_hdr.msg_controllen = CTRL_LEN;
+    }
+  }
+
+  int ret = recvmmsg(fd, batch_msgs_.data(), (unsigned int)num, MSG_DONTWAIT, NULL);
+  if (ret < 0)
+  {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+      return 0;
+
+    perror("recvmmsg: ");
+    return -1;
+  }
+
+  recv_syscalls_++;
+  recv_pkts_ += ret;
+
+  for (int i = 0; i < ret; i++)
+  {
+    size_t len = batch_msgs_[i].msg_len;
+    if (len > 0)
+    {
+      batch_pkts_[i]->setData(sock_offset_, len - sock_offset_ - sock_tail_);
+      batch_pkts_[i]->setTimestamp(cmsgTimestamp(&batch_msgs_[i].msg_hdr));
+      pushPacket(batch_pkts_[i]);
+      batch_pkts_[i] = NULL;
+    }
+  }
+
+  return ret;
+}
+
+//
+// check that the kernel supports UDP_GRO, and prepare buffers of coalesced datagrams, and views on them.
+//
+inline bool InputSock::initGro()
+{
+  int on = 1;
+  int fd = socket(PF_INET, SOCK_DGRAM, 0);
+  bool supported = (fd >= 0) && (setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0);
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+
+  if (!supported)
+  {
+    RS_WARNING << "UDP_GRO is not supported by the kernel. Receive without it." << RS_REND;
+    return false;
+  }
+
+  if (!gro_pool_.init(IP_LEN, GRO_BUF_NUM))
+  {
+    RS_WARNING << "Failed to allocate buffers for UDP_GRO. Receive without it." << RS_REND;
+    return false;
+  }
+
+  gro_views_.reserve(GRO_VIEW_NUM);
+  free_views_.reserve(GRO_VIEW_NUM);
+  for (size_t i = 0; i < GRO_VIEW_NUM; i++)
+  {
+    gro_views_.emplace_back(new SegmentView(static_cast<BufferRecycler*>(this)));
+    free_views_.push_back(gro_views_.back().get());
+  }
+
+  return true;
+}
+
+inline void InputSock::recycle(Buffer* pkt)
+{
+  SegmentView* view = static_cast<SegmentView*>(pkt);
+  Buffer* gro_pkt = view->parent;
+
+  {
+    std::lock_guard<std::mutex> lg(views_mtx_);
+    free_views_.push_back(view);
+  }
+
+  // the last view returns the datagram to gro_pool_.
+  gro_pkt->unref();
+}
+
+inline InputSock::SegmentView* InputSock::getView()
+{
+  std::lock_guard<std::mutex> lg(views_mtx_);
+  if (free_views_.empty())
+    return NULL;
+
+  SegmentView* view = free_views_.back();
+  free_views_.pop_back();
+  return view;
+}
+
+//
+// receive a datagram, which may be coalesced by UDP_GRO, and split it into packets of the segment size.
+//
+inline ssize_t InputSock::recvGro(int fd)
+{
+  // all in use. receive into drop_pkt_, and copy the packets.
+  Buffer* gro_pkt = gro_pool_.get();
+  if (gro_pkt == NULL)
+  {
+    gro_pkt = &drop_pkt_;
+  }
+
+  struct iovec iov;
+  iov.iov_base = gro_pkt->buf();
+  iov.iov_len = gro_pkt->bufSize();
+
+  union
+  {
+    char buf[CTRL_LEN];
+    struct cmsghdr align;
+  } ctrl;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof(ctrl.buf);
+
+  ssize_t ret = recvmsg(fd, &msg, MSG_DONTWAIT);
+  if (ret < 0)
+  {
+    dropPacket(gro_pkt);
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+      return 0;
+
+    perror("recvmsg: ");
+    return -1;
+  }
+
+  recv_syscalls_++;
+
+  // not coalesced if there is no segment size.
+  size_t seg_size = (size_t)ret;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+  {
+    if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO))
+    {
+      int gso_size;
+      memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+      if (gso_size > 0)
+        seg_size = (size_t)gso_size;
+    }
+  }
+
+  // the last segment may be shorter.
+  uint64_t ts = cmsgTimestamp(&msg);
+  for (size_t off = 0; off < (size_t)ret; off += seg_size)
+  {
+    size_t len = std::min(seg_size, (size_t)ret - off);
+    if (len > sock_offset_ + sock_tail_)
+    {
+      recv_pkts_++;
+      putSegment(gro_pkt, off, len, ts);
+    }
+  }
+
+  // views hold their own references.
+  dropPacket(gro_pkt);
+  return ret;
+}
+
+inline void InputSock::putSegment(Buffer* gro_pkt, size_t off, size_t len, uint64_t ts)
+{
+  SegmentView* view = (gro_pkt != &drop_pkt_) ? getView() : NULL;
+
+  Buffer* pkt = view;
+  if (view != NULL)
+  {
+    gro_pkt->ref();
+    view->parent = gro_pkt;
+    view->ref();
+    view->attach(gro_pkt->buf() + off, len);
+  }
+  else
+  {
+    // out of views. copy it.
+    pkt = getPacket(pkt_buf_len_);
+    if ((pkt == &drop_pkt_) || (len > pkt->bufSize()))
+    {
+      dropPacket(pkt);
+      return;
+    }
+
+    memcpy(pkt->buf(), gro_pkt->buf() + off, len);
+  }
+
+  pkt->setData(sock_offset_, len - sock_offset_ - sock_tail_);
+  pkt->setTimestamp(ts);
+  pushPacket(pkt);
+}
+
+//
+// arrival time of a datagram with SO_TIMESTAMPNS, in nanoseconds since epoch. 0 if there is none.
+//
+inline uint64_t InputSock::cmsgTimestamp(struct msghdr* msg)
+{
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+  {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_TIMESTAMPNS))
+    {
+      struct timespec ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+    }
+  }
+
+  return 0;
+}
+
+inline void InputSock::initBatch()
+{
+  size_t batch_num = input_param_.recv_batch_num;
+  if (batch_num > 1)
+  {
+    batch_pkts_.assign(batch_num, NULL);
+    batch_iovs_.resize(batch_num);
+    batch_msgs_.resize(batch_num);
+    memset(batch_msgs_.data(), 0, batch_num * sizeof(struct mmsghdr));
+    for (size_t i = 0; i < batch_num; i++)
+    {
+      batch_msgs_[i].msg_hdr.msg_iov = &batch_iovs_[i];
+      batch_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if (input_param_.sock_timestamp)
+    {
+      batch_ctrls_.resize(batch_num * CTRL_LEN);
+      for (size_t i = 0; i < batch_num; i++)
+      {
+        batch_msgs_[i].msg_hdr.msg_control = &batch_ctrls_[i * CTRL_LEN];
+      }
+    }
+  }
+}
+
+inline void InputSock::endRecv()
+{
+  for (size_t i = 0; i < batch_pkts_.size(); i++)
+  {
+    if (batch_pkts_[i] != NULL)
+    {
+      dropPacket(batch_pkts_[i]);
+      batch_pkts_[i] = NULL;
+    }
+  }
+
+  if (recv_syscalls_ > 0)
+  {
+    RS_INFO << "Socket received " << recv_pkts_ << " packets with " << recv_syscalls_ << " syscalls ("
+            << (double)recv_pkts_ / recv_syscalls_ << " packets/syscall)." << RS_REND;
+  }
+}
+
 inline void InputSock::recvPacket()
 {
   while (!to_exit_recv_)
@@ -261,23 +728,17 @@ inline void InputSock::recvPacket()
     {
       if (events[i].events & EPOLLIN)
       {
-        std::shared_ptr<Buffer> pkt = cb_get_pkt_(pkt_buf_len_);
-        ssize_t ret = recvfrom(events[i].data.fd, pkt->buf(), pkt->bufSize(), 0, NULL, NULL);
-        if (ret < 0)
+        if (!reactorRecv(events[i].data.fd))
         {
-          perror("recvfrom: ");
           goto failExit;
         }
-        else if (ret > 0)
-        {
-          pkt->setData(sock_offset_, ret - sock_offset_ - sock_tail_);
-          pushPacket(pkt);
-        }
       }
     }
   }
 
 failExit:
+
+  endRecv();
   return;
 }
 
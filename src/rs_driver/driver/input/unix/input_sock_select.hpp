@@ -254,10 +254,11 @@ inline void InputSock::recvPacket()
     {
       if ((fds_[i] >= 0) && FD_ISSET(fds_[i], &rfds))
       {
-        std::shared_ptr<Buffer> pkt = cb_get_pkt_(pkt_buf_len_);
+        Buffer* pkt = getPacket(pkt_buf_len_);
         ssize_t ret = recvfrom(fds_[i], pkt->buf(), pkt->bufSize(), 0, NULL, NULL);
         if (ret < 0)
         {
+          dropPacket(pkt);
           perror("recvfrom: ");
           break;
         }
@@ -266,6 +267,10 @@ inline void InputSock::recvPacket()
           pkt->setData(sock_offset_, ret - sock_offset_ - sock_tail_);
           pushPacket(pkt);
         }
+        else
+        {
+          dropPacket(pkt);
+        }
       }
     }
   }
@@ -0,0 +1,601 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/input/unix/input_sock_epoll.hpp>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Receive MSOP/DIFOP packets with io_uring. Each socket has a multishot recvmsg, which picks buffers
+// from a provided buffer ring. The ring is filled with buffers of the packet pool, so packets are received
+// into them directly, and handed to the decoder without copy. Completions are reaped in batches, with one
+// io_uring_enter() for all packets ready.
+//
+// They are reaped on the receiving thread, and go to the handle thread through the packet queue. With 
+// decode_inline, they are decoded on it too, and there is no handle thread.
+//
+// It requires Linux 6.0+ (buffer rings since 5.19, multishot recvmsg since 6.0). On older kernels,
+// or with sock_reactor_group or sock_udp_gro, it falls back to epoll.
+//
+class InputSockUring : public InputSock
+{
+public:
+  InputSockUring(const RSInputParam& input_param, bool is_jumbo)
+    : InputSock(input_param), ring_fd_(-1), sq_ptr_(NULL), sq_size_(0), cq_ptr_(NULL), cq_size_(0),
+    sqes_(NULL), sqes_size_(0), buf_ring_(NULL), buf_ring_size_(0), buf_num_(is_jumbo ? (uint16_t)BUF_NUM_JUMBO : (uint16_t)BUF_NUM),
+    buf_tail_(0), sq_tail_local_(0), to_submit_(0), received_(false), stopping_(false), unsupported_(false), failed_(false)
+  {
+    pkt_buf_len_ = is_jumbo ? IP_LEN : ETH_LEN;
+    armed_[0] = armed_[1] = false;
+    memset(&msg_, 0, sizeof(msg_));
+    if (input_param.sock_timestamp)
+    {
+      msg_.msg_controllen = CMSG_SPACE(sizeof(struct timespec));
+    }
+  }
+
+  virtual bool start();
+  virtual ~InputSockUring();
+
+#ifndef UNIT_TEST
+private:
+#endif
+  inline bool initUring();
+  inline bool probeBufRing();
+  inline void closeUring();
+  inline void cancelUring();
+  inline void recvUring();
+  inline int enter(uint32_t min_complete, uint32_t wait_ms);
+  inline int reap();
+  inline void handleCqe(const struct io_uring_cqe& cqe);
+  inline void putPacket(Buffer* pkt);
+  inline struct io_uring_sqe* getSqe();
+  inline void armRecv(size_t i);
+  inline void addBuffer(uint16_t bid);
+
+  constexpr static uint32_t SQ_ENTRIES = 8;
+  constexpr static uint32_t CQ_ENTRIES = 4096;
+  constexpr static uint16_t BUF_NUM = 128;       // buffers taken from the packet pool. A power of 2
+  constexpr static uint16_t BUF_NUM_JUMBO = 16;
+  constexpr static uint16_t BUF_GROUP = 0;
+  constexpr static uint64_t CANCEL_DATA = 0xFF;  // user_data of cancel requests. Recv requests are socket index + 1
+  constexpr static uint64_t PROBE_DATA = 0xFE;
+
+  int ring_fd_;
+  void* sq_ptr_;
+  size_t sq_size_;
+  void* cq_ptr_;
+  size_t cq_size_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  uint32_t* sq_head_;
+  uint32_t* sq_tail_;
+  uint32_t sq_mask_;
+  uint32_t* cq_head_;
+  uint32_t* cq_tail_;
+  uint32_t cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  struct io_uring_buf_ring* buf_ring_;
+  size_t buf_ring_size_;
+  uint16_t buf_num_;
+  uint16_t buf_tail_;
+  std::vector<Buffer*> ring_pkts_;  // buffers in the ring, by buffer id
+
+  struct msghdr msg_;  // of multishot recvmsg. No name. Control message of SO_TIMESTAMPNS if sock_timestamp
+  bool armed_[2];      // multishot recvmsg is active on the socket
+  uint32_t sq_tail_local_;
+  uint32_t to_submit_;
+  bool received_;
+  bool stopping_;
+  bool unsupported_;   // the kernel doesn't support multishot recvmsg. Fall back to epoll
+  bool failed_;
+};
+
+inline bool InputSockUring::start()
+{
+  if (start_flag_)
+  {
+    return true;
+  }
+
+  if (!init_flag_)
+  {
+    cb_excep_(Error(ERRCODE_STARTBEFOREINIT));
+    return false;
+  }
+
+  // coalesced datagrams don't fit in the buffers of the ring.
+  if (!input_param_.sock_reactor_group.empty() || gro_ || !initUring())
+  {
+    return InputSock::start();
+  }
+
+  to_exit_recv_ = false;
+  recv_thread_ = std::thread(std::bind(&InputSockUring::recvUring, this));
+
+  start_flag_ = true;
+  return true;
+}
+
+inline InputSockUring::~InputSockUring()
+{
+  stop();
+}
+
+inline bool InputSockUring::initUring()
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = CQ_ENTRIES;
+
+  int fd = (int)syscall(__NR_io_uring_setup, SQ_ENTRIES, &params);
+  if (fd < 0)
+  {
+    RS_WARNING << "io_uring is not available (" << strerror(errno) << "). Receive with epoll." << RS_REND;
+    return false;
+  }
+
+  ring_fd_ = fd;
+
+  if (!(params.features & IORING_FEAT_EXT_ARG))
+  {
+    RS_WARNING << "io_uring of this kernel is too old. Receive with epoll." << RS_REND;
+    goto failRing;
+  }
+
+  //
+  // SQ/CQ rings and SQEs
+  //
+  {
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap)
+    {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+
+    void* sq = mmap(NULL, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED)
+      goto failRing;
+    sq_ptr_ = sq;
+
+    void* cq = sq;
+    if (!single_mmap)
+    {
+      cq = mmap(NULL, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      if (cq == MAP_FAILED)
+        goto failRing;
+      cq_ptr_ = cq;
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+      goto failRing;
+    sqes_ = (struct io_uring_sqe*)sqes;
+
+    uint8_t* sq_base = (uint8_t*)sq;
+    sq_head_ = (uint32_t*)(sq_base + params.sq_off.head);
+    sq_tail_ = (uint32_t*)(sq_base + params.sq_off.tail);
+    sq_mask_ = *(uint32_t*)(sq_base + params.sq_off.ring_mask);
+    uint32_t* sq_array = (uint32_t*)(sq_base + params.sq_off.array);
+    for (uint32_t i = 0; i < params.sq_entries; i++)
+    {
+      sq_array[i] = i;
+    }
+    sq_tail_local_ = *sq_tail_;
+
+    uint8_t* cq_base = (uint8_t*)cq;
+    cq_head_ = (uint32_t*)(cq_base + params.cq_off.head);
+    cq_tail_ = (uint32_t*)(cq_base + params.cq_off.tail);
+    cq_mask_ = *(uint32_t*)(cq_base + params.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe*)(cq_base + params.cq_off.cqes);
+  }
+
+  //
+  // provided buffer ring, filled with buffers of the packet pool
+  //
+  {
+    buf_ring_size_ = buf_num_ * sizeof(struct io_uring_buf);
+    void* ring = mmap(NULL, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+      goto failRing;
+    buf_ring_ = (struct io_uring_buf_ring*)ring;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = buf_num_;
+    reg.bgid = BUF_GROUP;
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+      RS_WARNING << "io_uring buffer ring is not supported (" << strerror(errno) << "). Receive with epoll." << RS_REND;
+      goto failRing;
+    }
+
+    buf_tail_ = 0;
+    ring_pkts_.assign(buf_num_, NULL);
+    for (uint16_t bid = 0; bid < buf_num_; bid++)
+    {
+      ring_pkts_[bid] = getPacket(pkt_buf_len_);
+      addBuffer(bid);
+    }
+    __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+  }
+
+  if (!probeBufRing())
+  {
+    RS_WARNING << "io_uring buffer ring doesn't work on this kernel. Receive with epoll." << RS_REND;
+    goto failRing;
+  }
+
+  //
+  // multishot recvmsg on each socket
+  //
+  received_ = stopping_ = unsupported_ = failed_ = false;
+  to_submit_ = 0;
+  for (size_t i = 0; i < 2; i++)
+  {
+    if (fds_[i] >= 0)
+    {
+      armRecv(i);
+    }
+  }
+
+  return true;
+
+failRing:
+  closeUring();
+  return false;
+}
+
+//
+// read a byte from a pipe with a buffer of the ring, to make sure the kernel picks buffers from it.
+//
+inline bool InputSockUring::probeBufRing()
+{
+  int pipe_fds[2];
+  if (pipe(pipe_fds) < 0)
+  {
+    return false;
+  }
+
+  bool ok = false;
+  uint8_t byte = 0;
+  if (write(pipe_fds[1], &byte, 1) == 1)
+  {
+    struct io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = pipe_fds[0];
+    sqe->off = (uint64_t)-1;
+    sqe->len = 1;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = PROBE_DATA;
+
+    enter(1, 1000);
+
+    uint32_t head = *cq_head_;
+    if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+    {
+      const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      ok = (cqe.user_data == PROBE_DATA) && (cqe.res == 1) && (cqe.flags & IORING_CQE_F_BUFFER);
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+      if (ok)
+      {
+        // give the buffer back.
+        addBuffer((uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+      }
+    }
+  }
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  return ok;
+}
+
+inline void InputSockUring::closeUring()
+{
+  if (ring_fd_ >= 0)
+  {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+
+  if (sqes_ != NULL)
+  {
+    munmap(sqes_, sqes_size_);
+    sqes_ = NULL;
+  }
+
+  if (cq_ptr_ != NULL)
+  {
+    munmap(cq_ptr_, cq_size_);
+    cq_ptr_ = NULL;
+  }
+
+  if (sq_ptr_ != NULL)
+  {
+    munmap(sq_ptr_, sq_size_);
+    sq_ptr_ = NULL;
+  }
+
+  if (buf_ring_ != NULL)
+  {
+    munmap(buf_ring_, buf_ring_size_);
+    buf_ring_ = NULL;
+  }
+
+  for (size_t i = 0; i < ring_pkts_.size(); i++)
+  {
+    if (ring_pkts_[i] != NULL)
+    {
+      dropPacket(ring_pkts_[i]);
+    }
+  }
+  ring_pkts_.clear();
+}
+
+//
+// cancel the multishot requests, and wait for their last completions.
+// The kernel writes no buffer of the ring after that, so they can go back to the pool.
+//
+inline void InputSockUring::cancelUring()
+{
+  stopping_ = true;
+
+  for (size_t i = 0; i < 2; i++)
+  {
+    if (armed_[i])
+    {
+      struct io_uring_sqe* sqe = getSqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = i + 1;
+      sqe->user_data = CANCEL_DATA;
+    }
+  }
+
+  for (int retry = 0; (retry < 100) && (armed_[0] || armed_[1]); retry++)
+  {
+    enter(1, 10);
+    reap();
+  }
+}
+
+inline int InputSockUring::enter(uint32_t min_complete, uint32_t wait_ms)
+{
+  struct __kernel_timespec ts;
+  ts.tv_sec = wait_ms / 1000;
+  ts.tv_nsec = (wait_ms % 1000) * 1000000;
+
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.ts = (uint64_t)(uintptr_t)&ts;
+
+  int ret = (int)syscall(__NR_io_uring_enter, ring_fd_, to_submit_, min_complete,
+      IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+  int err = errno;
+
+  // SQEs not consumed by the kernel are submitted next time.
+  to_submit_ = sq_tail_local_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  recv_syscalls_++;
+
+  errno = err;
+  return ret;
+}
+
+inline struct io_uring_sqe* InputSockUring::getSqe()
+{
+  struct io_uring_sqe* sqe = &sqes_[sq_tail_local_ & sq_mask_];
+  memset(sqe, 0, sizeof(*sqe));
+
+  sq_tail_local_++;
+  __atomic_store_n(sq_tail_, sq_tail_local_, __ATOMIC_RELEASE);
+  to_submit_++;
+  return sqe;
+}
+
+inline void InputSockUring::armRecv(size_t i)
+{
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = fds_[i];
+  sqe->addr = (uint64_t)(uintptr_t)&msg_;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = BUF_GROUP;
+  sqe->user_data = i + 1;
+
+  armed_[i] = true;
+}
+
+inline void InputSockUring::addBuffer(uint16_t bid)
+{
+  Buffer* pkt = ring_pkts_[bid];
+
+  // not buf_ring_->bufs. In C++, __DECLARE_FLEX_ARRAY puts it at offset 8 instead of 0, 
+  // and the ring tail would overwrite the first buffer.
+  struct io_uring_buf* buf = (struct io_uring_buf*)buf_ring_ + (buf_tail_ & (buf_num_ - 1));
+  buf->addr = (uint64_t)(uintptr_t)pkt->buf();
+  buf->len = (uint32_t)pkt->bufSize();
+  buf->bid = bid;
+
+  buf_tail_++;
+}
+
+//
+// reap all completions ready. return the number of them.
+//
+inline int InputSockUring::reap()
+{
+  uint32_t head = *cq_head_;
+  uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  uint16_t buf_tail = buf_tail_;
+
+  int num = 0;
+  for (; head != tail; head++, num++)
+  {
+    handleCqe(cqes_[head & cq_mask_]);
+  }
+
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+  if (buf_tail_ != buf_tail)
+  {
+    __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+  }
+
+  return num;
+}
+
+inline void InputSockUring::handleCqe(const struct io_uring_cqe& cqe)
+{
+  if (cqe.user_data == CANCEL_DATA)
+  {
+    return;
+  }
+
+  size_t i = (size_t)(cqe.user_data - 1);
+
+  if ((cqe.res >= 0) && (cqe.flags & IORING_CQE_F_BUFFER))
+  {
+    uint16_t bid = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    putPacket(ring_pkts_[bid]);
+
+    // replace it with a new one.
+    ring_pkts_[bid] = getPacket(pkt_buf_len_);
+    addBuffer(bid);
+  }
+
+  if ((cqe.res < 0) && (cqe.res != -ENOBUFS) && (cqe.res != -ECANCELED))
+  {
+    if (!received_ && ((cqe.res == -EINVAL) || (cqe.res == -EOPNOTSUPP)))
+    {
+      unsupported_ = true;
+    }
+    else if (!stopping_)
+    {
+      RS_ERROR << "io_uring recvmsg: " << strerror(-cqe.res) << RS_REND;
+      failed_ = true;
+    }
+  }
+
+  if (!(cqe.flags & IORING_CQE_F_MORE))
+  {
+    // the multishot request ends, e.g. no buffer in the ring. Arm it again.
+    armed_[i] = false;
+    if (!stopping_ && !unsupported_ && !failed_)
+    {
+      armRecv(i);
+    }
+  }
+}
+
+inline void InputSockUring::putPacket(Buffer* pkt)
+{
+  // io_uring_recvmsg_out, name, control message, and payload.
+  const struct io_uring_recvmsg_out* out = (const struct io_uring_recvmsg_out*)pkt->buf();
+  size_t ctrl_off = sizeof(struct io_uring_recvmsg_out) + msg_.msg_namelen;
+  size_t payload_off = ctrl_off + msg_.msg_controllen;
+  size_t len = out->payloadlen;
+
+  if ((out->flags & MSG_TRUNC) || (len <= sock_offset_ + sock_tail_))
+  {
+    dropPacket(pkt);
+    return;
+  }
+
+  received_ = true;
+  recv_pkts_++;
+  pkt->setData(payload_off + sock_offset_, len - sock_offset_ - sock_tail_);
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_control = pkt->buf() + ctrl_off;
+  msg.msg_controllen = out->controllen;
+  pkt->setTimestamp(cmsgTimestamp(&msg));
+
+  pushPacket(pkt);
+}
+
+inline void InputSockUring::recvUring()
+{
+  while (!to_exit_recv_ && !unsupported_ && !failed_)
+  {
+    int ret = enter(1, 1000);
+    if ((ret < 0) && (errno != ETIME) && (errno != EINTR) && (errno != EBUSY))
+    {
+      perror("io_uring_enter: ");
+      break;
+    }
+
+    if ((reap() == 0) && (ret < 0) && (errno == ETIME))
+    {
+      cb_excep_(Error(ERRCODE_MSOPTIMEOUT));
+    }
+  }
+
+  cancelUring();
+  closeUring();
+
+  if (unsupported_)
+  {
+    RS_WARNING << "io_uring multishot recvmsg is not supported. Receive with epoll." << RS_REND;
+    initBatch();
+    recvPacket();
+    return;
+  }
+
+  endRecv();
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,197 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/input/input.hpp>
+#include <rs_driver/driver/input/unix/xdp_port.hpp>
+
+#include <chrono>
+#include <memory>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Receive MSOP/DIFOP packets with AF_XDP, on the network device of device_name.
+//
+// Packets are received by XdpPort of the device, on its thread, with other drivers on the device.
+// They are handed to the decoder as views on the UMEM frames, without copy.
+//
+class InputXdp : public Input, public XdpSource
+{
+public:
+  InputXdp(const RSInputParam& input_param)
+    : Input(input_param), pkt_offset_(ETH_HDR_LEN), pkt_tail_(0)
+  {
+    pkt_offset_ += input_param.user_layer_bytes;
+    pkt_tail_   += input_param.tail_layer_bytes;
+  }
+
+  virtual bool init();
+  virtual bool start();
+  virtual void stop();
+  virtual ~InputXdp();
+
+  virtual void xdpRecv(uint8_t* frame, size_t len, Buffer* view);
+  virtual void xdpTimeout()
+  {
+    cb_excep_(Error(ERRCODE_MSOPTIMEOUT));
+  }
+
+private:
+  inline uint64_t timeNow();
+
+  size_t pkt_offset_;
+  size_t pkt_tail_;
+  std::shared_ptr<XdpPort> port_;
+};
+
+inline bool InputXdp::init()
+{
+  if (init_flag_)
+  {
+    return true;
+  }
+
+  if (input_param_.device_name.empty())
+  {
+    RS_ERROR << "InputType::ONLINE_LIDAR_XDP requires device_name." << RS_REND;
+    return false;
+  }
+
+  if (!input_param_.group_address.empty() && (input_param_.group_address != "0.0.0.0"))
+  {
+    RS_WARNING << "InputType::ONLINE_LIDAR_XDP doesn't join the multicast group." << RS_REND;
+  }
+
+  if (input_param_.sock_timestamp)
+  {
+    RS_WARNING << "InputType::ONLINE_LIDAR_XDP has no kernel timestamp. sock_timestamp stamps packets "
+      << "with the time they are received in user space." << RS_REND;
+  }
+
+  port_ = XdpPort::join(input_param_.device_name);
+  if (port_ == nullptr)
+  {
+    return false;
+  }
+
+  init_flag_ = true;
+  return true;
+}
+
+inline bool InputXdp::start()
+{
+  if (start_flag_)
+  {
+    return true;
+  }
+
+  if (!init_flag_)
+  {
+    cb_excep_(Error(ERRCODE_STARTBEFOREINIT));
+    return false;
+  }
+
+  if (!port_->start(this, input_param_.msop_port, input_param_.difop_port))
+  {
+    return false;
+  }
+
+  start_flag_ = true;
+  return true;
+}
+
+inline void InputXdp::stop()
+{
+  if (start_flag_)
+  {
+    port_->stop(this);
+    start_flag_ = false;
+  }
+}
+
+inline InputXdp::~InputXdp()
+{
+  stop();
+}
+
+inline uint64_t InputXdp::timeNow()
+{
+  // no kernel timestamp for AF_XDP. Take the time it is received.
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline void InputXdp::xdpRecv(uint8_t* frame, size_t len, Buffer* view)
+{
+  size_t offset = pkt_offset_;
+  if ((frame[12] == 0x81) && (frame[13] == 0x00))
+  {
+    offset += VLAN_HDR_LEN;
+  }
+
+  if (len <= offset + pkt_tail_)
+  {
+    if (view != NULL)
+      view->unref();
+    return;
+  }
+
+  Buffer* pkt = view;
+  if (pkt != NULL)
+  {
+    pkt->setData(offset, len - offset - pkt_tail_);
+  }
+  else
+  {
+    // out of views. copy it.
+    pkt = getPacket(ETH_LEN);
+    if (len - offset - pkt_tail_ > pkt->bufSize())
+    {
+      dropPacket(pkt);
+      return;
+    }
+
+    memcpy(pkt->data(), frame + offset, len - offset - pkt_tail_);
+    pkt->setData(0, len - offset - pkt_tail_);
+  }
+
+  pkt->setTimestamp(input_param_.sock_timestamp ? timeNow() : 0);
+  pushPacket(pkt);
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,373 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// A socket input received by SockReactor. Its methods are called on the thread of the reactor.
+//
+class SockReactorSource
+{
+public:
+
+  //
+  // receive packets from fd, which is readable. return false on a fatal error. The source is removed then.
+  //
+  virtual bool reactorRecv(int fd) = 0;
+
+  //
+  // no packet is received from the source in a while.
+  //
+  virtual void reactorTimeout() = 0;
+
+  virtual ~SockReactorSource()
+  {
+  }
+};
+
+//
+// One epoll loop, on one thread, for the MSOP/DIFOP sockets of all drivers with the same sock_reactor_group.
+// Readable sockets are dispatched to their sources by the epoll data. The thread may be pinned to a CPU core.
+// Sources are added and removed with the loop stopped, so the loop takes no lock.
+//
+class SockReactor
+{
+public:
+
+  //
+  // the reactor of param.sock_reactor_group. It is created by the first source.
+  //
+  static inline std::shared_ptr<SockReactor> join(const RSInputParam& param);
+
+  inline SockReactor(const RSInputParam& param);
+  inline ~SockReactor();
+
+  //
+  // add a source with its sockets, and receive from them.
+  //
+  inline bool start(SockReactorSource* src, const int* fds, size_t fd_num);
+
+  //
+  // remove a source. No method of it is called after this returns.
+  //
+  inline void stop(SockReactorSource* src);
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  struct Member;
+
+  struct Slot  // a socket. Its address is the epoll data
+  {
+    Member* member;
+    int fd;
+  };
+
+  struct Member
+  {
+    SockReactorSource* src;
+    std::vector<Slot> slots;
+    std::chrono::steady_clock::time_point last_recv;
+    bool failed;
+  };
+
+  inline void startLoop();
+  inline void stopLoop();
+  inline void loop();
+  inline void removeFds(const Member& m);
+
+  constexpr static int EVENT_NUM = 32;
+  constexpr static int TIMEOUT_MS = 1000;
+
+  std::string name_;
+  int16_t cpu_;
+  int epfd_;
+  int wake_fd_;  // eventfd, to wake the loop to exit
+
+  std::mutex mtx_;
+  std::vector<std::unique_ptr<Member>> members_;
+  std::thread thread_;
+  std::atomic<bool> to_exit_;
+};
+
+inline std::shared_ptr<SockReactor> SockReactor::join(const RSInputParam& param)
+{
+  static std::mutex mtx;
+  static std::map<std::string, std::weak_ptr<SockReactor>> reactors;
+
+  std::lock_guard<std::mutex> lg(mtx);
+
+  std::shared_ptr<SockReactor> reactor = reactors[param.sock_reactor_group].lock();
+  if (reactor == nullptr)
+  {
+    reactor = std::make_shared<SockReactor>(param);
+    reactors[param.sock_reactor_group] = reactor;
+  }
+  else if (reactor->cpu_ != param.sock_reactor_cpu)
+  {
+    RS_WARNING << "sock_reactor_cpu differs in socket reactor group " << param.sock_reactor_group 
+      << ". Use that of the first driver." << RS_REND;
+  }
+
+  return reactor;
+}
+
+inline SockReactor::SockReactor(const RSInputParam& param)
+  : name_(param.sock_reactor_group), cpu_(param.sock_reactor_cpu), epfd_(-1), wake_fd_(-1), to_exit_(false)
+{
+  epfd_ = epoll_create(1);
+  if (epfd_ < 0)
+  {
+    perror("epoll_create: ");
+    return;
+  }
+
+  wake_fd_ = eventfd(0, EFD_NONBLOCK);
+  if (wake_fd_ < 0)
+  {
+    perror("eventfd: ");
+    return;
+  }
+
+  struct epoll_event ev;
+  ev.data.ptr = NULL;
+  ev.events = EPOLLIN;
+  epoll_ctl (epfd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+}
+
+inline SockReactor::~SockReactor()
+{
+  stopLoop();
+
+  if (wake_fd_ >= 0)
+    close(wake_fd_);
+  if (epfd_ >= 0)
+    close(epfd_);
+}
+
+inline bool SockReactor::start(SockReactorSource* src, const int* fds, size_t fd_num)
+{
+  if (wake_fd_ < 0)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lg(mtx_);
+
+  stopLoop();
+
+  std::unique_ptr<Member> m(new Member{src, std::vector<Slot>(), std::chrono::steady_clock::now(), false});
+  m->slots.reserve(fd_num);  // no reallocation. Slots are referred by epoll
+  for (size_t i = 0; i < fd_num; i++)
+  {
+    m->slots.push_back(Slot{m.get(), fds[i]});
+
+    struct epoll_event ev;
+    ev.data.ptr = &m->slots.back();
+    ev.events = EPOLLIN; // level-triggered
+    if (epoll_ctl (epfd_, EPOLL_CTL_ADD, fds[i], &ev) < 0)
+    {
+      perror("epoll_ctl: ");
+      m->slots.pop_back();
+      removeFds(*m);
+      if (!members_.empty())
+      {
+        startLoop();
+      }
+
+      return false;
+    }
+  }
+
+  members_.emplace_back(std::move(m));
+  startLoop();
+  return true;
+}
+
+inline void SockReactor::stop(SockReactorSource* src)
+{
+  std::lock_guard<std::mutex> lg(mtx_);
+
+  stopLoop();
+
+  for (auto it = members_.begin(); it != members_.end(); it++)
+  {
+    if ((*it)->src == src)
+    {
+      removeFds(**it);
+      members_.erase(it);
+      break;
+    }
+  }
+
+  if (!members_.empty())
+  {
+    startLoop();
+  }
+}
+
+inline void SockReactor::removeFds(const Member& m)
+{
+  for (const Slot& slot : m.slots)
+  {
+    epoll_ctl (epfd_, EPOLL_CTL_DEL, slot.fd, NULL);
+  }
+}
+
+inline void SockReactor::startLoop()
+{
+  to_exit_ = false;
+  thread_ = std::thread(std::bind(&SockReactor::loop, this));
+
+  if (cpu_ >= 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu_, &cpus);
+    if (pthread_setaffinity_np(thread_.native_handle(), sizeof(cpus), &cpus) != 0)
+    {
+      RS_WARNING << "Failed to pin socket reactor " << name_ << " to CPU " << cpu_ << "." << RS_REND;
+    }
+  }
+}
+
+inline void SockReactor::stopLoop()
+{
+  if (!thread_.joinable())
+  {
+    return;
+  }
+
+  to_exit_ = true;
+  uint64_t one = 1;
+  ssize_t ret = write(wake_fd_, &one, sizeof(one));
+  (void)ret;
+
+  thread_.join();
+
+  uint64_t cnt;
+  ret = read(wake_fd_, &cnt, sizeof(cnt));
+}
+
+inline void SockReactor::loop()
+{
+  const std::chrono::milliseconds timeout(TIMEOUT_MS);
+  int wait_ms = TIMEOUT_MS;
+
+  while (!to_exit_)
+  {
+    struct epoll_event events[EVENT_NUM];
+    int retval = epoll_wait (epfd_, events, EVENT_NUM, wait_ms);
+    if (retval < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      perror("epoll_wait: ");
+      break;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < retval; i++)
+    {
+      Slot* slot = static_cast<Slot*>(events[i].data.ptr);
+      if ((slot == NULL) || !(events[i].events & EPOLLIN))
+      {
+        continue;
+      }
+
+      Member* m = slot->member;
+      if (m->failed)
+      {
+        continue;
+      }
+
+      m->last_recv = now;
+      if (!m->src->reactorRecv(slot->fd))
+      {
+        // as the receiving thread of a driver exits. The others go on.
+        m->failed = true;
+        removeFds(*m);
+      }
+    }
+
+    // a busy LiDAR keeps the loop awake. Check each source for its timeout,
+    // and wake up for the earliest one of the next.
+    std::chrono::steady_clock::duration next = timeout;
+    for (auto& m : members_)
+    {
+      if (m->failed)
+      {
+        continue;
+      }
+
+      if ((now - m->last_recv) >= timeout)
+      {
+        m->last_recv = now;
+        m->src->reactorTimeout();
+      }
+
+      next = std::min(next, m->last_recv + timeout - now);
+    }
+
+    wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next).count() + 1;
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
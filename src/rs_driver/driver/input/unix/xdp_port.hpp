@@ -0,0 +1,879 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+#include <rs_driver/utility/buffer.hpp>
+
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// A driver receiving packets from XdpPort. Its methods are called on the thread of the port.
+//
+class XdpSource
+{
+public:
+
+  //
+  // a frame to the MSOP/DIFOP port of the source, from its Ethernet header. view is attached on the frame in UMEM,
+  // and referred once. It is NULL if the port is out of views. Then the frame is reused as soon as this returns.
+  //
+  virtual void xdpRecv(uint8_t* frame, size_t len, Buffer* view) = 0;
+
+  //
+  // no packet to the source in a while.
+  //
+  virtual void xdpTimeout() = 0;
+
+  virtual ~XdpSource()
+  {
+  }
+};
+
+//
+// AF_XDP receiving on a network device, shared by all drivers on it.
+//
+// An XDP program, attached in generic (SKB) mode, redirects IPv4 UDP packets to the MSOP/DIFOP ports of the
+// drivers into an AF_XDP socket on each RX queue of the device. Other packets go on to the kernel stack.
+// Each socket has its own UMEM, an area of frames the kernel copies packets into. One thread polls all the sockets,
+// and dispatches the packets to the drivers by UDP destination port, as views on the UMEM frames. A frame goes
+// back to the fill ring of its socket when its view is recycled.
+//
+// Drivers are added and removed with the loop stopped, so the loop takes no lock.
+//
+class XdpPort : public BufferRecycler
+{
+public:
+
+  //
+  // the port of device. It is created by the first driver. return nullptr if AF_XDP is not available.
+  //
+  static inline std::shared_ptr<XdpPort> join(const std::string& device);
+
+  inline XdpPort(const std::string& device);
+  inline ~XdpPort();
+
+  //
+  // add a driver with its UDP ports, and receive for it. A port of 0 is ignored.
+  //
+  inline bool start(XdpSource* src, uint16_t msop_port, uint16_t difop_port);
+
+  //
+  // remove a driver. No method of it is called after this returns.
+  //
+  inline void stop(XdpSource* src);
+
+  virtual void recycle(Buffer* pkt);
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  struct Ring  // a ring mapped from the socket
+  {
+    uint8_t* map;
+    size_t map_len;
+    uint32_t* producer;
+    uint32_t* consumer;
+    void* descs;
+    uint32_t mask;
+  };
+
+  struct Queue  // an AF_XDP socket on an RX queue, with its UMEM
+  {
+    int fd;
+    uint8_t* umem;
+    Ring fill;
+    Ring comp;
+    Ring rx;
+  };
+
+  struct Member
+  {
+    XdpSource* src;
+    uint16_t ports[2];
+    std::chrono::steady_clock::time_point last_recv;
+  };
+
+  inline bool init();
+  inline bool initMaps();
+  inline bool loadProgram();
+  inline bool initQueue(Queue& q, uint32_t queue_id);
+  inline bool mapRing(int fd, Ring& ring, const struct xdp_ring_offset& off, uint64_t pgoff, size_t desc_len);
+  inline bool updatePort(uint16_t port, bool add);
+  inline void putFrame(Queue& q, uint64_t addr);
+  inline uint32_t queueNum();
+
+  inline void startLoop();
+  inline void stopLoop();
+  inline void loop();
+  inline void recvQueue(Queue& q, std::chrono::steady_clock::time_point now);
+
+  static inline int bpf(int cmd, union bpf_attr* attr)
+  {
+    return (int)syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+  }
+
+  constexpr static uint32_t FRAME_SIZE = 2048;
+  constexpr static uint32_t FRAME_NUM = 4096;  // of each queue. Rings are of the same size
+  constexpr static uint32_t COMP_NUM = 64;     // the completion ring is required, though nothing is sent
+  constexpr static uint32_t PORT_NUM = 64;     // MSOP/DIFOP ports of all drivers
+  constexpr static int TIMEOUT_MS = 1000;
+
+  std::string device_;
+  int ifindex_;
+  int ports_fd_;  // BPF hash map of UDP ports, in network order
+  int xsks_fd_;   // BPF XSKMAP of the sockets, by RX queue
+  int prog_fd_;
+  int link_fd_;   // the program is detached as it is closed
+  int wake_fd_;   // eventfd, to wake the loop to exit
+
+  std::vector<Queue> queues_;
+  std::vector<std::unique_ptr<Buffer>> views_;
+  std::vector<Buffer*> free_views_;
+  std::mutex views_mtx_;  // free views, and fill rings
+
+  std::mutex mtx_;
+  std::vector<Member> members_;
+  std::thread thread_;
+  std::atomic<bool> to_exit_;
+};
+
+inline std::shared_ptr<XdpPort> XdpPort::join(const std::string& device)
+{
+  static std::mutex mtx;
+  static std::map<std::string, std::weak_ptr<XdpPort>> ports;
+
+  std::lock_guard<std::mutex> lg(mtx);
+
+  std::shared_ptr<XdpPort> port = ports[device].lock();
+  if (port == nullptr)
+  {
+    port = std::make_shared<XdpPort>(device);
+    if (!port->init())
+    {
+      return nullptr;
+    }
+
+    ports[device] = port;
+  }
+
+  return port;
+}
+
+inline XdpPort::XdpPort(const std::string& device)
+  : device_(device), ifindex_(0), ports_fd_(-1), xsks_fd_(-1), prog_fd_(-1), link_fd_(-1), wake_fd_(-1), 
+  to_exit_(false)
+{
+}
+
+inline XdpPort::~XdpPort()
+{
+  stopLoop();
+
+  if (link_fd_ >= 0)
+    close(link_fd_);
+
+  for (Queue& q : queues_)
+  {
+    if (q.fd >= 0)
+      close(q.fd);
+    if (q.rx.map != NULL)
+      munmap(q.rx.map, q.rx.map_len);
+    if (q.comp.map != NULL)
+      munmap(q.comp.map, q.comp.map_len);
+    if (q.fill.map != NULL)
+      munmap(q.fill.map, q.fill.map_len);
+    if (q.umem != NULL)
+      munmap(q.umem, (size_t)FRAME_SIZE * FRAME_NUM);
+  }
+
+  if (prog_fd_ >= 0)
+    close(prog_fd_);
+  if (xsks_fd_ >= 0)
+    close(xsks_fd_);
+  if (ports_fd_ >= 0)
+    close(ports_fd_);
+  if (wake_fd_ >= 0)
+    close(wake_fd_);
+}
+
+inline uint32_t XdpPort::queueNum()
+{
+  uint32_t num = 0;
+
+  std::string path = "/sys/class/net/" + device_ + "/queues";
+  DIR* dir = opendir(path.c_str());
+  if (dir != NULL)
+  {
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+      if (strncmp(ent->d_name, "rx-", 3) == 0)
+        num++;
+    }
+
+    closedir(dir);
+  }
+
+  return std::max<uint32_t>(num, 1);
+}
+
+inline bool XdpPort::init()
+{
+  ifindex_ = (int)if_nametoindex(device_.c_str());
+  if (ifindex_ == 0)
+  {
+    RS_ERROR << "No network device " << device_ << " for AF_XDP." << RS_REND;
+    return false;
+  }
+
+  wake_fd_ = eventfd(0, EFD_NONBLOCK);
+  if (wake_fd_ < 0)
+  {
+    perror("eventfd: ");
+    return false;
+  }
+
+  // sockets are bound before the program is attached. No packet is redirected to an empty slot.
+  queues_.resize(queueNum());
+  for (Queue& q : queues_)
+  {
+    memset(&q, 0, sizeof(q));
+    q.fd = -1;
+  }
+
+  if (!initMaps())
+    return false;
+
+  for (uint32_t i = 0; i < queues_.size(); i++)
+  {
+    if (!initQueue(queues_[i], i))
+      return false;
+  }
+
+  if (!loadProgram())
+    return false;
+
+  size_t view_num = (size_t)FRAME_NUM * queues_.size();
+  views_.reserve(view_num);
+  free_views_.reserve(view_num);
+  for (size_t i = 0; i < view_num; i++)
+  {
+    views_.emplace_back(new Buffer(static_cast<BufferRecycler*>(this)));
+    free_views_.push_back(views_.back().get());
+  }
+
+  return true;
+}
+
+inline bool XdpPort::initMaps()
+{
+  union bpf_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_HASH;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(uint32_t);
+  attr.max_entries = PORT_NUM;
+  ports_fd_ = bpf(BPF_MAP_CREATE, &attr);
+  if (ports_fd_ < 0)
+  {
+    perror("bpf(BPF_MAP_CREATE): ");
+    return false;
+  }
+
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(uint32_t);
+  attr.max_entries = (uint32_t)queues_.size();
+  xsks_fd_ = bpf(BPF_MAP_CREATE, &attr);
+  if (xsks_fd_ < 0)
+  {
+    perror("bpf(BPF_MAP_CREATE): ");
+    return false;
+  }
+
+  return true;
+}
+
+inline bool XdpPort::loadProgram()
+{
+  //
+  // if (data + 46 > data_end) pass
+  // skip the VLAN tag, if any
+  // if (!IPv4 || ihl != 5 || !UDP || fragment) pass
+  // if (udp dst port not in ports) pass
+  // redirect to xsks[rx_queue_index], or pass if no socket
+  //
+  std::vector<struct bpf_insn> insns;
+  std::vector<size_t> to_pass;  // jumps to the end
+
+  auto emit = [&](uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+  {
+    struct bpf_insn insn;
+    memset(&insn, 0, sizeof(insn));
+    insn.code = code;
+    insn.dst_reg = dst;
+    insn.src_reg = src;
+    insn.off = off;
+    insn.imm = imm;
+    insns.push_back(insn);
+  };
+
+  auto passIf = [&](uint8_t op, uint8_t src_type, uint8_t dst, uint8_t src, int32_t imm)
+  {
+    to_pass.push_back(insns.size());
+    emit(BPF_JMP | op | src_type, dst, src, 0, imm);
+  };
+
+  auto loadMap = [&](uint8_t dst, int fd)
+  {
+    emit(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, fd);
+    emit(0, 0, 0, 0, 0);
+  };
+
+  emit(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+  emit(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, data), 0);
+  emit(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_6, offsetof(struct xdp_md, data_end), 0);
+  emit(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+  emit(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, ETH_HDR_LEN + VLAN_HDR_LEN);
+  passIf(BPF_JGT, BPF_X, BPF_REG_4, BPF_REG_3, 0);
+
+  // packet bytes are loaded in network order, so are compared with constants in network order.
+  emit(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 12, 0);                      // ether type
+  emit(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_0, 0, 1, htons(ETH_P_8021Q));
+  emit(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, VLAN_HDR_LEN);
+  emit(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 12, 0);
+  passIf(BPF_JNE, BPF_K, BPF_REG_0, 0, htons(ETH_P_IP));
+  emit(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_0, BPF_REG_2, 14, 0);                      // ip version and ihl
+  passIf(BPF_JNE, BPF_K, BPF_REG_0, 0, 0x45);
+  emit(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_0, BPF_REG_2, 23, 0);                      // ip protocol
+  passIf(BPF_JNE, BPF_K, BPF_REG_0, 0, IPPROTO_UDP);
+  emit(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 20, 0);                      // flags and fragment offset
+  passIf(BPF_JSET, BPF_K, BPF_REG_0, 0, htons(0x3FFF));                              // fragment
+  emit(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_0, BPF_REG_2, 36, 0);                      // udp dst port
+
+  emit(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_0, -4, 0);
+  loadMap(BPF_REG_1, ports_fd_);
+  emit(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0);
+  emit(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -4);
+  emit(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem);
+  passIf(BPF_JEQ, BPF_K, BPF_REG_0, 0, 0);
+
+  emit(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index), 0);
+  loadMap(BPF_REG_1, xsks_fd_);
+  emit(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);  // action if no socket on the queue
+  emit(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+  emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+  size_t pass = insns.size();
+  emit(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+  emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+  for (size_t i : to_pass)
+  {
+    insns[i].off = (int16_t)(pass - i - 1);
+  }
+
+  static const char license[] = "Dual BSD/GPL";
+  std::vector<char> log;
+
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = (uint64_t)(uintptr_t)insns.data();
+  attr.insn_cnt = (uint32_t)insns.size();
+  attr.license = (uint64_t)(uintptr_t)license;
+  prog_fd_ = bpf(BPF_PROG_LOAD, &attr);
+  if (prog_fd_ < 0)
+  {
+    perror("bpf(BPF_PROG_LOAD): ");
+
+    // load again for the verifier log.
+    log.resize(1 << 16);
+    attr.log_level = 1;
+    attr.log_buf = (uint64_t)(uintptr_t)log.data();
+    attr.log_size = (uint32_t)log.size();
+    if (bpf(BPF_PROG_LOAD, &attr) < 0)
+    {
+      RS_ERROR << log.data() << RS_REND;
+    }
+
+    return false;
+  }
+
+  memset(&attr, 0, sizeof(attr));
+  attr.link_create.prog_fd = (uint32_t)prog_fd_;
+  attr.link_create.target_ifindex = (uint32_t)ifindex_;
+  attr.link_create.attach_type = BPF_XDP;
+  attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+  link_fd_ = bpf(BPF_LINK_CREATE, &attr);
+  if (link_fd_ < 0)
+  {
+    perror("bpf(BPF_LINK_CREATE): ");
+    if (errno == EBUSY)
+    {
+      RS_ERROR << "Another XDP program is attached on " << device_ << "." << RS_REND;
+    }
+
+    return false;
+  }
+
+  return true;
+}
+
+inline bool XdpPort::mapRing(int fd, Ring& ring, const struct xdp_ring_offset& off, uint64_t pgoff, size_t desc_len)
+{
+  uint32_t num = (pgoff == XDP_UMEM_PGOFF_COMPLETION_RING) ? COMP_NUM : FRAME_NUM;
+
+  ring.map_len = off.desc + num * desc_len;
+  void* map = mmap(NULL, ring.map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, (off_t)pgoff);
+  if (map == MAP_FAILED)
+  {
+    perror("mmap: ");
+    return false;
+  }
+
+  ring.map = (uint8_t*)map;
+  ring.producer = (uint32_t*)(ring.map + off.producer);
+  ring.consumer = (uint32_t*)(ring.map + off.consumer);
+  ring.descs = ring.map + off.desc;
+  ring.mask = num - 1;
+  return true;
+}
+
+inline bool XdpPort::initQueue(Queue& q, uint32_t queue_id)
+{
+  int ret;
+
+  q.fd = socket(AF_XDP, SOCK_RAW, 0);
+  if (q.fd < 0)
+  {
+    perror("socket(AF_XDP): ");
+    return false;
+  }
+
+  {
+    void* umem = mmap(NULL, (size_t)FRAME_SIZE * FRAME_NUM, PROT_READ | PROT_WRITE, 
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (umem == MAP_FAILED)
+    {
+      perror("mmap: ");
+      return false;
+    }
+
+    q.umem = (uint8_t*)umem;
+  }
+
+  {
+    struct xdp_umem_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.addr = (uint64_t)(uintptr_t)q.umem;
+    reg.len = (uint64_t)FRAME_SIZE * FRAME_NUM;
+    reg.chunk_size = FRAME_SIZE;
+    reg.headroom = 0;
+    ret = setsockopt(q.fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg));
+    if (ret < 0)
+    {
+      perror("setsockopt(XDP_UMEM_REG): ");
+      return false;
+    }
+  }
+
+  {
+    uint32_t frame_num = FRAME_NUM;
+    uint32_t comp_num = COMP_NUM;
+    if ((setsockopt(q.fd, SOL_XDP, XDP_UMEM_FILL_RING, &frame_num, sizeof(frame_num)) < 0) ||
+        (setsockopt(q.fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &comp_num, sizeof(comp_num)) < 0) ||
+        (setsockopt(q.fd, SOL_XDP, XDP_RX_RING, &frame_num, sizeof(frame_num)) < 0))
+    {
+      perror("setsockopt(XDP_RX_RING): ");
+      return false;
+    }
+  }
+
+  {
+    struct xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    ret = getsockopt(q.fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen);
+    if (ret < 0)
+    {
+      perror("getsockopt(XDP_MMAP_OFFSETS): ");
+      return false;
+    }
+
+    if (!mapRing(q.fd, q.fill, off.fr, XDP_UMEM_PGOFF_FILL_RING, sizeof(uint64_t)) ||
+        !mapRing(q.fd, q.comp, off.cr, XDP_UMEM_PGOFF_COMPLETION_RING, sizeof(uint64_t)) ||
+        !mapRing(q.fd, q.rx, off.rx, XDP_PGOFF_RX_RING, sizeof(struct xdp_desc)))
+    {
+      return false;
+    }
+  }
+
+  // all frames to the kernel
+  for (uint32_t i = 0; i < FRAME_NUM; i++)
+  {
+    ((uint64_t*)q.fill.descs)[i] = (uint64_t)i * FRAME_SIZE;
+  }
+  __atomic_store_n(q.fill.producer, FRAME_NUM, __ATOMIC_RELEASE);
+
+  {
+    // generic mode copies packets into UMEM.
+    struct sockaddr_xdp addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sxdp_family = AF_XDP;
+    addr.sxdp_flags = XDP_COPY;
+    addr.sxdp_ifindex = (uint32_t)ifindex_;
+    addr.sxdp_queue_id = queue_id;
+    ret = bind(q.fd, (struct sockaddr*)&addr, sizeof(addr));
+    if (ret < 0)
+    {
+      perror("bind(AF_XDP): ");
+      return false;
+    }
+  }
+
+  {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)xsks_fd_;
+    attr.key = (uint64_t)(uintptr_t)&queue_id;
+    attr.value = (uint64_t)(uintptr_t)&q.fd;
+    attr.flags = BPF_ANY;
+    ret = bpf(BPF_MAP_UPDATE_ELEM, &attr);
+    if (ret < 0)
+    {
+      perror("bpf(BPF_MAP_UPDATE_ELEM): ");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+inline bool XdpPort::updatePort(uint16_t port, bool add)
+{
+  uint32_t key = htons(port);
+  uint32_t value = 1;
+
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = (uint32_t)ports_fd_;
+  attr.key = (uint64_t)(uintptr_t)&key;
+  attr.value = (uint64_t)(uintptr_t)&value;
+  attr.flags = BPF_ANY;
+
+  return (bpf(add ? BPF_MAP_UPDATE_ELEM : BPF_MAP_DELETE_ELEM, &attr) == 0);
+}
+
+inline bool XdpPort::start(XdpSource* src, uint16_t msop_port, uint16_t difop_port)
+{
+  std::lock_guard<std::mutex> lg(mtx_);
+
+  for (const Member& m : members_)
+  {
+    for (uint16_t port : m.ports)
+    {
+      if ((port != 0) && ((port == msop_port) || (port == difop_port)))
+      {
+        RS_ERROR << "UDP port " << port << " is received by another driver on " << device_ << "." << RS_REND;
+        return false;
+      }
+    }
+  }
+
+  stopLoop();
+
+  Member m{src, {msop_port, difop_port}, std::chrono::steady_clock::now()};
+  for (uint16_t port : m.ports)
+  {
+    if ((port != 0) && !updatePort(port, true))
+    {
+      perror("bpf(BPF_MAP_UPDATE_ELEM): ");
+      updatePort(msop_port, false);
+      if (!members_.empty())
+      {
+        startLoop();
+      }
+
+      return false;
+    }
+  }
+
+  members_.push_back(m);
+  startLoop();
+  return true;
+}
+
+inline void XdpPort::stop(XdpSource* src)
+{
+  std::lock_guard<std::mutex> lg(mtx_);
+
+  stopLoop();
+
+  for (auto it = members_.begin(); it != members_.end(); it++)
+  {
+    if (it->src == src)
+    {
+      for (uint16_t port : it->ports)
+      {
+        if (port != 0)
+          updatePort(port, false);
+      }
+
+      members_.erase(it);
+      break;
+    }
+  }
+
+  if (!members_.empty())
+  {
+    startLoop();
+  }
+}
+
+inline void XdpPort::startLoop()
+{
+  to_exit_ = false;
+  thread_ = std::thread(std::bind(&XdpPort::loop, this));
+}
+
+inline void XdpPort::stopLoop()
+{
+  if (!thread_.joinable())
+  {
+    return;
+  }
+
+  to_exit_ = true;
+  uint64_t one = 1;
+  ssize_t ret = write(wake_fd_, &one, sizeof(one));
+  (void)ret;
+
+  thread_.join();
+
+  uint64_t cnt;
+  ret = read(wake_fd_, &cnt, sizeof(cnt));
+}
+
+inline void XdpPort::putFrame(Queue& q, uint64_t addr)
+{
+  // the fill ring has a slot for each frame, so it never overflows.
+  uint32_t prod = *q.fill.producer;
+  ((uint64_t*)q.fill.descs)[prod & q.fill.mask] = addr - (addr % FRAME_SIZE);
+  __atomic_store_n(q.fill.producer, prod + 1, __ATOMIC_RELEASE);
+}
+
+inline void XdpPort::recycle(Buffer* pkt)
+{
+  std::lock_guard<std::mutex> lg(views_mtx_);
+
+  for (Queue& q : queues_)
+  {
+    if ((pkt->buf() >= q.umem) && (pkt->buf() < q.umem + (size_t)FRAME_SIZE * FRAME_NUM))
+    {
+      putFrame(q, (uint64_t)(pkt->buf() - q.umem));
+      break;
+    }
+  }
+
+  free_views_.push_back(pkt);
+}
+
+inline void XdpPort::recvQueue(Queue& q, std::chrono::steady_clock::time_point now)
+{
+  uint32_t cons = *q.rx.consumer;
+  uint32_t prod = __atomic_load_n(q.rx.producer, __ATOMIC_ACQUIRE);
+
+  for (; cons != prod; cons++)
+  {
+    const struct xdp_desc* desc = &((const struct xdp_desc*)q.rx.descs)[cons & q.rx.mask];
+    uint64_t addr = desc->addr;
+    uint8_t* frame = q.umem + addr;
+    size_t len = desc->len;
+
+    // as the program matches it
+    size_t offset = 0;
+    if ((len > 14) && (frame[12] == 0x81) && (frame[13] == 0x00))
+    {
+      offset += VLAN_HDR_LEN;
+    }
+
+    Member* m = NULL;
+    if (len >= offset + ETH_HDR_LEN)
+    {
+      uint16_t port = (uint16_t)((frame[offset + 36] << 8) | frame[offset + 37]);
+      for (Member& mm : members_)
+      {
+        if ((mm.ports[0] == port) || (mm.ports[1] == port))
+        {
+          m = &mm;
+          break;
+        }
+      }
+    }
+
+    if (m == NULL)
+    {
+      // a driver has just been removed.
+      std::lock_guard<std::mutex> lg(views_mtx_);
+      putFrame(q, addr);
+      continue;
+    }
+
+    m->last_recv = now;
+
+    Buffer* view = NULL;
+    {
+      std::lock_guard<std::mutex> lg(views_mtx_);
+      if (!free_views_.empty())
+      {
+        view = free_views_.back();
+        free_views_.pop_back();
+      }
+    }
+
+    if (view != NULL)
+    {
+      view->ref();
+      view->attach(frame, len);
+      view->setData(0, len);
+      m->src->xdpRecv(frame, len, view);
+    }
+    else
+    {
+      m->src->xdpRecv(frame, len, NULL);
+
+      std::lock_guard<std::mutex> lg(views_mtx_);
+      putFrame(q, addr);
+    }
+  }
+
+  __atomic_store_n(q.rx.consumer, cons, __ATOMIC_RELEASE);
+}
+
+inline void XdpPort::loop()
+{
+  std::vector<struct pollfd> pfds(queues_.size() + 1);
+  for (size_t i = 0; i < queues_.size(); i++)
+  {
+    pfds[i].fd = queues_[i].fd;
+    pfds[i].events = POLLIN;
+  }
+  pfds.back().fd = wake_fd_;
+  pfds.back().events = POLLIN;
+
+  const std::chrono::milliseconds timeout(TIMEOUT_MS);
+  int wait_ms = TIMEOUT_MS;
+
+  while (!to_exit_)
+  {
+    int retval = poll(pfds.data(), pfds.size(), wait_ms);
+    if (retval < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      perror("poll: ");
+      break;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < queues_.size(); i++)
+    {
+      if (pfds[i].revents & POLLIN)
+      {
+        recvQueue(queues_[i], now);
+      }
+    }
+
+    // as SockReactor, check each driver for its timeout.
+    std::chrono::steady_clock::duration next = timeout;
+    for (Member& m : members_)
+    {
+      if ((now - m.last_recv) >= timeout)
+      {
+        m.last_recv = now;
+        m.src->xdpTimeout();
+      }
+
+      next = std::min(next, m.last_recv + timeout - now);
+    }
+
+    wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next).count() + 1;
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
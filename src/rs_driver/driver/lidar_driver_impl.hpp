@@ -34,14 +34,27 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <rs_driver/driver/driver_param.hpp>
 #include <rs_driver/msg/packet.hpp>
+#include <rs_driver/msg/packet_view.hpp>
 #include <rs_driver/common/error_code.hpp>
 #include <rs_driver/macro/version.hpp>
 #include <rs_driver/utility/sync_queue.hpp>
+#include <rs_driver/utility/spsc_queue.hpp>
 #include <rs_driver/utility/buffer.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
 #include <rs_driver/driver/input/input_factory.hpp>
 #include <rs_driver/driver/decoder/decoder_factory.hpp>
+#include <rs_driver/driver/packet_recorder.hpp>
 
+#ifndef DISABLE_PCAP_PARSE
+#include <rs_driver/driver/pcap_index_builder.hpp>
+#include <rs_driver/driver/pcap_batch_decoder.hpp>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 namespace robosense
 {
@@ -70,6 +83,8 @@ public:
       const std::function<std::shared_ptr<T_PointCloud>(void)>& cb_get_cloud,
       const std::function<void(std::shared_ptr<T_PointCloud>)>& cb_put_cloud);
   void regPacketCallback(const std::function<void(const Packet&)>& cb_put_pkt);
+  void regPacketViewCallback(const std::function<void(const PacketView&)>& cb_put_pkt_view);
+  void regPacketBatchCallback(const std::function<void(const std::vector<PacketView>&)>& cb_put_pkt_batch);
   void regExceptionCallback(const std::function<void(const Error&)>& cb_excep);
  
   bool init(const RSDriverParam& param);
@@ -77,22 +92,34 @@ public:
   void stop();
 
   void decodePacket(const Packet& pkt);
+#ifndef DISABLE_PCAP_PARSE
+  bool decodePcap(uint32_t thread_num);
+#endif
+  bool startRecord(const std::string& path, const RSRecordParam& param);
+  void stopRecord();
   bool getTemperature(float& temp);
   bool getDeviceInfo(DeviceInfo& info);
   bool getDeviceStatus(DeviceStatus& status);
 
+#ifndef UNIT_TEST
 private:
+#endif
 
-  void runPacketCallBack(uint8_t* data, size_t data_size, double timestamp, uint8_t is_difop, uint8_t is_frame_begin);
+  void runPacketCallBack(Buffer* pkt, double timestamp, uint8_t is_difop, uint8_t is_frame_begin);
+  void runPacketBatchCallBack();
   void runExceptionCallback(const Error& error);
 
-  std::shared_ptr<Buffer> packetGet(size_t size);
-  void packetPut(std::shared_ptr<Buffer> pkt, bool stuffed);
+  Buffer* packetGet(size_t size);
+  void packetPut(Buffer* pkt, bool stuffed);
 
   void processPacket();
-  void internalProcessPacket(std::shared_ptr<Buffer> pkt);
+  void internalProcessPacket(Buffer* pkt);
+  void decodeInline(const uint8_t* data, size_t size);
 
   std::shared_ptr<T_PointCloud> getPointCloud();
+#ifndef DISABLE_PCAP_PARSE
+  bool initPcapRange(const RSDriverParam& param, bool is_jumbo);
+#endif
   void splitFrame(uint16_t height, double ts);
   void setPointCloudHeader(std::shared_ptr<T_PointCloud> msg, uint16_t height, double chan_ts);
 
@@ -100,16 +127,35 @@ private:
   std::function<std::shared_ptr<T_PointCloud>(void)> cb_get_cloud_;
   std::function<void(std::shared_ptr<T_PointCloud>)> cb_put_cloud_;
   std::function<void(const Packet&)> cb_put_pkt_;
+  std::function<void(const PacketView&)> cb_put_pkt_view_;
+  std::function<void(const std::vector<PacketView>&)> cb_put_pkt_batch_;
   std::function<void(const Error&)> cb_excep_;
   std::function<void(const uint8_t*, size_t)> cb_feed_pkt_;
 
+  constexpr static size_t PACKET_POOL_DEFAULT = 1024;
+  constexpr static size_t PACKET_POOL_DEFAULT_JUMBO = 256;
+  constexpr static size_t PACKET_QUEUE_MAX = 8192;
+  constexpr static uint32_t BACKPRESSURE_WAIT_USEC = 100;
+
   std::shared_ptr<Input> input_ptr_;
   std::shared_ptr<Decoder<T_PointCloud>> decoder_ptr_;
-  SyncQueue<std::shared_ptr<Buffer>> free_pkt_queue_;
-  SyncQueue<std::shared_ptr<Buffer>> pkt_queue_;
+  BufferPool pkt_pool_;
+  SpscQueue<Buffer*> pkt_queue_;  // recv thread -> handle thread
   std::thread handle_thread_;
   uint32_t pkt_seq_;
+  std::vector<PacketView> pkt_batch_; // packets of the current frame, held for the batch callback
+  size_t pkt_batch_max_;
   uint32_t point_cloud_seq_;
+  bool pkt_backpressure_; // wait for handle thread, instead of dropping packets
+  bool decode_inline_;    // decode packets in the thread receiving them. No handle thread
+  Buffer inline_pkt_;     // view on the packet passed to decodePacket()
+  bool resync_;           // the input has seeked. Drop points before the first split
+  uint64_t pcap_range_begin_; // records to replay in pcap file, by PcapIndex. 0 means no limit
+  uint64_t pcap_range_end_;
+  uint64_t pcap_range_difop_;
+  PacketRecorder recorder_;
+  std::mutex recorder_mtx_;
+  std::atomic<bool> recording_;
   bool to_exit_handle_;
   bool init_flag_;
   bool start_flag_;
@@ -117,7 +163,11 @@ private:
 
 template <typename T_PointCloud>
 inline LidarDriverImpl<T_PointCloud>::LidarDriverImpl()
-  : pkt_seq_(0), point_cloud_seq_(0), init_flag_(false), start_flag_(false)
+  : pkt_queue_(PACKET_QUEUE_MAX), 
+  pkt_seq_(0), pkt_batch_max_(0), point_cloud_seq_(0), pkt_backpressure_(false), 
+  decode_inline_(false), inline_pkt_(static_cast<BufferRecycler*>(NULL)), resync_(false),
+  pcap_range_begin_(0), pcap_range_end_(0), pcap_range_difop_(0), recording_(false), 
+  init_flag_(false), start_flag_(false)
 {
 }
 
@@ -125,6 +175,7 @@ template <typename T_PointCloud>
 inline LidarDriverImpl<T_PointCloud>::~LidarDriverImpl()
 {
   stop();
+  stopRecord();
 }
 
 template <typename T_PointCloud>
@@ -136,6 +187,11 @@ std::shared_ptr<T_PointCloud> LidarDriverImpl<T_PointCloud>::getPointCloud()
     if (cloud)
     {
       cloud->points.resize(0);
+
+      // reserve a whole frame, so as not to grow it while decoding.
+      // No-op if the cloud is recycled by the user.
+      cloud->points.reserve(decoder_ptr_->pointsPerFrame());
+
       return cloud;
     }
 
@@ -159,6 +215,20 @@ inline void LidarDriverImpl<T_PointCloud>::regPacketCallback(
   cb_put_pkt_ = cb_put_pkt;
 }
 
+template <typename T_PointCloud>
+inline void LidarDriverImpl<T_PointCloud>::regPacketViewCallback(
+    const std::function<void(const PacketView&)>& cb_put_pkt_view)
+{
+  cb_put_pkt_view_ = cb_put_pkt_view;
+}
+
+template <typename T_PointCloud>
+inline void LidarDriverImpl<T_PointCloud>::regPacketBatchCallback(
+    const std::function<void(const std::vector<PacketView>&)>& cb_put_pkt_batch)
+{
+  cb_put_pkt_batch_ = cb_put_pkt_batch;
+}
+
 template <typename T_PointCloud>
 inline void LidarDriverImpl<T_PointCloud>::regExceptionCallback(
     const std::function<void(const Error&)>& cb_excep)
@@ -180,7 +250,7 @@ inline bool LidarDriverImpl<T_PointCloud>::init(const RSDriverParam& param)
   decoder_ptr_ = DecoderFactory<T_PointCloud>::createDecoder(param.lidar_type, param.decoder_param);
   
   // rewrite pkt timestamp or not ?
-  decoder_ptr_->enableWritePktTs((cb_put_pkt_ == nullptr) ? false : true);
+  decoder_ptr_->enableWritePktTs(cb_put_pkt_ || cb_put_pkt_view_ || cb_put_pkt_batch_);
 
   // point cloud related
   decoder_ptr_->point_cloud_ = getPointCloud();
@@ -191,10 +261,80 @@ inline bool LidarDriverImpl<T_PointCloud>::init(const RSDriverParam& param)
   double packet_duration = decoder_ptr_->getPacketDuration();
   bool is_jumbo = isJumbo(param.lidar_type);
 
+  //
+  // packet pool
+  //
+  {
+    size_t pool_size = param.packet_pool_size;
+    if (pool_size == 0)
+    {
+      pool_size = is_jumbo ? PACKET_POOL_DEFAULT_JUMBO : PACKET_POOL_DEFAULT;
+    }
+
+    if (!pkt_pool_.init(is_jumbo ? IP_LEN : ETH_LEN, pool_size, param.packet_pool_hugepage))
+    {
+      RS_ERROR << "Failed to allocate packet pool." << RS_REND;
+      goto failPoolInit;
+    }
+
+    // a frame of packets held for the batch callback may take up to half of the pool.
+    pkt_batch_max_ = std::max<size_t>(pool_size / 2, 1);
+    pkt_batch_.reserve(pkt_batch_max_);
+  }
+
+  //
+  // how handle thread waits for packets
+  //
+  {
+    SpscWait wait;
+    switch (param.wait_policy)
+    {
+      case WaitPolicy::WAIT_BUSY_SPIN:
+        wait.mode = SpscWait::BUSY_SPIN;
+        break;
+
+      case WaitPolicy::WAIT_SPIN_PARK:
+        wait.mode = SpscWait::SPIN_PARK;
+        wait.spin_ns = (uint64_t)param.wait_spin_usec * 1000;
+        wait.adaptive = (param.wait_spin_usec == 0);
+        break;
+
+      case WaitPolicy::WAIT_TIMED_BATCH:
+        wait.mode = SpscWait::TIMED_BATCH;
+        wait.batch_us = param.wait_batch_usec;
+        break;
+
+      case WaitPolicy::WAIT_AUTO:
+      default:
+        // spinning on a single core only delays the recv thread.
+        wait.mode = SpscWait::SPIN_PARK;
+        wait.spin_ns = 0;
+        wait.adaptive = (std::thread::hardware_concurrency() > 1);
+        break;
+    }
+
+    pkt_queue_.setWait(wait, (uint64_t)(packet_duration * 1000000000));
+  }
+
   //
   // input
   //
-  input_ptr_ = InputFactory::createInput(param.input_type, param.input_param, is_jumbo, packet_duration, cb_feed_pkt_);
+  pkt_backpressure_ = ((param.input_type == InputType::PCAP_FILE) || (param.input_type == InputType::RECORD_FILE)) && 
+    (param.input_param.pcap_replay_mode == PcapReplayMode::PCAP_REPLAY_FAST);
+
+  decode_inline_ = param.decode_inline;
+
+  {
+    // no use of arrival time with the LiDAR clock.
+    RSInputParam input_param = param.input_param;
+    input_param.sock_timestamp = input_param.sock_timestamp && !param.decoder_param.use_lidar_clock;
+
+    input_ptr_ = InputFactory::createInput(param.input_type, input_param, is_jumbo, packet_duration, cb_feed_pkt_);
+
+    // the decoder writes the timestamp by host clock only.
+    input_ptr_->enableWritePktTs((cb_put_pkt_ || cb_put_pkt_view_ || cb_put_pkt_batch_) && 
+        !param.decoder_param.use_lidar_clock);
+  }
 
   input_ptr_->regCallback(
       std::bind(&LidarDriverImpl<T_PointCloud>::runExceptionCallback, this, std::placeholders::_1), 
@@ -206,16 +346,161 @@ inline bool LidarDriverImpl<T_PointCloud>::init(const RSDriverParam& param)
     goto failInputInit;
   }
 
+#ifndef DISABLE_PCAP_PARSE
+  if ((param.input_type == InputType::PCAP_FILE) && !initPcapRange(param, is_jumbo))
+  {
+    goto failInputInit;
+  }
+#endif
+
   driver_param_ = param;
   init_flag_ = true;
   return true;
 
 failInputInit:
   input_ptr_.reset();
+failPoolInit:
   decoder_ptr_.reset();
   return false;
 }
 
+#ifndef DISABLE_PCAP_PARSE
+//
+// If a range of frames is specified, seek to it by the frame index of the pcap file.
+// The index is loaded from its sidecar file, or built and saved if it is missing or stale.
+//
+template <typename T_PointCloud>
+inline bool LidarDriverImpl<T_PointCloud>::initPcapRange(const RSDriverParam& param, bool is_jumbo)
+{
+  const RSInputParam& input_param = param.input_param;
+  if ((input_param.pcap_frame_begin == 0) && (input_param.pcap_frame_end == 0) && 
+      (input_param.pcap_time_begin == 0.0) && (input_param.pcap_time_end == 0.0))
+  {
+    return true;
+  }
+
+  if (is_jumbo)
+  {
+    RS_WARNING << "Range of pcap file is not supported for jumbo packets. Replay the whole file." << RS_REND;
+    return true;
+  }
+
+  PcapIndex index;
+  PcapIndexKey key;
+  std::string index_path = PcapIndex::sidecarPath(input_param.pcap_path);
+  if (!PcapIndex::makeKey(param, key))
+  {
+    return false;
+  }
+
+  if (!index.load(index_path, key))
+  {
+    RS_INFO << "Building frame index of " << input_param.pcap_path << " ..." << RS_REND;
+    if (!PcapIndexBuilder<T_PointCloud>::build(param, index))
+    {
+      RS_ERROR << "Failed to build frame index of " << input_param.pcap_path << RS_REND;
+      return false;
+    }
+
+    if (!index.save(index_path))
+    {
+      RS_WARNING << "Failed to save frame index to " << index_path << RS_REND;
+    }
+  }
+
+  size_t begin, end;
+  if (!index.range(input_param, begin, end))
+  {
+    RS_ERROR << "No frame in the range. The pcap file has " << index.size() << " frames." << RS_REND;
+    return false;
+  }
+
+  RS_INFO << "Replay frames [" << begin << ", " << end << ") of " << index.size() << "." << RS_REND;
+
+  pcap_range_begin_ = index[begin].offset;
+  pcap_range_end_ = (end < index.size()) ? index[end].offset : 0;
+  pcap_range_difop_ = index[begin].difop_offset;
+
+  std::shared_ptr<InputPcap> input = std::dynamic_pointer_cast<InputPcap>(input_ptr_);
+  input->setRange(pcap_range_begin_, pcap_range_end_, pcap_range_difop_);
+  return true;
+}
+
+//
+// Decode the whole pcap file (or its range) on a pool of threads, and deliver point clouds in order, 
+// on the calling thread. It is called after init(), instead of start(). The packet callback is not called.
+//
+template <typename T_PointCloud>
+inline bool LidarDriverImpl<T_PointCloud>::decodePcap(uint32_t thread_num)
+{
+  if (!init_flag_)
+  {
+    runExceptionCallback(Error(ERRCODE_STARTBEFOREINIT));
+    return false;
+  }
+
+  if (start_flag_ || (driver_param_.input_type != InputType::PCAP_FILE))
+  {
+    RS_ERROR << "decodePcap() is only for InputType::PCAP_FILE, and not after start()." << RS_REND;
+    return false;
+  }
+
+  // user callbacks are called by decoding threads. Serialize them.
+  std::mutex cb_mtx;
+
+  PcapBatchDecoder<T_PointCloud> batch(driver_param_,
+      [this, &cb_mtx]()
+      {
+        std::lock_guard<std::mutex> lg(cb_mtx);
+        return getPointCloud();
+      },
+      [this](std::shared_ptr<T_PointCloud> cloud, uint16_t height, double ts)
+      {
+        setPointCloudHeader(cloud, height, ts);
+        cb_put_cloud_(cloud);
+      },
+      [this, &cb_mtx](const Error& error)
+      {
+        std::lock_guard<std::mutex> lg(cb_mtx);
+        runExceptionCallback(error);
+      });
+
+  if (!batch.decode(thread_num, pcap_range_begin_, pcap_range_end_, pcap_range_difop_))
+  {
+    return false;
+  }
+
+  runExceptionCallback(Error(ERRCODE_PCAPEXIT));
+  return true;
+}
+#endif
+
+//
+// Record MSOP/DIFOP packets handled by the driver into a packet record, which can be replayed 
+// as InputType::RECORD_FILE. Packets are recorded by the handling thread, without a copy into Packet.
+//
+template <typename T_PointCloud>
+inline bool LidarDriverImpl<T_PointCloud>::startRecord(const std::string& path, const RSRecordParam& param)
+{
+  std::lock_guard<std::mutex> lg(recorder_mtx_);
+  if (!recorder_.open(path, param))
+  {
+    recording_ = false;
+    return false;
+  }
+
+  recording_ = true;
+  return true;
+}
+
+template <typename T_PointCloud>
+inline void LidarDriverImpl<T_PointCloud>::stopRecord()
+{
+  std::lock_guard<std::mutex> lg(recorder_mtx_);
+  recording_ = false;
+  recorder_.close();
+}
+
 template <typename T_PointCloud>
 inline bool LidarDriverImpl<T_PointCloud>::start()
 {
@@ -230,7 +515,10 @@ inline bool LidarDriverImpl<T_PointCloud>::start()
   }
 
   to_exit_handle_ = false;
-  handle_thread_ = std::thread(std::bind(&LidarDriverImpl<T_PointCloud>::processPacket, this));
+  if (!decode_inline_)
+  {
+    handle_thread_ = std::thread(std::bind(&LidarDriverImpl<T_PointCloud>::processPacket, this));
+  }
 
   input_ptr_->start();
 
@@ -249,7 +537,13 @@ inline void LidarDriverImpl<T_PointCloud>::stop()
   input_ptr_->stop();
 
   to_exit_handle_ = true;
-  handle_thread_.join();
+  if (handle_thread_.joinable())
+  {
+    handle_thread_.join();
+  }
+
+  // deliver the last frame, and release its packets.
+  runPacketBatchCallBack();
 
   // clear all points before next session
   if (decoder_ptr_->point_cloud_)
@@ -263,9 +557,52 @@ inline void LidarDriverImpl<T_PointCloud>::stop()
 template <typename T_PointCloud>
 inline void LidarDriverImpl<T_PointCloud>::decodePacket(const Packet& pkt)
 {
+  if (decode_inline_)
+  {
+    decodeInline(pkt.buf_.data(), pkt.buf_.size());
+    return;
+  }
+
   cb_feed_pkt_(pkt.buf_.data(), pkt.buf_.size());
 }
 
+//
+// Decode a RAW_PACKET packet in the calling thread. Point clouds are delivered before it returns.
+// If no packet callback may hold the packet, it is decoded in place, without a copy.
+//
+template <typename T_PointCloud>
+inline void LidarDriverImpl<T_PointCloud>::decodeInline(const uint8_t* data, size_t size)
+{
+  const RSInputParam& input_param = driver_param_.input_param;
+  if (size <= (size_t)(input_param.user_layer_bytes + input_param.tail_layer_bytes))
+  {
+    return;
+  }
+
+  data += input_param.user_layer_bytes;
+  size -= input_param.user_layer_bytes + input_param.tail_layer_bytes;
+
+  if (!cb_put_pkt_ && !cb_put_pkt_view_ && !cb_put_pkt_batch_)
+  {
+    inline_pkt_.attach(const_cast<uint8_t*>(data), size);
+    inline_pkt_.setData(0, size);
+    inline_pkt_.ref();
+    internalProcessPacket(&inline_pkt_);
+    return;
+  }
+
+  // the decoder may write the packet timestamp, and the packet callbacks may hold the packet.
+  Buffer* pkt = packetGet(size);
+  if (pkt == NULL)
+  {
+    return;
+  }
+
+  memcpy(pkt->data(), data, size);
+  pkt->setData(0, size);
+  internalProcessPacket(pkt);
+}
+
 template <typename T_PointCloud>
 inline bool LidarDriverImpl<T_PointCloud>::getTemperature(float& temp)
 {
@@ -301,22 +638,79 @@ inline bool LidarDriverImpl<T_PointCloud>::getDeviceStatus(DeviceStatus& status)
 }
 
 template <typename T_PointCloud>
-inline void LidarDriverImpl<T_PointCloud>::runPacketCallBack(uint8_t* data, size_t data_size,
+inline void LidarDriverImpl<T_PointCloud>::runPacketCallBack(Buffer* pkt,
     double timestamp, uint8_t is_difop, uint8_t is_frame_begin)
 {
+  if (!cb_put_pkt_ && !cb_put_pkt_view_ && !cb_put_pkt_batch_)
+  {
+    return;
+  }
+
+  PacketView view;
+  view.data = pkt->data();
+  view.size = pkt->dataSize();
+  view.timestamp = timestamp;
+  view.seq = pkt_seq_++;
+  view.is_difop = is_difop;
+  view.is_frame_begin = is_frame_begin;
+  view.buf_ = pkt;
+
+  if (cb_put_pkt_view_)
+  {
+    cb_put_pkt_view_(view);
+  }
+
+  if (cb_put_pkt_batch_)
+  {
+    if (is_frame_begin)
+    {
+      runPacketBatchCallBack();
+    }
+
+    pkt->ref();
+    pkt_batch_.push_back(view);
+
+    // so large a frame would exhaust the packet pool. Deliver it in parts.
+    if (pkt_batch_.size() >= pkt_batch_max_)
+    {
+      runPacketBatchCallBack();
+    }
+  }
+
   if (cb_put_pkt_)
   {
-    Packet pkt;
-    pkt.timestamp = timestamp;
-    pkt.is_difop = is_difop;
-    pkt.is_frame_begin = is_frame_begin;
-    pkt.seq = pkt_seq_++;
-    pkt.frame_id = driver_param_.frame_id;
+    Packet msg;
+    msg.timestamp = timestamp;
+    msg.is_difop = is_difop;
+    msg.is_frame_begin = is_frame_begin;
+    msg.seq = view.seq;
+    msg.frame_id = driver_param_.frame_id;
+
+    msg.buf_.resize(view.size);
+    memcpy (msg.buf_.data(), view.data, view.size);
+    cb_put_pkt_(msg);
+  }
+}
+
+//
+// deliver the packets of a frame to the batch callback, and release them.
+//
+template <typename T_PointCloud>
+inline void LidarDriverImpl<T_PointCloud>::runPacketBatchCallBack()
+{
+  if (pkt_batch_.empty())
+  {
+    return;
+  }
+
+  cb_put_pkt_batch_(pkt_batch_);
 
-    pkt.buf_.resize(data_size);
-    memcpy (pkt.buf_.data(), data, data_size);
-    cb_put_pkt_(pkt);
+  for (auto& view : pkt_batch_)
+  {
+    view.buf_->unref();
   }
+
+  pkt_batch_.clear();
 }
 
 template <typename T_PointCloud>
@@ -329,55 +723,100 @@ inline void LidarDriverImpl<T_PointCloud>::runExceptionCallback(const Error& err
 }
 
 template <typename T_PointCloud>
-inline std::shared_ptr<Buffer> LidarDriverImpl<T_PointCloud>::packetGet(size_t size)
+inline Buffer* LidarDriverImpl<T_PointCloud>::packetGet(size_t size)
 {
-  std::shared_ptr<Buffer> pkt = free_pkt_queue_.pop();
-  if (pkt.get() != NULL)
+  Buffer* pkt = NULL;
+  if (size <= pkt_pool_.bufSize())
+  {
+    pkt = pkt_pool_.get();
+
+    // The handle thread is alive until the input stops, so buffers come back.
+    while ((pkt == NULL) && pkt_backpressure_ && !to_exit_handle_)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(BACKPRESSURE_WAIT_USEC));
+      pkt = pkt_pool_.get();
+    }
+  }
+
+  if (pkt == NULL)
   {
-    return pkt;
+    LIMIT_CALL(runExceptionCallback(Error(ERRCODE_PKTBUFOVERFLOW)), 1);
   }
 
-  return std::make_shared<Buffer>(size);
+  return pkt;
 }
 
 template <typename T_PointCloud>
-inline void LidarDriverImpl<T_PointCloud>::packetPut(std::shared_ptr<Buffer> pkt, bool stuffed)
+inline void LidarDriverImpl<T_PointCloud>::packetPut(Buffer* pkt, bool stuffed)
 {
-  constexpr static int PACKET_POOL_MAX = 1024;
-
   if (!stuffed)
   {
-    free_pkt_queue_.push(pkt);
+    pkt->unref();
+    return;
+  }
+
+  if (decode_inline_)
+  {
+    internalProcessPacket(pkt);
     return;
   }
 
   size_t sz = pkt_queue_.push(pkt);
-  if (sz > PACKET_POOL_MAX)
+  while ((sz == 0) && pkt_backpressure_ && !to_exit_handle_)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(BACKPRESSURE_WAIT_USEC));
+    sz = pkt_queue_.push(pkt);
+  }
+
+  if (sz == 0)
   {
     LIMIT_CALL(runExceptionCallback(Error(ERRCODE_PKTBUFOVERFLOW)), 1);
-    pkt_queue_.clear();
+    pkt->unref();
   }
 }
 
 template <typename T_PointCloud>
-inline void LidarDriverImpl<T_PointCloud>::internalProcessPacket(std::shared_ptr<Buffer> pkt)
+inline void LidarDriverImpl<T_PointCloud>::internalProcessPacket(Buffer* pkt)
 {
   static const uint8_t msop_id[] = {0x55, 0xAA};
   static const uint8_t difop_id[] = {0xA5, 0xFF};
 
+  if (pkt->resync())
+  {
+    // points decoded before the seek are of another frame.
+    decoder_ptr_->point_cloud_->points.clear();
+    resync_ = true;
+  }
+
   uint8_t* id = pkt->data();
   if (memcmp(id, msop_id, sizeof(msop_id)) == 0)
   {
+    decoder_ptr_->setHostTs(pkt->timestamp() / 1000);
     bool pkt_to_split = decoder_ptr_->processMsopPkt(pkt->data(), pkt->dataSize());
-    runPacketCallBack(pkt->data(), pkt->dataSize(), decoder_ptr_->prevPktTs(), false, pkt_to_split); // msop packet
+
+    // no split in the first packet after a seek. The frame begins at its first block.
+    resync_ = false;
+    runPacketCallBack(pkt, decoder_ptr_->prevPktTs(), false, pkt_to_split); // msop packet
+
+    if (recording_.load(std::memory_order_relaxed))
+    {
+      std::lock_guard<std::mutex> lg(recorder_mtx_);
+      recorder_.record(pkt->data(), pkt->dataSize(), false, pkt_to_split, decoder_ptr_->prevPktTs());
+    }
   }
   else if(memcmp(id, difop_id, sizeof(difop_id)) == 0)
   {
     decoder_ptr_->processDifopPkt(pkt->data(), pkt->dataSize());
-    runPacketCallBack(pkt->data(), pkt->dataSize(), 0, true, false); // difop packet
+    runPacketCallBack(pkt, 0, true, false); // difop packet
+
+    if (recording_.load(std::memory_order_relaxed))
+    {
+      std::lock_guard<std::mutex> lg(recorder_mtx_);
+      recorder_.record(pkt->data(), pkt->dataSize(), true, false, 0);
+    }
   }
 
-  free_pkt_queue_.push(pkt);
+  pkt->unref();
 }
 
 template <typename T_PointCloud>
@@ -385,8 +824,8 @@ inline void LidarDriverImpl<T_PointCloud>::processPacket()
 {
   while (!to_exit_handle_)
   {
-    std::shared_ptr<Buffer> pkt = pkt_queue_.popWait(500000);
-    if (pkt.get() == NULL)
+    Buffer* pkt = pkt_queue_.popWait(500000);
+    if (pkt == NULL)
     {
       continue;
     }
@@ -399,6 +838,14 @@ template <typename T_PointCloud>
 void LidarDriverImpl<T_PointCloud>::splitFrame(uint16_t height, double ts)
 {
   std::shared_ptr<T_PointCloud> cloud = decoder_ptr_->point_cloud_;
+  if (resync_)
+  {
+    // the first split after a seek. Points before it are the tail of the previous frame.
+    cloud->points.clear();
+    resync_ = false;
+    return;
+  }
+
   if (cloud->points.size() > 0)
   {
     setPointCloudHeader(cloud, height, ts);
@@ -0,0 +1,434 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/common/error_code.hpp>
+#include <rs_driver/driver/driver_param.hpp>
+#include <rs_driver/driver/input/packet_record.hpp>
+#include <rs_driver/msg/packet.hpp>
+#include <rs_driver/msg/packet_view.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Record MSOP/DIFOP packets into a packet record. See packet_record.hpp for the format.
+//
+// A segment is written in place in a preallocated, mapped file, so recording a packet is a memcpy().
+// With LZ4 (or on Windows), it is buffered in memory instead, and written when it is full,
+// on a background thread.
+//
+// record() is called by one thread, such as the packet callback of the driver.
+//
+class PacketRecorder
+{
+public:
+
+  PacketRecorder()
+    : seg_bytes_(0), lz4_(false), seg_(0), off_(0), mem_(NULL), fd_(-1), index_fp_(NULL),
+    difop_pos_(0), frame_num_(0), record_num_(0), ts_first_ns_(0), ts_last_ns_(0), seal_failed_(false)
+  {
+  }
+
+  ~PacketRecorder()
+  {
+    close();
+  }
+
+  PacketRecorder(const PacketRecorder&) = delete;
+  PacketRecorder& operator=(const PacketRecorder&) = delete;
+
+  inline bool open(const std::string& path, const RSRecordParam& param = RSRecordParam());
+  inline void close();
+
+  bool isOpen() const
+  {
+    return (index_fp_ != NULL);
+  }
+
+  //
+  // A MSOP packet of frame_begin (i.e. it splits frames), and the first MSOP packet recorded, begin frames.
+  // They are saved in the frame index, with frame_ts, their LiDAR timestamps. 
+  // return false if the packet is not recorded.
+  //
+  inline bool record(const uint8_t* data, size_t len, bool is_difop, bool frame_begin, double frame_ts);
+
+  //
+  // to be called in the packet callback of the driver.
+  //
+  bool record(const Packet& pkt)
+  {
+    return record(pkt.buf_.data(), pkt.buf_.size(), (pkt.is_difop != 0), (pkt.is_frame_begin != 0), pkt.timestamp);
+  }
+
+  //
+  // to be called in the packet view callback of the driver.
+  //
+  bool record(const PacketView& pkt)
+  {
+    return record(pkt.data, pkt.size, (pkt.is_difop != 0), (pkt.is_frame_begin != 0), pkt.timestamp);
+  }
+
+private:
+
+  inline bool openSegment();
+  inline bool sealSegment();
+  inline void writeSegment(uint32_t seg, RecordSegmentHeader hdr);
+  inline void makeHeader(RecordSegmentHeader& hdr, uint64_t data_bytes);
+
+  static int64_t nowNs()
+  {
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  std::string path_;
+  size_t seg_bytes_;
+  bool lz4_;
+  uint32_t seg_;
+  size_t off_;
+  uint8_t* mem_;        // the current segment, mapped or buffered
+  int fd_;              // the current segment, if mapped. -1 if buffered
+  FILE* index_fp_;
+  uint64_t difop_pos_;  // position of the last DIFOP packet
+  uint64_t frame_num_;
+  uint64_t record_num_; // of the current segment
+  int64_t ts_first_ns_;
+  int64_t ts_last_ns_;
+
+  // buffered segments
+  std::vector<uint8_t> buf_;
+  std::vector<uint8_t> seal_buf_;
+  std::thread seal_thread_;
+  std::atomic<bool> seal_failed_;
+};
+
+inline bool PacketRecorder::open(const std::string& path, const RSRecordParam& param)
+{
+  close();
+
+  path_ = path;
+  seg_bytes_ = (size_t)std::min(std::max(param.segment_mb, (uint32_t)1), (uint32_t)1024) << 20;
+  lz4_ = param.segment_lz4;
+  seg_ = 0;
+  difop_pos_ = 0;
+  frame_num_ = 0;
+  seal_failed_ = false;
+
+#ifndef ENABLE_RECORD_LZ4
+  if (lz4_)
+  {
+    RS_WARNING << "To compress packet record with LZ4, please specify the make option ENABLE_RECORD_LZ4. "
+      << "Record without compression." << RS_REND;
+    lz4_ = false;
+  }
+#endif
+
+  std::string index_path = PacketRecordFormat::indexPath(path);
+  index_fp_ = fopen(index_path.c_str(), "wb");
+  if (index_fp_ == NULL)
+    goto failOpen;
+
+  {
+    RecordIndexHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, PacketRecordFormat::indexMagic(), sizeof(hdr.magic));
+    hdr.version = PacketRecordFormat::VERSION;
+    hdr.frame_size = sizeof(PcapFrame);
+    if ((fwrite(&hdr, sizeof(hdr), 1, index_fp_) != 1) || (fflush(index_fp_) != 0))
+      goto failIndex;
+  }
+
+  // segments of an older record with the same path would be taken as parts of this one.
+  for (uint32_t seg = 0; remove(PacketRecordFormat::segmentPath(path, seg).c_str()) == 0; seg++)
+  {
+  }
+
+  if (!openSegment())
+    goto failIndex;
+
+  return true;
+
+failIndex:
+  fclose(index_fp_);
+  index_fp_ = NULL;
+failOpen:
+  RS_ERROR << "Failed to create packet record " << path << RS_REND;
+  return false;
+}
+
+inline void PacketRecorder::close()
+{
+  if (index_fp_ == NULL)
+    return;
+
+  sealSegment();
+  if (seal_thread_.joinable())
+  {
+    seal_thread_.join();
+  }
+
+  fclose(index_fp_);
+  index_fp_ = NULL;
+
+  buf_ = std::vector<uint8_t>();
+  seal_buf_ = std::vector<uint8_t>();
+}
+
+inline void PacketRecorder::makeHeader(RecordSegmentHeader& hdr, uint64_t data_bytes)
+{
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, PacketRecordFormat::segmentMagic(), sizeof(hdr.magic));
+  hdr.version = PacketRecordFormat::VERSION;
+  hdr.data_bytes = data_bytes;
+  hdr.stored_bytes = data_bytes;
+  hdr.record_num = record_num_;
+  hdr.ts_first_ns = ts_first_ns_;
+  hdr.ts_last_ns = ts_last_ns_;
+}
+
+inline bool PacketRecorder::openSegment()
+{
+  off_ = PacketRecordFormat::SEGMENT_HDR_LEN;
+  record_num_ = 0;
+  ts_first_ns_ = ts_last_ns_ = 0;
+
+  RecordSegmentHeader hdr;
+  makeHeader(hdr, 0);
+
+#ifndef _WIN32
+  if (!lz4_)
+  {
+    std::string seg_path = PacketRecordFormat::segmentPath(path_, seg_);
+    int fd = ::open(seg_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      goto failOpen;
+
+    // reserve the space, so that a full disk fails here, instead of in the middle of a segment.
+    // Both leave the file filled with zeros, which are taken as its end if it is never sealed.
+#ifdef __linux__
+    if ((posix_fallocate(fd, 0, (off_t)seg_bytes_) != 0) && (ftruncate(fd, (off_t)seg_bytes_) != 0))
+      goto failSize;
+#else
+    if (ftruncate(fd, (off_t)seg_bytes_) != 0)
+      goto failSize;
+#endif
+
+    {
+      void* mem = mmap(NULL, seg_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (mem == MAP_FAILED)
+        goto failSize;
+
+      mem_ = (uint8_t*)mem;
+      fd_ = fd;
+      memcpy(mem_, &hdr, sizeof(hdr));
+      return true;
+    }
+
+failSize:
+    ::close(fd);
+    remove(seg_path.c_str());
+failOpen:
+    RS_ERROR << "Failed to create segment " << seg_path << RS_REND;
+    return false;
+  }
+#endif
+
+  buf_.resize(seg_bytes_);
+  mem_ = buf_.data();
+  memcpy(mem_, &hdr, sizeof(hdr));
+  return true;
+}
+
+//
+// seal the current segment. A buffered one is written on the seal thread.
+//
+inline bool PacketRecorder::sealSegment()
+{
+  if (mem_ == NULL)
+    return false;
+
+  RecordSegmentHeader hdr;
+  makeHeader(hdr, off_ - PacketRecordFormat::SEGMENT_HDR_LEN);
+
+#ifndef _WIN32
+  if (fd_ >= 0)
+  {
+    // the kernel writes the pages back. Only give back the unused space.
+    memcpy(mem_, &hdr, sizeof(hdr));
+    munmap(mem_, seg_bytes_);
+    mem_ = NULL;
+
+    bool ret = (ftruncate(fd_, (off_t)off_) == 0);
+    ::close(fd_);
+    fd_ = -1;
+    return ret;
+  }
+#endif
+
+  mem_ = NULL;
+  if (seal_thread_.joinable())
+  {
+    seal_thread_.join();
+  }
+
+  // both buffers keep the size of a segment, so that they are never zeroed again.
+  buf_.swap(seal_buf_);
+
+  seal_thread_ = std::thread(std::bind(&PacketRecorder::writeSegment, this, seg_, hdr));
+  return !seal_failed_;
+}
+
+inline void PacketRecorder::writeSegment(uint32_t seg, RecordSegmentHeader hdr)
+{
+  std::string seg_path = PacketRecordFormat::segmentPath(path_, seg);
+  const uint8_t* data = seal_buf_.data() + PacketRecordFormat::SEGMENT_HDR_LEN;
+
+#ifdef ENABLE_RECORD_LZ4
+  std::vector<uint8_t> lz4_buf;
+  if (lz4_)
+  {
+    size_t data_bytes = (size_t)hdr.data_bytes;
+    lz4_buf.resize(LZ4_compressBound((int)data_bytes));
+    int ret = LZ4_compress_default((const char*)data, (char*)lz4_buf.data(), (int)data_bytes, (int)lz4_buf.size());
+
+    // keep it as is, if it doesn't compress.
+    if ((ret > 0) && ((size_t)ret < data_bytes))
+    {
+      hdr.flags |= PacketRecordFormat::RECORD_SEGMENT_LZ4;
+      hdr.stored_bytes = (uint64_t)ret;
+      data = lz4_buf.data();
+    }
+  }
+#endif
+
+  FILE* fp = fopen(seg_path.c_str(), "wb");
+  if (fp == NULL)
+    goto failOpen;
+
+  if ((fwrite(&hdr, sizeof(hdr), 1, fp) != 1) ||
+      ((hdr.stored_bytes > 0) && (fwrite(data, (size_t)hdr.stored_bytes, 1, fp) != 1)))
+    goto failWrite;
+
+  if (fclose(fp) != 0)
+    goto failClose;
+
+  return;
+
+failWrite:
+  fclose(fp);
+failClose:
+  remove(seg_path.c_str());
+failOpen:
+  RS_ERROR << "Failed to write segment " << seg_path << RS_REND;
+  seal_failed_ = true;
+}
+
+inline bool PacketRecorder::record(const uint8_t* data, size_t len, bool is_difop, bool frame_begin, double frame_ts)
+{
+  size_t rec_len = PacketRecordFormat::recordLen(len);
+  if ((mem_ == NULL) || (len == 0) || (rec_len + PacketRecordFormat::SEGMENT_HDR_LEN > seg_bytes_))
+    return false;
+
+  // the segment is full. Go on with the next one.
+  if (off_ + rec_len > seg_bytes_)
+  {
+    bool sealed = sealSegment();
+    seg_++;
+    if (!openSegment() || !sealed)
+      return false;
+  }
+
+  RecordHeader hdr;
+  hdr.ts_ns = nowNs();
+  hdr.len = (uint32_t)len;
+  hdr.type = is_difop ? PacketRecordFormat::RECORD_TYPE_DIFOP : PacketRecordFormat::RECORD_TYPE_MSOP;
+  frame_begin = !is_difop && (frame_begin || (frame_num_ == 0));
+  hdr.flags = frame_begin ? PacketRecordFormat::RECORD_FRAME_BEGIN : 0;
+
+  uint8_t* p = mem_ + off_;
+  memcpy(p, &hdr, sizeof(hdr));
+  memcpy(p + sizeof(hdr), data, len);
+
+  uint64_t pos = PacketRecordFormat::pos(seg_, off_);
+  off_ += rec_len;
+
+  if (record_num_++ == 0)
+  {
+    ts_first_ns_ = hdr.ts_ns;
+  }
+  ts_last_ns_ = hdr.ts_ns;
+
+  if (is_difop)
+  {
+    difop_pos_ = pos;
+  }
+  else if (frame_begin)
+  {
+    frame_num_++;
+
+    PcapFrame frame;
+    frame.ts = frame_ts;
+    frame.offset = pos; // the packet holding the split. Points before the split are dropped on replay.
+    frame.difop_offset = difop_pos_;
+
+    // flushed at once, so that the index is complete up to the last frame, even if the recorder stops abnormally.
+    if ((fwrite(&frame, sizeof(frame), 1, index_fp_) != 1) || (fflush(index_fp_) != 0))
+    {
+      LIMIT_CALL(RS_WARNING << "Failed to write frame index of packet record " << path_ << RS_REND, 1);
+    }
+  }
+
+  return true;
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,381 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+#include <rs_driver/driver/decoder/decoder_factory.hpp>
+#include <rs_driver/driver/input/input_pcap.hpp>
+#include <rs_driver/driver/input/pcap_reader.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Decode a pcap file on a pool of threads, for offline processing.
+//
+// The file is cut into chunks at MSOP records by a quick scan of record headers. Each thread 
+// decodes a chunk with its own decoder, from the last DIFOP before it. A chunk owns the frames 
+// split within it. It drops the points before its first split, and decodes past its end until the 
+// next split, so frames are the same as decoding the file on one thread. Clouds are delivered
+// in order on the calling thread.
+//
+template <typename T_PointCloud>
+class PcapBatchDecoder
+{
+public:
+
+  PcapBatchDecoder(const RSDriverParam& param,
+      const std::function<std::shared_ptr<T_PointCloud>(void)>& cb_get_cloud,
+      const std::function<void(std::shared_ptr<T_PointCloud>, uint16_t, double)>& cb_put_cloud,
+      const std::function<void(const Error&)>& cb_excep)
+    : param_(param), cb_get_cloud_(cb_get_cloud), cb_put_cloud_(cb_put_cloud), cb_excep_(cb_excep),
+    chunk_bytes_(CHUNK_BYTES), next_chunk_(0), delivered_(0), window_(0)
+  {
+  }
+
+  //
+  // decode records in [begin, end] of the file on thread_num threads, and return after all clouds
+  // are delivered. difop is decoded before begin. Offsets are from PcapIndex. 0 means no limit.
+  //
+  bool decode(uint32_t thread_num, uint64_t begin = 0, uint64_t end = 0, uint64_t difop = 0);
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  struct Frame
+  {
+    std::shared_ptr<T_PointCloud> cloud;
+    uint16_t height;
+    double ts;
+  };
+
+  struct Chunk
+  {
+    uint64_t warm;   // record to decode from. It is before begin, so the first split is found as in the whole file.
+    uint64_t begin;  // first record of the chunk. Splits before it belong to the previous chunk.
+    uint64_t end;    // the first split at or after it closes the last frame. 0 means no limit
+    uint64_t difop;  // DIFOP record to decode first. 0 if none
+    std::vector<Frame> frames;
+    bool done;
+  };
+
+  bool scan(uint64_t begin, uint64_t end, uint64_t difop);
+  void work();
+  void decodeChunk(PcapReader& reader, Chunk& chunk);
+
+  constexpr static uint64_t CHUNK_BYTES = 16 * 1024 * 1024;
+  constexpr static uint32_t WAIT_MSEC = 100;
+
+  RSDriverParam param_;
+  std::function<std::shared_ptr<T_PointCloud>(void)> cb_get_cloud_;
+  std::function<void(std::shared_ptr<T_PointCloud>, uint16_t, double)> cb_put_cloud_;
+  std::function<void(const Error&)> cb_excep_;
+
+  uint64_t chunk_bytes_;
+  uint64_t range_begin_;
+  uint64_t range_end_;
+  std::vector<Chunk> chunks_;
+  std::atomic<size_t> next_chunk_;
+  size_t delivered_;
+  size_t window_;  // chunks decoded ahead of delivery, to limit memory of clouds
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+template <typename T_PointCloud>
+inline bool PcapBatchDecoder<T_PointCloud>::decode(uint32_t thread_num, uint64_t begin, uint64_t end, uint64_t difop)
+{
+  if (isJumbo(param_.lidar_type))
+  {
+    RS_ERROR << "Jumbo LiDARs are not supported by parallel decoding." << RS_REND;
+    return false;
+  }
+
+  if (!scan(begin, end, difop))
+  {
+    cb_excep_(Error(ERRCODE_PCAPWRONGPATH));
+    return false;
+  }
+
+  if (thread_num == 0)
+  {
+    thread_num = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  thread_num = (uint32_t)std::min((size_t)thread_num, chunks_.size());
+  window_ = (size_t)thread_num * 2;
+
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < thread_num; i++)
+  {
+    threads.emplace_back(std::bind(&PcapBatchDecoder<T_PointCloud>::work, this));
+  }
+
+  for (size_t i = 0; i < chunks_.size(); i++)
+  {
+    {
+      std::unique_lock<std::mutex> ul(mtx_);
+      while (!chunks_[i].done)
+        cv_.wait_for(ul, std::chrono::milliseconds(WAIT_MSEC));
+    }
+
+    for (auto& frame : chunks_[i].frames)
+    {
+      cb_put_cloud_(frame.cloud, frame.height, frame.ts);
+    }
+    chunks_[i].frames.clear();
+
+    {
+      std::lock_guard<std::mutex> lg(mtx_);
+      delivered_ = i + 1;
+    }
+    cv_.notify_all();
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  return true;
+}
+
+//
+// Cut the file into chunks of chunk_bytes_. Only record headers and UDP headers are read.
+//
+template <typename T_PointCloud>
+inline bool PcapBatchDecoder<T_PointCloud>::scan(uint64_t begin, uint64_t end, uint64_t difop)
+{
+  static const uint8_t msop_id[] = {0x55, 0xAA};
+  static const uint8_t difop_id[] = {0xA5, 0xFF};
+
+  PcapReader reader;
+  if (!reader.open(param_.input_param.pcap_path))
+    return false;
+
+  if (begin != 0)
+    reader.seek(begin);
+
+  // Frames split by block number depend on all blocks before. They can't be cut.
+  bool can_cut = !isMech(param_.lidar_type) || (param_.decoder_param.split_frame_mode == SplitFrameMode::SPLIT_BY_ANGLE);
+  if (!can_cut)
+  {
+    RS_WARNING << "Frames split by blocks can't be decoded in parallel. Decode on one thread." << RS_REND;
+  }
+  else if (!reader.isMapped())
+  {
+    // a thread would decompress the file from the beginning, to seek to its chunk.
+    RS_WARNING << "Compressed pcap file can't be decoded in parallel. Decode on one thread." << RS_REND;
+    can_cut = false;
+  }
+
+  range_begin_ = begin;
+  range_end_ = end;
+  chunks_.clear();
+
+  uint64_t first = reader.tell();
+  chunks_.push_back(Chunk{first, first, 0, difop, {}, false});
+
+  uint64_t prev_msop = 0;     // previous MSOP record
+  uint64_t prev_difop = difop; // last DIFOP record before prev_msop
+  uint64_t last_difop = difop;
+
+  while (1)
+  {
+    uint64_t off = reader.tell();
+    if ((end != 0) && (off > end))
+      break;
+
+    PcapRecord rec;
+    if (!reader.next(rec))
+      break;
+
+    size_t data_off, data_size;
+    if (!InputPcap::parsePacket(rec.link_type, rec, param_.input_param, data_off, data_size) || 
+        (data_size < sizeof(msop_id)))
+      continue;
+
+    const uint8_t* data = rec.data + data_off;
+    if (memcmp(data, difop_id, sizeof(difop_id)) == 0)
+    {
+      last_difop = off;
+      continue;
+    }
+
+    if (memcmp(data, msop_id, sizeof(msop_id)) != 0)
+      continue;
+
+    if (can_cut && (prev_msop != 0) && (off - chunks_.back().begin >= chunk_bytes_))
+    {
+      chunks_.back().end = off;
+      chunks_.push_back(Chunk{prev_msop, off, 0, prev_difop, {}, false});
+    }
+
+    prev_msop = off;
+    prev_difop = last_difop;
+  }
+
+  return true;
+}
+
+template <typename T_PointCloud>
+inline void PcapBatchDecoder<T_PointCloud>::work()
+{
+  PcapReader reader;
+  bool opened = reader.open(param_.input_param.pcap_path);
+
+  while (1)
+  {
+    size_t i = next_chunk_++;
+    if (i >= chunks_.size())
+      break;
+
+    {
+      std::unique_lock<std::mutex> ul(mtx_);
+      while (i >= delivered_ + window_)
+        cv_.wait_for(ul, std::chrono::milliseconds(WAIT_MSEC));
+    }
+
+    if (opened)
+    {
+      decodeChunk(reader, chunks_[i]);
+    }
+
+    {
+      std::lock_guard<std::mutex> lg(mtx_);
+      chunks_[i].done = true;
+    }
+    cv_.notify_all();
+  }
+}
+
+template <typename T_PointCloud>
+inline void PcapBatchDecoder<T_PointCloud>::decodeChunk(PcapReader& reader, Chunk& chunk)
+{
+  static const uint8_t msop_id[] = {0x55, 0xAA};
+  static const uint8_t difop_id[] = {0xA5, 0xFF};
+
+  std::shared_ptr<Decoder<T_PointCloud>> decoder = 
+    DecoderFactory<T_PointCloud>::createDecoder(param_.lidar_type, param_.decoder_param);
+  decoder->point_cloud_ = cb_get_cloud_();
+
+  uint64_t rec_off = chunk.warm;
+
+  // The first chunk of a range begins in the middle of a frame, as LidarDriverImpl after a seek.
+  // Its first split is in its first packet, or at the first block of it.
+  bool resync = (chunk.warm == chunk.begin) && (range_begin_ != 0);
+  bool started = (chunk.warm == chunk.begin) && !resync; // the first chunk of the file
+  bool closed = false;
+
+  decoder->regCallback(cb_excep_,
+      [&](uint16_t height, double ts)
+      {
+        if (!started)
+        {
+          // points of the previous chunk
+          decoder->point_cloud_->points.clear();
+          started = (rec_off >= chunk.begin);
+          closed = started && (chunk.end != 0) && (rec_off >= chunk.end);
+          return;
+        }
+
+        // Same as LidarDriverImpl::splitFrame()
+        if (decoder->point_cloud_->points.size() > 0)
+        {
+          chunk.frames.push_back(Frame{decoder->point_cloud_, height, ts});
+          decoder->point_cloud_ = cb_get_cloud_();
+        }
+        else
+        {
+          cb_excep_(Error(ERRCODE_ZEROPOINTS));
+        }
+
+        closed = ((chunk.end != 0) && (rec_off >= chunk.end));
+      });
+
+  PcapRecord rec;
+  if ((chunk.difop != 0) && reader.seek(chunk.difop) && reader.next(rec))
+  {
+    size_t data_off, data_size;
+    if (InputPcap::parsePacket(rec.link_type, rec, param_.input_param, data_off, data_size))
+    {
+      decoder->processDifopPkt(rec.data + data_off, data_size);
+    }
+  }
+
+  reader.seek(chunk.warm);
+  while (!closed)
+  {
+    rec_off = reader.tell();
+    if ((range_end_ != 0) && (rec_off > range_end_))
+      break;
+
+    if (!reader.next(rec))
+      break;
+
+    size_t data_off, data_size;
+    if (!InputPcap::parsePacket(rec.link_type, rec, param_.input_param, data_off, data_size) || 
+        (data_size < sizeof(msop_id)))
+      continue;
+
+    const uint8_t* data = rec.data + data_off;
+    if (memcmp(data, msop_id, sizeof(msop_id)) == 0)
+    {
+      decoder->processMsopPkt(data, data_size);
+      if (resync)
+      {
+        // no split in the first packet. The frame begins at its first block.
+        started = true;
+        resync = false;
+      }
+    }
+    else if (memcmp(data, difop_id, sizeof(difop_id)) == 0)
+    {
+      decoder->processDifopPkt(data, data_size);
+    }
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
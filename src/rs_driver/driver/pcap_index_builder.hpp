@@ -0,0 +1,130 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+#include <rs_driver/driver/decoder/decoder_factory.hpp>
+#include <rs_driver/driver/input/input_pcap.hpp>
+#include <rs_driver/driver/input/pcap_index.hpp>
+#include <rs_driver/driver/input/pcap_reader.hpp>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Build the frame index of a pcap file. Packets are decoded by a decoder of the same parameters,
+// so frames are split exactly as in replay.
+//
+template <typename T_PointCloud>
+class PcapIndexBuilder
+{
+public:
+  static bool build(const RSDriverParam& param, PcapIndex& index);
+};
+
+template <typename T_PointCloud>
+inline bool PcapIndexBuilder<T_PointCloud>::build(const RSDriverParam& param, PcapIndex& index)
+{
+  static const uint8_t msop_id[] = {0x55, 0xAA};
+  static const uint8_t difop_id[] = {0xA5, 0xFF};
+
+  PcapIndexKey key;
+  if (!PcapIndex::makeKey(param, key))
+    return false;
+
+  PcapReader reader;
+  if (!reader.open(param.input_param.pcap_path))
+    return false;
+
+  // index by LiDAR clock, whatever the clock of point cloud.
+  RSDecoderParam decoder_param = param.decoder_param;
+  decoder_param.use_lidar_clock = true;
+
+  std::shared_ptr<Decoder<T_PointCloud>> decoder = 
+    DecoderFactory<T_PointCloud>::createDecoder(param.lidar_type, decoder_param);
+  decoder->point_cloud_ = std::make_shared<T_PointCloud>();
+
+  index.reset(key);
+
+  uint64_t rec_off = reader.tell();
+  uint64_t difop_off = 0;
+  PcapFrame frame = {0.0, rec_off, 0};
+
+  // Same as LidarDriverImpl::splitFrame(). An empty cloud is not a frame, and its points go to the next one.
+  decoder->regCallback(
+      [](const Error&) {},
+      [&](uint16_t, double ts)
+      {
+        if (decoder->point_cloud_->points.size() > 0)
+        {
+          frame.ts = ts;
+          index.add(frame);
+          decoder->point_cloud_->points.clear();
+        }
+
+        frame.offset = rec_off;
+        frame.difop_offset = difop_off;
+      });
+
+  while (1)
+  {
+    rec_off = reader.tell();
+
+    PcapRecord rec;
+    if (!reader.next(rec))
+      break;
+
+    size_t data_off, data_size;
+    if (!InputPcap::parsePacket(rec.link_type, rec, param.input_param, data_off, data_size) || 
+        (data_size < sizeof(msop_id)))
+      continue;
+
+    const uint8_t* data = rec.data + data_off;
+    if (memcmp(data, msop_id, sizeof(msop_id)) == 0)
+    {
+      decoder->processMsopPkt(data, data_size);
+    }
+    else if (memcmp(data, difop_id, sizeof(difop_id)) == 0)
+    {
+      decoder->processDifopPkt(data, data_size);
+      difop_off = rec_off;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace lidar
+}  // namespace robosense
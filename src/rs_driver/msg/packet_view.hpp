@@ -0,0 +1,142 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/utility/buffer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace robosense
+{
+namespace lidar
+{
+class PacketHandle;
+
+//
+// A MSOP/DIFOP packet, as a view on the packet buffer of the driver. No copy.
+// It is valid only in the packet view callback. To keep it longer, take a PacketHandle with hold().
+//
+struct PacketView
+{
+  const uint8_t* data = NULL;
+  size_t size = 0;
+  double timestamp = 0.0;
+  uint32_t seq = 0;
+  uint8_t is_difop = 0;
+  uint8_t is_frame_begin = 0;
+
+  inline PacketHandle hold() const;
+
+  Buffer* buf_ = NULL;  ///< The buffer that data points into
+};
+
+//
+// A reference to the buffer of a PacketView. The buffer is not reused by the driver until all handles
+// on it are released, so the view keeps valid.
+// Handles hold buffers of the packet pool of the driver (see RSDriverParam::packet_pool_size), so release them
+// soon, or new packets are dropped. Release them before the driver is destroyed.
+//
+class PacketHandle
+{
+public:
+  PacketHandle() = default;
+
+  explicit PacketHandle(const PacketView& view)
+    : view_(view)
+  {
+    if (view_.buf_ != NULL)
+    {
+      view_.buf_->ref();
+    }
+  }
+
+  PacketHandle(const PacketHandle& other)
+    : PacketHandle(other.view_)
+  {
+  }
+
+  PacketHandle(PacketHandle&& other) noexcept
+    : view_(other.view_)
+  {
+    other.view_ = PacketView();
+  }
+
+  PacketHandle& operator=(PacketHandle other) noexcept
+  {
+    std::swap(view_, other.view_);
+    return *this;
+  }
+
+  ~PacketHandle()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    if (view_.buf_ != NULL)
+    {
+      view_.buf_->unref();
+    }
+
+    view_ = PacketView();
+  }
+
+  explicit operator bool() const
+  {
+    return (view_.buf_ != NULL);
+  }
+
+  const PacketView& view() const
+  {
+    return view_;
+  }
+
+  const PacketView* operator->() const
+  {
+    return &view_;
+  }
+
+private:
+  PacketView view_;
+};
+
+inline PacketHandle PacketView::hold() const
+{
+  return PacketHandle(*this);
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -32,6 +32,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
@@ -40,22 +41,78 @@ namespace robosense
 {
 namespace lidar
 {
+class Buffer;
+
+//
+// Owner of buffers, such as the packet pool, or an input whose buffers are views on its own memory.
+// A buffer goes back to its recycler when the last reference is dropped.
+//
+class BufferRecycler
+{
+public:
+  virtual void recycle(Buffer* pkt) = 0;
+  virtual ~BufferRecycler() = default;
+};
+
 class Buffer
 {
 public:
 
   Buffer(size_t buf_size)
-    : data_off_(0), data_size_(0)
+    : ext_buf_(NULL), recycler_(NULL), refs_(0), data_off_(0), data_size_(0), ts_(0), resync_(false)
   {
     buf_.resize(buf_size);
     buf_size_ = buf_size;
   }
 
+  //
+  // view on external memory, which is attached later with attach().
+  //
+  Buffer(BufferRecycler* recycler)
+    : ext_buf_(NULL), recycler_(recycler), refs_(0), buf_size_(0), data_off_(0), data_size_(0), ts_(0), resync_(false)
+  {
+  }
+
   ~Buffer() = default;
 
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+
+  void attach(uint8_t* ext_buf, size_t buf_size)
+  {
+    ext_buf_ = ext_buf;
+    buf_size_ = buf_size;
+  }
+
+  BufferRecycler* recycler() const
+  {
+    return recycler_;
+  }
+
+  void ref()
+  {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //
+  // drop a reference. The last one returns the buffer to its recycler, if any.
+  //
+  void unref()
+  {
+    if ((refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) && (recycler_ != NULL))
+    {
+      recycler_->recycle(this);
+    }
+  }
+
+  uint32_t refs() const
+  {
+    return refs_.load(std::memory_order_relaxed);
+  }
+
   uint8_t* buf()
   {
-    return buf_.data();
+    return (ext_buf_ != NULL) ? ext_buf_ : buf_.data();
   }
 
   size_t bufSize() const
@@ -79,11 +136,42 @@ public:
     data_size_ = data_size;
   }
 
+  //
+  // host time when the packet arrived, in nanoseconds since epoch, as stamped by the kernel. 0 if unknown.
+  //
+  uint64_t timestamp() const
+  {
+    return ts_;
+  }
+
+  void setTimestamp(uint64_t ts)
+  {
+    ts_ = ts;
+  }
+
+  //
+  // the first packet after the input seeks in a file. Frames are split afresh from it.
+  //
+  bool resync() const
+  {
+    return resync_;
+  }
+
+  void setResync(bool resync)
+  {
+    resync_ = resync;
+  }
+
 private:
   std::vector<uint8_t> buf_;
+  uint8_t* ext_buf_;
+  BufferRecycler* recycler_;
+  std::atomic<uint32_t> refs_;
   size_t buf_size_;
   size_t data_off_;
   size_t data_size_;
+  uint64_t ts_;
+  bool resync_;
 };
 }  // namespace lidar
 }  // namespace robosense
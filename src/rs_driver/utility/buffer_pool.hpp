@@ -0,0 +1,257 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/utility/buffer.hpp>
+#include <rs_driver/common/rs_log.hpp>
+
+#include <atomic>
+#include <memory>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// Fixed-capacity pool of packet buffers.
+//
+// All buffers are carved out of one slab, allocated at init(), optionally on huge pages.
+// Free buffers are kept in a lock-free stack of indexes, tagged against ABA, so get() and
+// recycle() can be called from different threads without locks. get() returns NULL if
+// the pool is exhausted.
+//
+class BufferPool : public BufferRecycler
+{
+public:
+  BufferPool()
+    : mem_(NULL), mem_size_(0), mmaped_(false), hugepage_(false),
+      bufs_(NULL), buf_size_(0), buf_num_(0), top_(NIL)
+  {
+  }
+
+  virtual ~BufferPool();
+
+  bool init(size_t buf_size, size_t buf_num, bool use_hugepage = false);
+
+  inline Buffer* get();
+  virtual void recycle(Buffer* pkt);
+
+  size_t bufSize() const
+  {
+    return buf_size_;
+  }
+
+  size_t bufNum() const
+  {
+    return buf_num_;
+  }
+
+  bool hugepage() const
+  {
+    return hugepage_;
+  }
+
+private:
+  inline void release();
+
+  constexpr static uint32_t NIL = 0xFFFFFFFF;
+  constexpr static size_t BUF_ALIGN = 64;
+  constexpr static size_t HUGEPAGE_SIZE = (2 << 20);
+
+  uint8_t* mem_;
+  size_t mem_size_;
+  bool mmaped_;
+  bool hugepage_;
+  Buffer* bufs_;
+  size_t buf_size_;
+  size_t buf_num_;
+  std::unique_ptr<std::atomic<uint32_t>[]> next_;
+  std::atomic<uint64_t> top_;  // (tag << 32) | index
+};
+
+inline BufferPool::~BufferPool()
+{
+  release();
+}
+
+inline bool BufferPool::init(size_t buf_size, size_t buf_num, bool use_hugepage)
+{
+  if (mem_ != NULL)
+  {
+    return true;
+  }
+
+  if ((buf_num == 0) || (buf_num >= NIL))
+  {
+    return false;
+  }
+
+  size_t stride = (buf_size + BUF_ALIGN - 1) / BUF_ALIGN * BUF_ALIGN;
+  size_t mem_size = stride * buf_num;
+
+#ifndef _WIN32
+  if (use_hugepage)
+  {
+    size_t huge_size = (mem_size + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE * HUGEPAGE_SIZE;
+    void* mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, 
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (mem != MAP_FAILED)
+    {
+      mem_ = (uint8_t*)mem;
+      mem_size_ = huge_size;
+      mmaped_ = true;
+      hugepage_ = true;
+    }
+    else
+    {
+      RS_WARNING << "Failed to allocate packet pool on huge pages. Use normal pages instead." << RS_REND;
+    }
+  }
+
+  if (mem_ == NULL)
+  {
+    void* mem = mmap(NULL, mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+      return false;
+    }
+
+    mem_ = (uint8_t*)mem;
+    mem_size_ = mem_size;
+    mmaped_ = true;
+  }
+#else
+  if (use_hugepage)
+  {
+    RS_WARNING << "Packet pool on huge pages is not supported on this platform." << RS_REND;
+  }
+
+  mem_ = new (std::nothrow) uint8_t[mem_size];
+  if (mem_ == NULL)
+  {
+    return false;
+  }
+  mem_size_ = mem_size;
+#endif
+
+  bufs_ = static_cast<Buffer*>(::operator new(sizeof(Buffer) * buf_num));
+  next_.reset(new std::atomic<uint32_t>[buf_num]);
+  for (size_t i = 0; i < buf_num; i++)
+  {
+    Buffer* pkt = new (&bufs_[i]) Buffer(static_cast<BufferRecycler*>(this));
+    pkt->attach(mem_ + i * stride, buf_size);
+    next_[i] = (i + 1 < buf_num) ? (uint32_t)(i + 1) : NIL;
+  }
+
+  buf_size_ = buf_size;
+  buf_num_ = buf_num;
+  top_ = 0;
+
+  return true;
+}
+
+inline void BufferPool::release()
+{
+  if (mem_ == NULL)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < buf_num_; i++)
+  {
+    bufs_[i].~Buffer();
+  }
+  ::operator delete(bufs_);
+  bufs_ = NULL;
+
+#ifndef _WIN32
+  munmap(mem_, mem_size_);
+#else
+  delete[] mem_;
+#endif
+  mem_ = NULL;
+}
+
+inline Buffer* BufferPool::get()
+{
+  uint64_t top = top_.load(std::memory_order_acquire);
+  uint32_t idx;
+
+  while (1)
+  {
+    idx = (uint32_t)top;
+    if (idx == NIL)
+    {
+      return NULL;
+    }
+
+    uint32_t next = next_[idx].load(std::memory_order_relaxed);
+    uint64_t new_top = (((top >> 32) + 1) << 32) | next;
+    if (top_.compare_exchange_weak(top, new_top, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      break;
+    }
+  }
+
+  Buffer* pkt = &bufs_[idx];
+  pkt->setData(0, 0);
+  pkt->setTimestamp(0);
+  pkt->setResync(false);
+  pkt->ref();
+  return pkt;
+}
+
+inline void BufferPool::recycle(Buffer* pkt)
+{
+  uint32_t idx = (uint32_t)(pkt - bufs_);
+  uint64_t top = top_.load(std::memory_order_relaxed);
+
+  while (1)
+  {
+    next_[idx].store((uint32_t)top, std::memory_order_relaxed);
+    uint64_t new_top = (((top >> 32) + 1) << 32) | idx;
+    if (top_.compare_exchange_weak(top, new_top, std::memory_order_release, std::memory_order_relaxed))
+    {
+      break;
+    }
+  }
+}
+
+}  // namespace lidar
+}  // namespace robosense
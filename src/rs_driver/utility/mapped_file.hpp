@@ -0,0 +1,209 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h> // before windows.h, which may include winsock.h
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// A file mapped copy-on-write into memory. Writes to the memory never go to the file. But they 
+// take private pages, so inputs copy packets which the decoder rewrites (e.g. timestamp).
+//
+class MappedFile
+{
+public:
+
+  MappedFile()
+    : mem_(NULL), size_(0)
+#ifdef _WIN32
+    , file_(INVALID_HANDLE_VALUE), mapping_(NULL)
+#endif
+  {
+  }
+
+  ~MappedFile()
+  {
+    unmap();
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  //
+  // map the whole file. An empty file can't be mapped.
+  //
+  inline bool map(const std::string& path);
+  inline void unmap();
+
+  uint8_t* data() const
+  {
+    return mem_;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+private:
+  uint8_t* mem_;
+  size_t size_;
+
+#ifdef _WIN32
+  HANDLE file_;
+  HANDLE mapping_;
+#endif
+};
+
+#ifdef _WIN32
+
+inline bool MappedFile::map(const std::string& path)
+{
+  LARGE_INTEGER size;
+  void* mem;
+
+  unmap();
+
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 
+      FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file_ == INVALID_HANDLE_VALUE)
+    goto failOpen;
+
+  if (!GetFileSizeEx(file_, &size) || (size.QuadPart == 0))
+    goto failSize;
+
+  mapping_ = CreateFileMappingA(file_, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  if (mapping_ == NULL)
+    goto failMapping;
+
+  mem = MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0);
+  if (mem == NULL)
+    goto failView;
+
+  mem_ = (uint8_t*)mem;
+  size_ = (size_t)size.QuadPart;
+  return true;
+
+failView:
+  CloseHandle(mapping_);
+  mapping_ = NULL;
+failMapping:
+failSize:
+  CloseHandle(file_);
+  file_ = INVALID_HANDLE_VALUE;
+failOpen:
+  return false;
+}
+
+inline void MappedFile::unmap()
+{
+  if (mem_ != NULL)
+  {
+    UnmapViewOfFile(mem_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    mem_ = NULL;
+    mapping_ = NULL;
+    file_ = INVALID_HANDLE_VALUE;
+    size_ = 0;
+  }
+}
+
+#else
+
+inline bool MappedFile::map(const std::string& path)
+{
+  struct stat st;
+  void* mem;
+
+  unmap();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    goto failOpen;
+
+  if ((fstat(fd, &st) < 0) || (st.st_size == 0))
+    goto failSize;
+
+  mem = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (mem == MAP_FAILED)
+  {
+    perror("mmap: ");
+    goto failMmap;
+  }
+
+  madvise(mem, (size_t)st.st_size, MADV_SEQUENTIAL);
+  ::close(fd);
+
+  mem_ = (uint8_t*)mem;
+  size_ = (size_t)st.st_size;
+  return true;
+
+failMmap:
+failSize:
+  ::close(fd);
+failOpen:
+  return false;
+}
+
+inline void MappedFile::unmap()
+{
+  if (mem_ != NULL)
+  {
+    munmap(mem_, size_);
+    mem_ = NULL;
+    size_ = 0;
+  }
+}
+
+#endif
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,319 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RS_HAS_MM_PAUSE
+#include <immintrin.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// How popWait() waits if the queue is empty.
+//
+struct SpscWait
+{
+  enum Mode
+  {
+    BUSY_SPIN = 0,   // spin until a value comes, or timeout
+    SPIN_PARK,       // spin for spin_ns, and then park on a condition variable
+    TIMED_BATCH      // sleep for batch_us, and let the caller drain the queue
+  };
+
+  Mode mode = SPIN_PARK;
+  uint64_t spin_ns = 2000;
+  uint32_t batch_us = 1000;
+  bool adaptive = false;  // SPIN_PARK: tune spin_ns with the observed inter-arrival time
+};
+
+//
+// Bounded single-producer/single-consumer ring.
+//
+// push() is called by one thread, and pop()/popWait()/clear() by another one. push() and pop()
+// are wait-free. The producer only takes the mutex if the consumer is parked.
+//
+template <typename T>
+class SpscQueue
+{
+public:
+  explicit SpscQueue(size_t capacity = 1024)
+    : head_(0), tail_cache_(0), tail_(0), head_cache_(0), waiting_(false),
+    interval_ns_(0), last_arrival_ns_(0)
+  {
+    size_t cap = 1;
+    while (cap < capacity)
+      cap <<= 1;
+
+    slots_.resize(cap);
+    mask_ = cap - 1;
+  }
+
+  size_t capacity() const
+  {
+    return slots_.size();
+  }
+
+  //
+  // called by the consumer, or before it starts.
+  // expected_interval_ns seeds the adaptive spin time.
+  //
+  void setWait(const SpscWait& wait, uint64_t expected_interval_ns = 0)
+  {
+    wait_ = wait;
+    interval_ns_ = expected_interval_ns;
+    last_arrival_ns_ = 0;
+
+    if (wait_.adaptive)
+    {
+      wait_.spin_ns = adaptSpin(interval_ns_);
+    }
+  }
+
+  const SpscWait& getWait() const
+  {
+    return wait_;
+  }
+
+  //
+  // return size of the queue after pushing, or 0 if the queue is full and value is not pushed.
+  // The size is seen by the producer, so it may be larger than the real one.
+  //
+  inline size_t push(const T& value)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_)
+    {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_)
+        return 0;
+    }
+
+    slots_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed))
+    {
+      std::lock_guard<std::mutex> lg(mtx_);
+      cv_.notify_one();
+    }
+
+    return tail + 1 - head_cache_;
+  }
+
+  inline T pop()
+  {
+    T value = T();
+
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_)
+    {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_)
+        return value;
+    }
+
+    T& slot = slots_[head & mask_];
+    value = std::move(slot);
+    slot = T();
+    head_.store(head + 1, std::memory_order_release);
+
+    return value;
+  }
+
+  inline T popWait(unsigned int usec = 1000000)
+  {
+    if (!empty())
+      return pop();
+
+    switch (wait_.mode)
+    {
+      case SpscWait::BUSY_SPIN:
+        spinWait((uint64_t)usec * 1000);
+        break;
+
+      case SpscWait::TIMED_BATCH:
+        std::this_thread::sleep_for(std::chrono::microseconds(wait_.batch_us));
+        break;
+
+      case SpscWait::SPIN_PARK:
+      default:
+        if (!spinWait(wait_.spin_ns))
+        {
+          park(usec);
+        }
+
+        if (wait_.adaptive)
+        {
+          adapt();
+        }
+        break;
+    }
+
+    return pop();
+  }
+
+  inline void clear()
+  {
+    while (!empty())
+      pop();
+  }
+
+  inline bool empty() const
+  {
+    return (head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire));
+  }
+
+private:
+
+  static inline uint64_t nowNs()
+  {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  //
+  // spin for at most ns. return true if a value comes.
+  //
+  inline bool spinWait(uint64_t ns)
+  {
+    if (ns == 0)
+      return false;
+
+    uint64_t deadline = nowNs() + ns;
+    while (1)
+    {
+      for (int i = 0; i < 64; i++)
+      {
+        cpuRelax();
+        if (!empty())
+          return true;
+      }
+
+      if (nowNs() >= deadline)
+        return false;
+    }
+  }
+
+  inline void park(unsigned int usec)
+  {
+    std::unique_lock<std::mutex> ul(mtx_);
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv_.wait_for(ul, std::chrono::microseconds(usec), [this] { return !empty(); });
+    waiting_.store(false, std::memory_order_relaxed);
+  }
+
+  //
+  // the queue was empty, and a value comes now. Take the gap since last time as
+  // a sample of the inter-arrival time.
+  //
+  inline void adapt()
+  {
+    if (empty())
+      return;
+
+    uint64_t now = nowNs();
+    if (last_arrival_ns_ != 0)
+    {
+      uint64_t sample = now - last_arrival_ns_;
+      interval_ns_ = (interval_ns_ == 0) ? sample : (interval_ns_ * 7 + sample) / 8;
+      wait_.spin_ns = adaptSpin(interval_ns_);
+    }
+
+    last_arrival_ns_ = now;
+  }
+
+  //
+  // If values come frequently, spin a little longer than the interval, so as to catch
+  // the next value without parking. Otherwise spin shortly, and park.
+  //
+  static inline uint32_t adaptSpin(uint64_t interval_ns)
+  {
+    constexpr static uint64_t SPIN_LIMIT_NS = 200000;
+    constexpr static uint32_t SPIN_SHORT_NS = 2000;
+
+    if ((interval_ns == 0) || (interval_ns > SPIN_LIMIT_NS))
+      return SPIN_SHORT_NS;
+
+    return (uint32_t)(interval_ns + interval_ns / 4);
+  }
+
+  static inline void cpuRelax()
+  {
+#ifdef RS_HAS_MM_PAUSE
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  constexpr static size_t CACHE_LINE = 64;
+
+  std::vector<T> slots_;
+  size_t mask_;
+  char pad0_[CACHE_LINE];
+
+  // written by consumer
+  std::atomic<size_t> head_;
+  size_t tail_cache_;
+  char pad1_[CACHE_LINE];
+
+  // written by producer
+  std::atomic<size_t> tail_;
+  size_t head_cache_;
+  char pad2_[CACHE_LINE];
+
+  std::atomic<bool> waiting_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+
+  // used by consumer
+  SpscWait wait_;
+  uint64_t interval_ns_;
+  uint64_t last_arrival_ns_;
+};
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,142 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/decoder/block_kernel.hpp>
+
+#include <random>
+
+using namespace robosense::lidar;
+
+struct TestBlock
+{
+  uint8_t chans[128 * 3];
+  float chan_azis[128];
+  float vert_sins[128];
+  float vert_coss[128];
+  int32_t horiz_angles[128];
+};
+
+static void genBlock(std::mt19937& gen, uint16_t num, TestBlock& blk, BlockKernelIn& in)
+{
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::uniform_real_distribution<float> azi(0.0f, 1.0f);
+  std::uniform_int_distribution<int32_t> vert(-2500, 1500);
+  std::uniform_int_distribution<int32_t> horiz(-300, 300);
+
+  for (uint16_t i = 0; i < num * 3; i++)
+  {
+    blk.chans[i] = (uint8_t)byte(gen);
+  }
+
+  for (uint16_t i = 0; i < num; i++)
+  {
+    blk.chan_azis[i] = azi(gen);
+    int32_t v = vert(gen);
+    blk.vert_sins[i] = Trigon::calcSin(v);
+    blk.vert_coss[i] = Trigon::calcCos(v);
+    blk.horiz_angles[i] = horiz(gen);
+  }
+
+  // out of the trigon table
+  blk.horiz_angles[1] = 50000;
+
+  in.chans = blk.chans;
+  in.num = num;
+  in.block_az = std::uniform_int_distribution<int32_t>(0, 35999)(gen);
+  in.block_az_diff = 20;
+  in.chan_azis = blk.chan_azis;
+  in.vert_sins = blk.vert_sins;
+  in.vert_coss = blk.vert_coss;
+  in.horiz_angles = blk.horiz_angles;
+}
+
+TEST(TestBlockKernel, scalar)
+{
+  Trigon trigon;
+  BlockKernelParam param = {0.005f, 0.4f, 200.0f, 0.03825f, 0.0f, trigon.sinTable(), trigon.cosTable()};
+
+  uint8_t chans[] = {0x01, 0x00, 0x10,   // 256 * 0.005 = 1.28
+                     0x00, 0x10, 0x20};  // 16 * 0.005 = 0.08, too near
+  float chan_azis[] = {0.0f, 0.5f};
+  float vert_sins[] = {Trigon::calcSin(0), Trigon::calcSin(1000)};
+  float vert_coss[] = {Trigon::calcCos(0), Trigon::calcCos(1000)};
+  int32_t horiz_angles[] = {0, 0};
+  BlockKernelIn in = {chans, 2, 9000, 20, chan_azis, vert_sins, vert_coss, horiz_angles};
+
+  BlockKernelOut out;
+  decodeBlockScalar(param, in, out, 0);
+
+  ASSERT_EQ(out.valid[0], 1);
+  ASSERT_EQ(out.angle_horiz[0], 9000);
+  ASSERT_NEAR(out.x[0], 0.0f, 1e-5);
+  ASSERT_NEAR(out.y[0], -1.28f - 0.03825f, 1e-5);
+  ASSERT_NEAR(out.z[0], 0.0f, 1e-5);
+
+  ASSERT_EQ(out.valid[1], 0);
+  ASSERT_EQ(out.angle_horiz[1], 9010);
+}
+
+TEST(TestBlockKernel, sameAsScalar)
+{
+  Trigon trigon;
+  BlockKernelParam param = {0.005f, 0.4f, 200.0f, 0.03825f, 0.0f, trigon.sinTable(), trigon.cosTable()};
+
+  std::mt19937 gen(1);
+  BlockKernelType types[] = {BLOCK_KERNEL_SSE41, BLOCK_KERNEL_AVX2, BLOCK_KERNEL_NEON};
+
+  for (auto type : types)
+  {
+    BlockKernelFunc kernel = blockKernel(type);
+    if (kernel == NULL)
+      continue;
+
+    // with tail channels not aligned to SIMD width
+    uint16_t nums[] = {16, 32, 48, 80, 128, 13};
+    for (auto num : nums)
+    {
+      for (int round = 0; round < 20; round++)
+      {
+        TestBlock blk;
+        BlockKernelIn in;
+        genBlock(gen, num, blk, in);
+
+        BlockKernelOut expected, out;
+        decodeBlockScalar(param, in, expected, 0);
+        kernel(param, in, out, 0);
+
+        for (uint16_t i = 0; i < num; i++)
+        {
+          ASSERT_EQ(out.valid[i], expected.valid[i]) << blockKernelToStr(type) << " chan " << i;
+          ASSERT_EQ(out.angle_horiz[i], expected.angle_horiz[i]);
+          ASSERT_FLOAT_EQ(out.x[i], expected.x[i]);
+          ASSERT_FLOAT_EQ(out.y[i], expected.y[i]);
+          ASSERT_FLOAT_EQ(out.z[i], expected.z[i]);
+        }
+      }
+    }
+  }
+}
+
+TEST(TestBlockKernel, offset)
+{
+  Trigon trigon;
+  BlockKernelParam param = {0.005f, 0.4f, 200.0f, 0.03825f, 0.0f, trigon.sinTable(), trigon.cosTable()};
+
+  std::mt19937 gen(2);
+  TestBlock blk;
+  BlockKernelIn in;
+  genBlock(gen, 16, blk, in);
+
+  BlockKernelFunc kernel = blockKernel(blockKernelBest());
+  ASSERT_TRUE(kernel != NULL);
+
+  BlockKernelOut expected, out;
+  decodeBlockScalar(param, in, expected, 0);
+  kernel(param, in, out, 16);
+
+  for (uint16_t i = 0; i < 16; i++)
+  {
+    ASSERT_FLOAT_EQ(out.x[16 + i], expected.x[i]);
+    ASSERT_EQ(out.valid[16 + i], expected.valid[i]);
+  }
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <rs_driver/utility/buffer_pool.hpp>
+
+#include <thread>
+#include <set>
+
+using namespace robosense::lidar;
+
+TEST(TestBufferPool, getAndRecycle)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(1500, 4));
+  ASSERT_EQ(pool.bufSize(), 1500);
+  ASSERT_EQ(pool.bufNum(), 4);
+
+  std::set<Buffer*> pkts;
+  for (int i = 0; i < 4; i++)
+  {
+    Buffer* pkt = pool.get();
+    ASSERT_TRUE(pkt != NULL);
+    ASSERT_EQ(pkt->refs(), 1);
+    ASSERT_EQ(pkt->bufSize(), 1500);
+    ASSERT_EQ(pkt->dataSize(), 0);
+    ASSERT_EQ((uintptr_t)pkt->buf() % 64, 0);
+    pkts.insert(pkt);
+  }
+
+  // distinct, and exhausted
+  ASSERT_EQ(pkts.size(), 4);
+  ASSERT_TRUE(pool.get() == NULL);
+
+  // the last reference returns it to the pool
+  Buffer* pkt = *pkts.begin();
+  pkt->ref();
+  pkt->unref();
+  ASSERT_TRUE(pool.get() == NULL);
+  pkt->setTimestamp(1000);
+  pkt->unref();
+  ASSERT_EQ(pool.get(), pkt);
+  ASSERT_EQ(pkt->timestamp(), 0);
+}
+
+TEST(TestBufferPool, hugepage)
+{
+  // fall back to normal pages if no huge page is reserved.
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(65536, 8, true));
+  Buffer* pkt = pool.get();
+  ASSERT_TRUE(pkt != NULL);
+  memset(pkt->buf(), 0xFF, pkt->bufSize());
+  pkt->unref();
+}
+
+TEST(TestBufferPool, crossThread)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(64, 16));
+
+  const int NUM = 100000;
+  std::thread recycler([&pool]()
+  {
+    for (int i = 0; i < NUM; i++)
+    {
+      Buffer* pkt = NULL;
+      while ((pkt = pool.get()) == NULL)
+        std::this_thread::yield();
+      pkt->unref();
+    }
+  });
+
+  for (int i = 0; i < NUM; i++)
+  {
+    Buffer* pkt = NULL;
+    while ((pkt = pool.get()) == NULL)
+      std::this_thread::yield();
+    pkt->unref();
+  }
+
+  recycler.join();
+
+  // all back
+  for (int i = 0; i < 16; i++)
+  {
+    ASSERT_TRUE(pool.get() != NULL);
+  }
+  ASSERT_TRUE(pool.get() == NULL);
+}
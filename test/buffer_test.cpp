@@ -18,5 +18,58 @@ TEST(TestBuffer, ctor)
   pkt.setData(5, 10);
   ASSERT_EQ(pkt.data(), pkt.buf()+5);
   ASSERT_EQ(pkt.dataSize(), 10);
+
+  ASSERT_EQ(pkt.timestamp(), 0);
+  pkt.setTimestamp(1000);
+  ASSERT_EQ(pkt.timestamp(), 1000);
 }
 
+class TestRecycler : public BufferRecycler
+{
+public:
+  virtual void recycle(Buffer* pkt)
+  {
+    last = pkt;
+  }
+
+  Buffer* last = NULL;
+};
+
+TEST(TestBuffer, view)
+{
+  TestRecycler recycler;
+  uint8_t mem[100];
+
+  Buffer pkt(&recycler);
+  ASSERT_EQ(pkt.recycler(), &recycler);
+  ASSERT_EQ(pkt.bufSize(), 0);
+
+  pkt.attach(mem, sizeof(mem));
+  ASSERT_EQ(pkt.buf(), mem);
+  ASSERT_EQ(pkt.bufSize(), 100);
+
+  pkt.setData(5, 10);
+  ASSERT_EQ(pkt.data(), mem+5);
+  ASSERT_EQ(pkt.dataSize(), 10);
+
+  Buffer own(100);
+  ASSERT_TRUE(own.recycler() == NULL);
+}
+
+TEST(TestBuffer, refs)
+{
+  TestRecycler recycler;
+  Buffer pkt(&recycler);
+
+  pkt.ref();
+  pkt.ref();
+  ASSERT_EQ(pkt.refs(), 2);
+
+  pkt.unref();
+  ASSERT_TRUE(recycler.last == NULL);
+
+  // the last reference recycles it.
+  pkt.unref();
+  ASSERT_EQ(recycler.last, &pkt);
+  ASSERT_EQ(pkt.refs(), 0);
+}
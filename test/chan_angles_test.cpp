@@ -221,3 +221,31 @@ TEST(TestChanAngles, memberLoadFromDifop_fail_angle)
   }
 }
 
+
+TEST(TestChanAngles, vertTrigon)
+{
+  uint8_t vert_angle_arr[] = {0x00, 0x01, 0x02, 
+                              0x01, 0x03, 0x04,
+                              0x01, 0x05, 0x06,
+                              0x00, 0x07, 0x08};
+  uint8_t horiz_angle_arr[] = {0x00, 0x01, 0x11,
+                               0x01, 0x02, 0x22,
+                               0x00, 0x03, 0x33,
+                               0x01, 0x04, 0x44};
+
+  ChanAngles angles(4);
+
+  // before loading, all angles are 0
+  ASSERT_EQ(angles.vertSins()[0], 0.0f);
+  ASSERT_EQ(angles.vertCoss()[0], 1.0f);
+
+  ASSERT_EQ(angles.loadFromDifop((const RSCalibrationAngle*)vert_angle_arr, (const RSCalibrationAngle*)horiz_angle_arr), 0);
+
+  // rebuilt, and the same as the trigon table
+  Trigon trigon;
+  for (uint16_t chan = 0; chan < 4; chan++)
+  {
+    ASSERT_EQ(angles.vertSins()[chan], trigon.sin(angles.vertAdjust(chan)));
+    ASSERT_EQ(angles.vertCoss()[chan], trigon.cos(angles.vertAdjust(chan)));
+  }
+}
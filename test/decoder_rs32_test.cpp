@@ -202,5 +202,69 @@ TEST(TestDecoderRS32, decodeMsopPkt)
   ASSERT_EQ(point.intensity, 1);
   ASSERT_NE(point.timestamp, 0);
   ASSERT_EQ(point.ring, 2);
+
+  // use_lidar_clock = false, with the arrival time of the packet
+  decoder.param_.use_lidar_clock = false;
+  decoder.setHostTs(1000000000);
+  decoder.decodeMsopPkt(pkt, sizeof(pkt));
+  ASSERT_DOUBLE_EQ(decoder.prevPktTs(), 1000.0 - decoder.getPacketDuration());
 }
 
+
+TEST(TestDecoderRS32, decodeMsopPktPolicy)
+{
+  RS32MsopPkt pkt;
+  memset (&pkt, 0, sizeof(pkt));
+
+  DecoderRS32<PointCloud> probe(RSDecoderParam{});
+  memcpy (pkt.header.id, probe.const_param_.MSOP_ID, sizeof(pkt.header.id));
+  memcpy (pkt.blocks[0].id, probe.const_param_.BLOCK_ID, sizeof(pkt.blocks[0].id));
+  pkt.blocks[0].azimuth = htons(1000);
+  pkt.blocks[0].channels[0].distance = htons(1000);
+  pkt.blocks[0].channels[0].intensity = 1;
+
+  // dense_points = true, only the valid point is kept
+  {
+    RSDecoderParam param;
+    param.dense_points = true;
+    DecoderRS32<PointCloud> decoder(param);
+    decoder.regCallback(errCallback, splitFrame);
+    decoder.point_cloud_ = std::make_shared<PointCloud>();
+
+    decoder.decodeMsopPkt((const uint8_t*)&pkt, sizeof(pkt));
+    ASSERT_EQ(decoder.point_cloud_->points.size(), 1);
+    ASSERT_EQ(decoder.point_cloud_->points[0].intensity, 1);
+  }
+
+  // dense_points = false, the valid point is out of (start_angle, end_angle)
+  {
+    RSDecoderParam param;
+    param.dense_points = false;
+    param.start_angle = 30;
+    param.end_angle = 60;
+    DecoderRS32<PointCloud> decoder(param);
+    decoder.regCallback(errCallback, splitFrame);
+    decoder.point_cloud_ = std::make_shared<PointCloud>();
+
+    decoder.decodeMsopPkt((const uint8_t*)&pkt, sizeof(pkt));
+    ASSERT_EQ(decoder.point_cloud_->points.size(), 32);
+
+    PointT& point = decoder.point_cloud_->points[0];
+    ASSERT_TRUE(std::isnan(point.x));
+    ASSERT_EQ(point.intensity, 0);
+    ASSERT_NE(point.timestamp, 0);
+  }
+}
+
+TEST(TestDecoderRS32, pointsPerFrame)
+{
+  RSDecoderParam param;
+  DecoderRS32<PointCloud> decoder(param);
+
+  // 10Hz, single return, with one more packet
+  ASSERT_EQ(decoder.split_blks_per_frame_, 1801);
+  ASSERT_EQ(decoder.pointsPerFrame(), (1801 + 12) * 32);
+
+  decoder.split_blks_per_frame_ = 3600;
+  ASSERT_EQ(decoder.pointsPerFrame(), (3600 + 12) * 32);
+}
@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 
 #include <rs_driver/driver/decoder/decoder_mech.hpp>
+#include <rs_driver/driver/decoder/decoder_RSM1.hpp>
 #include <rs_driver/msg/point_cloud_msg.hpp>
 #include <rs_driver/utility/dbg.hpp>
 
@@ -285,3 +286,15 @@ TEST(TestDecoder, processMsopPkt)
   ASSERT_EQ(errCode, ERRCODE_SUCCESS);
 }
 
+TEST(TestDecoder, pointsPerFrame)
+{
+  RSDecoderParam param;
+  DecoderRSM1<PointCloud> decoder(param);
+  size_t pkt_points = decoder.const_param_.BLOCKS_PER_PKT * decoder.const_param_.CHANNELS_PER_BLOCK;
+
+  // by packets of a frame
+  ASSERT_EQ(decoder.pointsPerFrame(), 630 * pkt_points);
+
+  decoder.echo_mode_ = RSEchoMode::ECHO_DUAL;
+  ASSERT_EQ(decoder.pointsPerFrame(), 1260 * pkt_points);
+}
@@ -0,0 +1,65 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/input/input_raw.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
+#include <rs_driver/utility/spsc_queue.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace robosense::lidar;
+
+#define THREAD_NUM 4
+#define PKT_NUM 1000
+
+//
+// decodePacket() may be called from several threads. Packets are fed into a single-producer queue.
+//
+TEST(TestInputRaw, feedConcurrently)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(ETH_LEN, THREAD_NUM * PKT_NUM));
+
+  SpscQueue<Buffer*> queue(THREAD_NUM * PKT_NUM * 2);
+
+  RSInputParam param;
+  InputRaw input(param);
+  input.regCallback(
+      [](const Error&) {},
+      [&](size_t) { return pool.get(); },
+      [&](Buffer* pkt, bool) { queue.push(pkt); });
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREAD_NUM; t++)
+  {
+    threads.emplace_back([&input, t]() {
+      uint8_t data[100];
+      memset(data, (uint8_t)t, sizeof(data));
+      for (int i = 0; i < PKT_NUM; i++)
+      {
+        input.feedPacket(data, sizeof(data));
+      }
+    });
+  }
+
+  for (auto& th : threads)
+  {
+    th.join();
+  }
+
+  int pkts[THREAD_NUM] = {0};
+  for (Buffer* pkt = queue.pop(); pkt != NULL; pkt = queue.pop())
+  {
+    ASSERT_EQ(pkt->dataSize(), 100);
+    ASSERT_EQ(pkt->data()[0], pkt->data()[99]);
+    ASSERT_LT(pkt->data()[0], THREAD_NUM);
+    pkts[pkt->data()[0]]++;
+    pkt->unref();
+  }
+
+  for (int t = 0; t < THREAD_NUM; t++)
+  {
+    ASSERT_EQ(pkts[t], PKT_NUM);
+  }
+}
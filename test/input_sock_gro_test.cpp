@@ -0,0 +1,149 @@
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__) && (defined(ENABLE_EPOLL_RECEIVE) || defined(ENABLE_IO_URING_RECEIVE))
+#include <rs_driver/driver/input/input_sock.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+using namespace robosense::lidar;
+
+#define MSOP_PORT 26799
+#define SEG_SIZE 100
+#define SEG_NUM 10
+#define SEND_NUM 20
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+//
+// send SEG_NUM packets in one datagram with UDP_SEGMENT, and the last one is shorter.
+// The kernel hands it to a socket with UDP_GRO as it is.
+//
+static bool sendSegments(uint16_t port)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  uint8_t buf[SEG_SIZE * SEG_NUM - SEG_SIZE / 2];
+  for (size_t i = 0; i < sizeof(buf); i++)
+  {
+    buf[i] = (uint8_t)(i / SEG_SIZE);
+  }
+
+  bool ok = true;
+  for (int n = 0; n < SEND_NUM; n++)
+  {
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+
+    union
+    {
+      char buf[CMSG_SPACE(sizeof(uint16_t))];
+      struct cmsghdr align;
+    } ctrl;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t seg_size = SEG_SIZE;
+    memcpy(CMSG_DATA(cmsg), &seg_size, sizeof(seg_size));
+
+    if (sendmsg(fd, &msg, 0) != (ssize_t)sizeof(buf))
+    {
+      ok = false;
+      break;
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  close(fd);
+  return ok;
+}
+
+TEST(TestInputSockGro, split)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(ETH_LEN, 256));
+
+  std::atomic<int> pkts{0};
+  std::atomic<int> short_pkts{0};
+  std::atomic<int> errors{0};
+
+  RSInputParam param;
+  param.msop_port = MSOP_PORT;
+  param.difop_port = 0;
+  param.user_layer_bytes = 2;
+  param.sock_udp_gro = true;
+
+  InputSock input(param);
+  input.regCallback(
+      [](const Error&) {},
+      [&](size_t) { return pool.get(); },
+      [&](Buffer* pkt, bool) {
+        // the packet after the user layer, filled with the index of its segment.
+        size_t len = pkt->dataSize();
+        if ((len != SEG_SIZE - 2) && (len != SEG_SIZE / 2 - 2))
+          errors++;
+        else if ((pkt->data()[0] != pkt->data()[len - 1]) || (pkt->data()[0] != pkts % SEG_NUM))
+          errors++;
+
+        if (len == SEG_SIZE / 2 - 2)
+          short_pkts++;
+        pkts++;
+        pkt->unref();
+      });
+
+  ASSERT_TRUE(input.init());
+  ASSERT_TRUE(input.start());
+
+  ASSERT_TRUE(sendSegments(MSOP_PORT));
+
+  for (int i = 0; (i < 1000) && (pkts != SEG_NUM * SEND_NUM); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  input.stop();
+
+  ASSERT_EQ(pkts, SEG_NUM * SEND_NUM);
+  ASSERT_EQ(short_pkts, SEND_NUM);
+  ASSERT_EQ(errors, 0);
+
+  // packets are views on the datagrams, not buffers of the pool.
+  std::vector<Buffer*> bufs;
+  for (Buffer* pkt = pool.get(); pkt != NULL; pkt = pool.get())
+  {
+    bufs.push_back(pkt);
+  }
+
+  ASSERT_EQ(bufs.size(), 256);
+  for (size_t i = 0; i < bufs.size(); i++)
+  {
+    bufs[i]->unref();
+  }
+}
+
+#endif
@@ -0,0 +1,99 @@
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__) && (defined(ENABLE_EPOLL_RECEIVE) || defined(ENABLE_IO_URING_RECEIVE))
+#include <rs_driver/driver/input/input_sock.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace robosense::lidar;
+
+#define MSOP_PORT 26899
+#define PKT_NUM 100
+
+static uint64_t timeNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void sendPackets(uint16_t port, size_t num)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  uint8_t buf[100] = {0};
+  for (size_t i = 0; i < num; i++)
+  {
+    sendto(fd, buf, sizeof(buf), 0, (struct sockaddr*)&addr, sizeof(addr));
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  close(fd);
+}
+
+//
+// packets are stamped when they arrive, before they are handed over, with recvmsg() or recvmmsg().
+//
+static void testTimestamp(uint16_t recv_batch_num)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(ETH_LEN, 256));
+
+  std::atomic<int> pkts{0};
+  std::atomic<int> errors{0};
+  uint64_t begin = timeNs();
+
+  RSInputParam param;
+  param.msop_port = MSOP_PORT;
+  param.difop_port = 0;
+  param.recv_batch_num = recv_batch_num;
+  param.sock_timestamp = true;
+
+  InputSock input(param);
+  input.regCallback(
+      [](const Error&) {},
+      [&](size_t) { return pool.get(); },
+      [&](Buffer* pkt, bool) {
+        uint64_t ts = pkt->timestamp();
+        if ((ts < begin) || (ts > timeNs()))
+          errors++;
+        pkts++;
+        pkt->unref();
+      });
+
+  ASSERT_TRUE(input.init());
+  ASSERT_TRUE(input.start());
+
+  sendPackets(MSOP_PORT, PKT_NUM);
+
+  for (int i = 0; (i < 1000) && (pkts != PKT_NUM); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  input.stop();
+
+  ASSERT_EQ(pkts, PKT_NUM);
+  ASSERT_EQ(errors, 0);
+}
+
+TEST(TestInputSockTimestamp, recvOne)
+{
+  testTimestamp(1);
+}
+
+TEST(TestInputSockTimestamp, recvBatch)
+{
+  testTimestamp(8);
+}
+
+#endif
@@ -0,0 +1,102 @@
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__) && defined(ENABLE_IO_URING_RECEIVE)
+#include <rs_driver/driver/input/unix/input_sock_uring.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace robosense::lidar;
+
+#define MSOP_PORT 26699
+#define POOL_NUM 256
+#define PKT_NUM 500
+
+static void sendPackets(uint16_t port, size_t num)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  uint8_t buf[100];
+  for (size_t i = 0; i < num; i++)
+  {
+    memset(buf, (uint8_t)i, sizeof(buf));
+    sendto(fd, buf, sizeof(buf), 0, (struct sockaddr*)&addr, sizeof(addr));
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  close(fd);
+}
+
+TEST(TestInputSockUring, recv)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(ETH_LEN, POOL_NUM));
+
+  std::atomic<int> pkts{0};
+  std::atomic<int> errors{0};
+
+  RSInputParam param;
+  param.msop_port = MSOP_PORT;
+  param.difop_port = 0;
+
+  InputSockUring input(param, false);
+  input.regCallback(
+      [](const Error&) {},
+      [&](size_t) { return pool.get(); },
+      [&](Buffer* pkt, bool) {
+        if ((pkt->dataSize() != 100) || (pkt->data()[0] != pkt->data()[99]))
+          errors++;
+        pkts++;
+        pkt->unref();
+      });
+
+  ASSERT_TRUE(input.init());
+  ASSERT_TRUE(input.start());
+  if (input.ring_fd_ < 0)
+  {
+    GTEST_SKIP() << "io_uring is not available. Receive with epoll.";
+  }
+
+  sendPackets(MSOP_PORT, PKT_NUM);
+
+  for (int i = 0; (i < 1000) && (pkts != PKT_NUM); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  input.stop();
+
+  if (input.unsupported_)
+  {
+    GTEST_SKIP() << "io_uring multishot recvmsg is not supported. Receive with epoll.";
+  }
+
+  // received with io_uring.
+  ASSERT_TRUE(input.received_);
+  ASSERT_EQ(pkts, PKT_NUM);
+  ASSERT_EQ(errors, 0);
+
+  // buffers in the ring are back to the pool.
+  std::vector<Buffer*> bufs;
+  for (Buffer* pkt = pool.get(); pkt != NULL; pkt = pool.get())
+  {
+    bufs.push_back(pkt);
+  }
+
+  ASSERT_EQ(bufs.size(), POOL_NUM);
+  for (size_t i = 0; i < bufs.size(); i++)
+  {
+    bufs[i]->unref();
+  }
+}
+
+#endif
@@ -0,0 +1,220 @@
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__) && defined(ENABLE_XDP_RECEIVE)
+#include <rs_driver/driver/input/unix/input_xdp.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
+
+#include <linux/if_packet.h>
+
+using namespace robosense::lidar;
+
+#define DEV_RECV "rsxdp0"
+#define DEV_SEND "rsxdp1"
+#define MSOP_PORT_0 6699
+#define DIFOP_PORT_0 7788
+#define MSOP_PORT_1 6698
+#define OTHER_PORT 6697
+#define PKT_NUM 300
+
+//
+// packets of the veth pair are received in generic (SKB) mode.
+//
+static bool createVeth()
+{
+  return (system("ip link add " DEV_RECV " type veth peer name " DEV_SEND " 2>/dev/null && "
+        "ip link set " DEV_RECV " up && ip link set " DEV_SEND " up") == 0);
+}
+
+static void deleteVeth()
+{
+  int ret = system("ip link del " DEV_RECV " 2>/dev/null");
+  (void)ret;
+}
+
+//
+// the Ethernet frame of UDP packet i to port. payload bytes are i.
+//
+static size_t makeFrame(uint8_t* frame, uint16_t port, uint8_t i, bool vlan)
+{
+  size_t off = 0;
+  memset(frame, 0xFF, 6);
+  memset(frame + 6, 0x02, 6);
+  if (vlan)
+  {
+    frame[12] = 0x81;
+    frame[13] = 0x00;
+    frame[14] = 0x00;
+    frame[15] = 0x05;
+    off = VLAN_HDR_LEN;
+  }
+
+  uint8_t* ip = frame + off + 14;
+  frame[off + 12] = 0x08;
+  frame[off + 13] = 0x00;
+  memset(ip, 0, 28);
+  ip[0] = 0x45;
+  ip[2] = 0;
+  ip[3] = 128;   // ip total length
+  ip[8] = 64;
+  ip[9] = IPPROTO_UDP;
+  ip[12] = 192; ip[13] = 168; ip[14] = 1; ip[15] = 200;
+  ip[16] = 192; ip[17] = 168; ip[18] = 1; ip[19] = 102;
+
+  uint8_t* udp = ip + 20;
+  udp[0] = (uint8_t)(port >> 8);
+  udp[1] = (uint8_t)port;
+  udp[2] = (uint8_t)(port >> 8);
+  udp[3] = (uint8_t)port;
+  udp[4] = 0;
+  udp[5] = 108;  // udp length
+
+  memset(udp + 8, i, 100);
+  return off + ETH_HDR_LEN + 100;
+}
+
+static void sendFrames(uint16_t port, size_t num, bool vlan)
+{
+  int fd = socket(AF_PACKET, SOCK_RAW, 0);
+
+  struct sockaddr_ll ll;
+  memset(&ll, 0, sizeof(ll));
+  ll.sll_family = AF_PACKET;
+  ll.sll_ifindex = (int)if_nametoindex(DEV_SEND);
+  ll.sll_halen = 6;
+
+  uint8_t frame[ETH_LEN];
+  for (size_t i = 0; i < num; i++)
+  {
+    size_t len = makeFrame(frame, port, (uint8_t)i, vlan);
+    sendto(fd, frame, len, 0, (struct sockaddr*)&ll, sizeof(ll));
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  close(fd);
+}
+
+struct Receiver
+{
+  Receiver(uint16_t msop_port, uint16_t difop_port)
+  {
+    RSInputParam param;
+    param.device_name = DEV_RECV;
+    param.msop_port = msop_port;
+    param.difop_port = difop_port;
+
+    pool.init(ETH_LEN, 16);
+    input.reset(new InputXdp(param));
+    input->regCallback(
+        [](const Error&) {},
+        [&](size_t) { copies++; return pool.get(); },
+        [&](Buffer* pkt, bool) {
+          if ((pkt->dataSize() != 100) || (pkt->data()[0] != pkt->data()[99]))
+            errors++;
+          pkts++;
+          pkt->unref();
+        });
+  }
+
+  BufferPool pool;
+  std::unique_ptr<InputXdp> input;
+  std::atomic<int> pkts{0};
+  std::atomic<int> errors{0};
+  std::atomic<int> copies{0};
+};
+
+static void waitFor(const Receiver& r, int num)
+{
+  for (int i = 0; (i < 500) && (r.pkts < num); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+}
+
+//
+// two drivers on one device. Packets are dispatched by UDP port, as views on UMEM, and others go to the kernel stack.
+//
+TEST(TestInputXdp, recv)
+{
+  deleteVeth();
+  if (!createVeth())
+  {
+    GTEST_SKIP() << "no veth device. CAP_NET_ADMIN is required.";
+  }
+
+  Receiver r0(MSOP_PORT_0, DIFOP_PORT_0);
+  Receiver r1(MSOP_PORT_1, 0);
+  if (!r0.input->init())
+  {
+    deleteVeth();
+    GTEST_SKIP() << "AF_XDP is not available.";
+  }
+
+  ASSERT_TRUE(r1.input->init());
+  ASSERT_TRUE(r0.input->start());
+  ASSERT_TRUE(r1.input->start());
+
+  // shared by the drivers
+  std::shared_ptr<XdpPort> port = XdpPort::join(DEV_RECV);
+  ASSERT_EQ(port->members_.size(), 2);
+
+  sendFrames(MSOP_PORT_0, PKT_NUM, false);
+  sendFrames(DIFOP_PORT_0, 10, true);
+  sendFrames(MSOP_PORT_1, PKT_NUM, false);
+  sendFrames(OTHER_PORT, 10, false);
+
+  waitFor(r0, PKT_NUM + 10);
+  waitFor(r1, PKT_NUM);
+
+  // a driver is removed, and the other goes on.
+  r1.input->stop();
+  sendFrames(MSOP_PORT_0, 10, false);
+  sendFrames(MSOP_PORT_1, 10, false);
+  waitFor(r0, PKT_NUM + 20);
+
+  r0.input->stop();
+
+  ASSERT_EQ(r0.pkts, PKT_NUM + 20);
+  ASSERT_EQ(r0.errors, 0);
+  ASSERT_EQ(r1.pkts, PKT_NUM);
+  ASSERT_EQ(r1.errors, 0);
+
+  // packets are views on UMEM, and are recycled.
+  ASSERT_EQ(r0.copies, 0);
+  ASSERT_EQ(r1.copies, 0);
+  ASSERT_EQ(port->free_views_.size(), port->views_.size());
+
+  port.reset();
+  r0.input.reset();
+  r1.input.reset();
+  deleteVeth();
+}
+
+TEST(TestInputXdp, conflict)
+{
+  deleteVeth();
+  if (!createVeth())
+  {
+    GTEST_SKIP() << "no veth device. CAP_NET_ADMIN is required.";
+  }
+
+  {
+    Receiver r0(MSOP_PORT_0, DIFOP_PORT_0);
+    Receiver r1(DIFOP_PORT_0, 0);
+    if (r0.input->init())
+    {
+      ASSERT_TRUE(r1.input->init());
+      ASSERT_TRUE(r0.input->start());
+      ASSERT_FALSE(r1.input->start());
+    }
+  }
+
+  RSInputParam param;
+  InputXdp input(param);
+  input.regCallback([](const Error&) {}, [](size_t) { return (Buffer*)NULL; }, [](Buffer*, bool) {});
+  ASSERT_FALSE(input.init());
+
+  deleteVeth();
+}
+
+#endif
@@ -0,0 +1,297 @@
+#include <gtest/gtest.h>
+
+#include "rs16_pcap_writer.hpp"
+
+#include <rs_driver/driver/lidar_driver_impl.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace robosense::lidar;
+
+typedef PointXYZIRT PointT;
+typedef PointCloudT<PointT> PointCloud;
+
+//
+// RS16 packets, 150 a round. Frames are split at packet 150, 300, ...
+//
+static const size_t PKTS_PER_FRAME = 150;
+
+static RSDriverParam makeParam(bool decode_inline)
+{
+  RSDriverParam param;
+  param.lidar_type = LidarType::RS16;
+  param.input_type = InputType::RAW_PACKET;
+  param.decode_inline = decode_inline;
+  param.decoder_param.wait_for_difop = false;
+  return param;
+}
+
+static Packet makePacket(size_t i)
+{
+  Packet pkt(1248);
+  makeRs16Packet(i, 20, pkt.buf_.data());
+  return pkt;
+}
+
+//
+// free buffers of the pool. They are taken and put back.
+//
+static size_t freeBuffers(BufferPool& pool)
+{
+  std::vector<Buffer*> bufs;
+  for (Buffer* pkt = pool.get(); pkt != NULL; pkt = pool.get())
+  {
+    bufs.push_back(pkt);
+  }
+
+  for (auto pkt : bufs)
+  {
+    pkt->unref();
+  }
+  return bufs.size();
+}
+
+struct CloudInfo
+{
+  size_t size;
+  std::thread::id thread_id;
+};
+
+static void regCloud(LidarDriverImpl<PointCloud>& driver, std::vector<CloudInfo>& clouds)
+{
+  driver.regPointCloudCallback(
+      []() { return std::make_shared<PointCloud>(); },
+      [&clouds](std::shared_ptr<PointCloud> cloud)
+      {
+        clouds.push_back(CloudInfo{cloud->points.size(), std::this_thread::get_id()});
+      });
+}
+
+TEST(TestLidarDriverImpl, decodeInline)
+{
+  LidarDriverImpl<PointCloud> driver;
+  std::vector<CloudInfo> clouds;
+  regCloud(driver, clouds);
+
+  ASSERT_TRUE(driver.init(makeParam(true)));
+  ASSERT_TRUE(driver.start());
+  ASSERT_FALSE(driver.handle_thread_.joinable());
+
+  size_t buf_num = driver.pkt_pool_.bufNum();
+  for (size_t i = 0; i <= PKTS_PER_FRAME * 2; i++)
+  {
+    driver.decodePacket(makePacket(i));
+
+    // delivered before decodePacket() returns.
+    ASSERT_EQ(clouds.size(), i / PKTS_PER_FRAME);
+  }
+
+  ASSERT_EQ(clouds[0].size, PKTS_PER_FRAME * 12 * 32);
+  ASSERT_EQ(clouds[1].size, PKTS_PER_FRAME * 12 * 32);
+  ASSERT_EQ(clouds[0].thread_id, std::this_thread::get_id());
+
+  // decoded in place. No buffer of the pool.
+  ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num);
+
+  driver.stop();
+}
+
+TEST(TestLidarDriverImpl, decodeInlineCopy)
+{
+  LidarDriverImpl<PointCloud> driver;
+  std::vector<CloudInfo> clouds;
+  regCloud(driver, clouds);
+
+  std::vector<uint8_t> pkts; // is_frame_begin of packets
+  driver.regPacketCallback([&pkts](const Packet& pkt) { pkts.push_back(pkt.is_frame_begin); });
+
+  ASSERT_TRUE(driver.init(makeParam(true)));
+  ASSERT_TRUE(driver.start());
+  ASSERT_FALSE(driver.handle_thread_.joinable());
+
+  size_t buf_num = driver.pkt_pool_.bufNum();
+  for (size_t i = 0; i <= PKTS_PER_FRAME; i++)
+  {
+    // the decoder writes the packet timestamp into a copy, not into the packet of the caller.
+    Packet pkt = makePacket(i);
+    driver.decodePacket(pkt);
+    ASSERT_EQ(memcmp(pkt.buf_.data(), makePacket(i).buf_.data(), pkt.buf_.size()), 0);
+
+    ASSERT_EQ(pkts.size(), i + 1);
+    ASSERT_EQ(clouds.size(), i / PKTS_PER_FRAME);
+
+    // the copy is back to the pool.
+    ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num);
+  }
+
+  ASSERT_EQ(pkts[PKTS_PER_FRAME], 1);
+  ASSERT_EQ(clouds[0].size, PKTS_PER_FRAME * 12 * 32);
+  ASSERT_EQ(clouds[0].thread_id, std::this_thread::get_id());
+
+  driver.stop();
+}
+
+struct BatchInfo
+{
+  size_t size;
+  uint8_t is_frame_begin;  // of the first packet
+  uint32_t seq;            // of the first packet
+};
+
+static void regBatch(LidarDriverImpl<PointCloud>& driver, std::vector<BatchInfo>& batches)
+{
+  driver.regPacketBatchCallback(
+      [&batches](const std::vector<PacketView>& views)
+      {
+        batches.push_back(BatchInfo{views.size(), views[0].is_frame_begin, views[0].seq});
+      });
+}
+
+static size_t deliveredPackets(const std::vector<BatchInfo>& batches)
+{
+  size_t n = 0;
+  for (auto& batch : batches)
+  {
+    n += batch.size;
+  }
+  return n;
+}
+
+TEST(TestLidarDriverImpl, packetBatch)
+{
+  LidarDriverImpl<PointCloud> driver;
+  std::vector<CloudInfo> clouds;
+  regCloud(driver, clouds);
+
+  std::vector<BatchInfo> batches;
+  regBatch(driver, batches);
+
+  ASSERT_TRUE(driver.init(makeParam(true)));
+  ASSERT_TRUE(driver.start());
+
+  size_t buf_num = driver.pkt_pool_.bufNum();
+  for (size_t i = 0; i <= PKTS_PER_FRAME * 2; i++)
+  {
+    driver.decodePacket(makePacket(i));
+
+    // packets of the current frame are held. The others are back to the pool.
+    ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num - (i + 1 - deliveredPackets(batches)));
+  }
+
+  // a batch a frame, delivered when the next frame begins.
+  ASSERT_EQ(batches.size(), 2);
+  ASSERT_EQ(batches[0].size, PKTS_PER_FRAME);
+  ASSERT_EQ(batches[0].seq, 0);
+  ASSERT_EQ(batches[1].size, PKTS_PER_FRAME);
+  ASSERT_EQ(batches[1].is_frame_begin, 1);
+  ASSERT_EQ(batches[1].seq, PKTS_PER_FRAME);
+
+  // the last one at stop().
+  driver.stop();
+  ASSERT_EQ(batches.size(), 3);
+  ASSERT_EQ(batches[2].size, 1);
+  ASSERT_EQ(batches[2].is_frame_begin, 1);
+  ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num);
+}
+
+TEST(TestLidarDriverImpl, packetBatchInParts)
+{
+  LidarDriverImpl<PointCloud> driver;
+  std::vector<CloudInfo> clouds;
+  regCloud(driver, clouds);
+
+  std::vector<BatchInfo> batches;
+  regBatch(driver, batches);
+
+  // a frame is larger than half of the pool.
+  RSDriverParam param = makeParam(true);
+  param.packet_pool_size = 64;
+  ASSERT_TRUE(driver.init(param));
+  ASSERT_TRUE(driver.start());
+  ASSERT_EQ(driver.pkt_batch_max_, 32);
+
+  for (size_t i = 0; i <= PKTS_PER_FRAME; i++)
+  {
+    driver.decodePacket(makePacket(i));
+
+    // never more than a part is held.
+    ASSERT_GE(freeBuffers(driver.pkt_pool_), 64 - 32);
+  }
+
+  // 150 packets in 4 parts of 32, and the rest when the next frame begins.
+  ASSERT_EQ(batches.size(), 5);
+  for (size_t i = 0; i < 4; i++)
+  {
+    ASSERT_EQ(batches[i].size, 32);
+    ASSERT_EQ(batches[i].seq, i * 32);
+  }
+  ASSERT_EQ(batches[4].size, PKTS_PER_FRAME - 4 * 32);
+  ASSERT_EQ(clouds.size(), 1);
+
+  driver.stop();
+  ASSERT_EQ(batches.size(), 6);
+  ASSERT_EQ(batches[5].seq, PKTS_PER_FRAME);
+  ASSERT_EQ(freeBuffers(driver.pkt_pool_), 64);
+}
+
+TEST(TestLidarDriverImpl, packetBatchHold)
+{
+  LidarDriverImpl<PointCloud> driver;
+  std::vector<CloudInfo> clouds;
+  regCloud(driver, clouds);
+
+  // the first packet of each batch is held beyond the callback.
+  std::vector<PacketHandle> handles;
+  driver.regPacketBatchCallback(
+      [&handles](const std::vector<PacketView>& views) { handles.push_back(views[0].hold()); });
+
+  ASSERT_TRUE(driver.init(makeParam(true)));
+  ASSERT_TRUE(driver.start());
+
+  size_t buf_num = driver.pkt_pool_.bufNum();
+  for (size_t i = 0; i <= PKTS_PER_FRAME; i++)
+  {
+    driver.decodePacket(makePacket(i));
+  }
+  driver.stop();
+
+  ASSERT_EQ(handles.size(), 2);
+  ASSERT_EQ(handles[1]->seq, PKTS_PER_FRAME);
+  ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num - 2);
+
+  handles.clear();
+  ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num);
+}
+
+TEST(TestLidarDriverImpl, packetBatchHandleThread)
+{
+  LidarDriverImpl<PointCloud> driver;
+  std::vector<CloudInfo> clouds;
+  regCloud(driver, clouds);
+
+  std::vector<BatchInfo> batches;
+  regBatch(driver, batches);
+
+  ASSERT_TRUE(driver.init(makeParam(false)));
+  ASSERT_TRUE(driver.start());
+  ASSERT_TRUE(driver.handle_thread_.joinable());
+
+  size_t buf_num = driver.pkt_pool_.bufNum();
+  for (size_t i = 0; i <= PKTS_PER_FRAME * 2; i++)
+  {
+    driver.decodePacket(makePacket(i));
+  }
+
+  // the handle thread is done with the packets, before stop() delivers the last batch.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  driver.stop();
+
+  ASSERT_EQ(batches.size(), 3);
+  ASSERT_EQ(deliveredPackets(batches), PKTS_PER_FRAME * 2 + 1);
+  ASSERT_EQ(batches[2].seq, PKTS_PER_FRAME * 2);
+  ASSERT_NE(clouds[0].thread_id, std::this_thread::get_id());
+  ASSERT_EQ(freeBuffers(driver.pkt_pool_), buf_num);
+}
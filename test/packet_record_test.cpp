@@ -0,0 +1,306 @@
+
+#include <gtest/gtest.h>
+
+#include "rs16_pcap_writer.hpp"
+
+#include <rs_driver/driver/packet_recorder.hpp>
+#include <rs_driver/driver/lidar_driver_impl.hpp>
+#include <rs_driver/driver/input/input_pcap.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+using namespace robosense::lidar;
+
+#define RECORD_PATH "./test_packet_record"
+#define RECORD_COPY "./test_packet_record_copy"
+#define RECORD_PCAP "./test_packet_record.pcap"
+
+static const size_t MSOP_LEN = 1248;
+static const size_t DIFOP_LEN = 1248;
+
+//
+// packet i: a DIFOP packet every 100 packets, and a MSOP packet begins a frame every 50.
+//
+static void makePacket(size_t i, std::vector<uint8_t>& pkt, bool& is_difop, bool& frame_begin)
+{
+  is_difop = ((i % 100) == 0);
+  frame_begin = !is_difop && ((i % 50) == 1);
+
+  pkt.assign(is_difop ? DIFOP_LEN : MSOP_LEN, (uint8_t)i);
+  memcpy(pkt.data(), &i, sizeof(i));
+}
+
+static void recordPackets(PacketRecorder& recorder, size_t num)
+{
+  for (size_t i = 0; i < num; i++)
+  {
+    std::vector<uint8_t> pkt;
+    bool is_difop, frame_begin;
+    makePacket(i, pkt, is_difop, frame_begin);
+    ASSERT_TRUE(recorder.record(pkt.data(), pkt.size(), is_difop, frame_begin, (double)i));
+  }
+}
+
+static void checkPackets(PacketRecordReader& reader, size_t num)
+{
+  PacketRecord rec;
+  for (size_t i = 0; i < num; i++)
+  {
+    std::vector<uint8_t> pkt;
+    bool is_difop, frame_begin;
+    makePacket(i, pkt, is_difop, frame_begin);
+
+    ASSERT_TRUE(reader.next(rec));
+    ASSERT_EQ(rec.len, pkt.size());
+    ASSERT_EQ(rec.type, is_difop ? (uint16_t)PacketRecordFormat::RECORD_TYPE_DIFOP : (uint16_t)PacketRecordFormat::RECORD_TYPE_MSOP);
+    ASSERT_EQ(memcmp(rec.data, pkt.data(), pkt.size()), 0);
+  }
+
+  ASSERT_FALSE(reader.next(rec));
+}
+
+static void removeRecord(const std::string& path)
+{
+  remove(PacketRecordFormat::indexPath(path).c_str());
+  for (uint32_t seg = 0; remove(PacketRecordFormat::segmentPath(path, seg).c_str()) == 0; seg++)
+  {
+  }
+}
+
+static void copyFile(const std::string& from, const std::string& to)
+{
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to, std::ios::binary);
+  out << in.rdbuf();
+}
+
+TEST(TestPacketRecord, format)
+{
+  ASSERT_EQ(sizeof(RecordHeader), 16);
+  ASSERT_EQ(PacketRecordFormat::recordLen(1248), 16 + 1248);
+  ASSERT_EQ(PacketRecordFormat::recordLen(1249), 16 + 1256);
+  ASSERT_EQ(PacketRecordFormat::segmentPath("rec", 12), "rec.00012");
+  ASSERT_EQ(PacketRecordFormat::indexPath("rec"), "rec.idx");
+
+  uint64_t pos = PacketRecordFormat::pos(3, 1000);
+  ASSERT_EQ(PacketRecordFormat::posSegment(pos), 3);
+  ASSERT_EQ(PacketRecordFormat::posOffset(pos), 1000);
+}
+
+TEST(TestPacketRecord, recordReplay)
+{
+  RSRecordParam param;
+  param.segment_mb = 1;
+
+  {
+    PacketRecorder recorder;
+    ASSERT_TRUE(recorder.open(RECORD_PATH, param));
+    recordPackets(recorder, 2000);
+  }
+
+  PacketRecordReader reader;
+  ASSERT_TRUE(reader.open(RECORD_PATH));
+  ASSERT_EQ(reader.segmentNum(), 3);
+  ASSERT_TRUE(reader.isMapped());
+  checkPackets(reader, 2000);
+
+  // frames begin at packet 1, 51, 101, ...
+  const PcapIndex& index = reader.index();
+  ASSERT_EQ(index.size(), 40);
+  ASSERT_EQ(index[2].ts, 101.0);
+
+  PacketRecord rec;
+  reader.seek(index[20].offset);
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.flags, (uint16_t)PacketRecordFormat::RECORD_FRAME_BEGIN);
+  ASSERT_EQ(*(size_t*)rec.data, 1001);
+
+  reader.seek(index[20].difop_offset);
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.type, (uint16_t)PacketRecordFormat::RECORD_TYPE_DIFOP);
+  ASSERT_EQ(*(size_t*)rec.data, 1000);
+
+  // a range of frames, as InputRecord selects it.
+  RSInputParam input_param;
+  input_param.pcap_time_begin = 1000.0;
+  size_t begin, end;
+  ASSERT_TRUE(index.range(input_param, begin, end));
+  ASSERT_EQ(begin, 20);
+  ASSERT_EQ(end, 40);
+
+  reader.rewind();
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(*(size_t*)rec.data, 0);
+
+  reader.close();
+  removeRecord(RECORD_PATH);
+}
+
+#ifndef _WIN32
+TEST(TestPacketRecord, notSealed)
+{
+  RSRecordParam param;
+  param.segment_mb = 1;
+
+  PacketRecorder recorder;
+  ASSERT_TRUE(recorder.open(RECORD_PATH, param));
+  recordPackets(recorder, 1000);
+
+  // take the files as they are, while the second segment is being written.
+  copyFile(PacketRecordFormat::indexPath(RECORD_PATH), PacketRecordFormat::indexPath(RECORD_COPY));
+  copyFile(PacketRecordFormat::segmentPath(RECORD_PATH, 0), PacketRecordFormat::segmentPath(RECORD_COPY, 0));
+  copyFile(PacketRecordFormat::segmentPath(RECORD_PATH, 1), PacketRecordFormat::segmentPath(RECORD_COPY, 1));
+  recorder.close();
+
+  PacketRecordReader reader;
+  ASSERT_TRUE(reader.open(RECORD_COPY));
+  ASSERT_EQ(reader.segmentNum(), 2);
+  ASSERT_EQ(reader.index().size(), 20);
+  checkPackets(reader, 1000);
+
+  reader.close();
+  removeRecord(RECORD_PATH);
+  removeRecord(RECORD_COPY);
+}
+#endif
+
+TEST(TestPacketRecord, noRecord)
+{
+  PacketRecordReader reader;
+  ASSERT_FALSE(reader.open("./non_existing_record"));
+
+  PacketRecorder recorder;
+  ASSERT_FALSE(recorder.record(NULL, 0, false, false, 0));
+  ASSERT_FALSE(recorder.open("./non_existing_dir/record"));
+}
+
+#ifdef ENABLE_RECORD_LZ4
+TEST(TestPacketRecord, lz4)
+{
+  RSRecordParam param;
+  param.segment_mb = 1;
+  param.segment_lz4 = true;
+
+  {
+    PacketRecorder recorder;
+    ASSERT_TRUE(recorder.open(RECORD_PATH, param));
+    recordPackets(recorder, 2000);
+  }
+
+  // packets of the same bytes compress well.
+  std::ifstream seg(PacketRecordFormat::segmentPath(RECORD_PATH, 0), std::ios::binary | std::ios::ate);
+  ASSERT_LT((size_t)seg.tellg(), (size_t)(1 << 20) / 10);
+
+  PacketRecordReader reader;
+  ASSERT_TRUE(reader.open(RECORD_PATH));
+  ASSERT_EQ(reader.segmentNum(), 3);
+  checkPackets(reader, 2000);
+
+  PacketRecord rec;
+  reader.seek(reader.index()[20].offset);
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_FALSE(reader.isMapped());
+  ASSERT_EQ(*(size_t*)rec.data, 1001);
+
+  reader.close();
+  removeRecord(RECORD_PATH);
+}
+#endif
+
+typedef PointCloudT<PointXYZIRT> PointCloud;
+
+struct FrameInfo
+{
+  double ts;
+  size_t size;
+};
+
+//
+// replay an input through a driver, and record the packets it handles if record_path isn't empty.
+//
+static std::vector<FrameInfo> replayFrames(Input& input, const std::string& record_path)
+{
+  std::vector<FrameInfo> frames;
+
+  RSDriverParam param;
+  param.lidar_type = LidarType::RS16;
+  param.input_type = InputType::RAW_PACKET;
+  param.decode_inline = true;
+  param.decoder_param.wait_for_difop = false;
+  param.decoder_param.use_lidar_clock = true;
+
+  LidarDriverImpl<PointCloud> driver;
+  driver.regPointCloudCallback(
+      []() { return std::make_shared<PointCloud>(); },
+      [&frames](std::shared_ptr<PointCloud> cloud) { frames.push_back(FrameInfo{cloud->timestamp, cloud->points.size()}); });
+  EXPECT_TRUE(driver.init(param));
+
+  RSRecordParam record_param;
+  record_param.segment_mb = 1;
+  if (!record_path.empty())
+  {
+    EXPECT_TRUE(driver.startRecord(record_path, record_param));
+  }
+
+  std::atomic<bool> exit(false);
+  input.regCallback(
+      [&exit](const Error& err) { if (err.error_code == ERRCODE_PCAPEXIT) exit = true; },
+      std::bind(&LidarDriverImpl<PointCloud>::packetGet, &driver, std::placeholders::_1),
+      std::bind(&LidarDriverImpl<PointCloud>::packetPut, &driver, std::placeholders::_1, std::placeholders::_2));
+
+  EXPECT_TRUE(input.init());
+  EXPECT_TRUE(input.start());
+
+  auto start = std::chrono::steady_clock::now();
+  while (!exit && (std::chrono::steady_clock::now() - start < std::chrono::seconds(5)))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  input.stop();
+  driver.stopRecord();
+
+  EXPECT_TRUE(exit);
+  return frames;
+}
+
+TEST(TestInputRecord, range)
+{
+  // splits in the middle of packets.
+  writeRs16Pcap(RECORD_PCAP, 2000, 13);
+
+  RSInputParam input_param;
+  input_param.pcap_path = RECORD_PCAP;
+  input_param.record_path = RECORD_PATH;
+  input_param.pcap_replay_mode = PcapReplayMode::PCAP_REPLAY_FAST;
+  input_param.pcap_repeat = false;
+
+  std::vector<FrameInfo> all;
+  {
+    InputPcap input(input_param, 0);
+    all = replayFrames(input, RECORD_PATH);
+  }
+  ASSERT_GE(all.size(), 6);
+
+  // the frame index points at the packets holding the splits.
+  // Replay from frame 3 to frame 5. The first frame is whole, not the tail of frame 2.
+  input_param.pcap_frame_begin = 3;
+  input_param.pcap_frame_end = 5;
+
+  std::vector<FrameInfo> frames;
+  {
+    InputRecord input(input_param, 0);
+    frames = replayFrames(input, "");
+  }
+  ASSERT_EQ(frames.size(), 2);
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    ASSERT_EQ(frames[i].ts, all[3 + i].ts);
+    ASSERT_EQ(frames[i].size, all[3 + i].size);
+  }
+
+  removeRecord(RECORD_PATH);
+  remove(RECORD_PCAP);
+}
@@ -0,0 +1,86 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/msg/packet_view.hpp>
+#include <rs_driver/utility/buffer_pool.hpp>
+
+#include <vector>
+
+using namespace robosense::lidar;
+
+static PacketView makeView(Buffer* pkt)
+{
+  PacketView view;
+  view.data = pkt->data();
+  view.size = pkt->dataSize();
+  view.timestamp = 1.5;
+  view.seq = 7;
+  view.buf_ = pkt;
+  return view;
+}
+
+TEST(TestPacketView, hold)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(1500, 1));
+
+  Buffer* pkt = pool.get();
+  pkt->setData(0, 100);
+  PacketView view = makeView(pkt);
+
+  {
+    PacketHandle handle = view.hold();
+    ASSERT_TRUE((bool)handle);
+    ASSERT_EQ(pkt->refs(), 2);
+    ASSERT_EQ(handle->data, pkt->data());
+    ASSERT_EQ(handle->size, 100);
+    ASSERT_EQ(handle->seq, 7);
+
+    // the driver is done with it. The handle keeps it.
+    pkt->unref();
+    ASSERT_TRUE(pool.get() == NULL);
+  }
+
+  // the last handle returns it to the pool.
+  ASSERT_EQ(pool.get(), pkt);
+}
+
+TEST(TestPacketView, copyAndMove)
+{
+  BufferPool pool;
+  ASSERT_TRUE(pool.init(1500, 1));
+
+  Buffer* pkt = pool.get();
+  PacketHandle h1 = makeView(pkt).hold();
+  pkt->unref();
+  ASSERT_EQ(pkt->refs(), 1);
+
+  PacketHandle h2 = h1;
+  ASSERT_EQ(pkt->refs(), 2);
+
+  PacketHandle h3 = std::move(h1);
+  ASSERT_FALSE((bool)h1);
+  ASSERT_EQ(pkt->refs(), 2);
+
+  std::vector<PacketHandle> handles;
+  handles.push_back(h3);
+  ASSERT_EQ(pkt->refs(), 3);
+
+  h3 = h2;
+  ASSERT_EQ(pkt->refs(), 3);
+
+  h2.reset();
+  h3.reset();
+  ASSERT_EQ(pkt->refs(), 1);
+
+  handles.clear();
+  ASSERT_EQ(pool.get(), pkt);
+}
+
+TEST(TestPacketView, noBuffer)
+{
+  PacketView view;
+  PacketHandle handle = view.hold();
+  ASSERT_FALSE((bool)handle);
+  handle.reset();
+}
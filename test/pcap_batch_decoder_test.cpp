@@ -0,0 +1,143 @@
+
+#include <gtest/gtest.h>
+
+#include "rs16_pcap_writer.hpp"
+
+#include <rs_driver/driver/pcap_batch_decoder.hpp>
+#include <rs_driver/driver/pcap_index_builder.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+#include <cstdio>
+
+using namespace robosense::lidar;
+
+typedef PointXYZIRT PointT;
+typedef PointCloudT<PointT> PointCloud;
+
+static const char* TEST_PCAP = "pcap_batch_decoder_test.pcap";
+
+struct CloudInfo
+{
+  double ts;
+  size_t size;
+  double sum;
+};
+
+static RSDriverParam makeParam(float split_angle)
+{
+  RSDriverParam param;
+  param.lidar_type = LidarType::RS16;
+  param.input_type = InputType::PCAP_FILE;
+  param.input_param.pcap_path = TEST_PCAP;
+  param.decoder_param.wait_for_difop = false;
+  param.decoder_param.use_lidar_clock = true;
+  param.decoder_param.split_angle = split_angle;
+  return param;
+}
+
+static std::vector<CloudInfo> decode(uint32_t thread_num, uint64_t chunk_bytes, float split_angle, 
+    const PcapIndex* index = NULL, size_t begin = 0, size_t end = 0)
+{
+  RSDriverParam param = makeParam(split_angle);
+
+  std::vector<CloudInfo> clouds;
+  PcapBatchDecoder<PointCloud> batch(param,
+      []() { return std::make_shared<PointCloud>(); },
+      [&clouds](std::shared_ptr<PointCloud> cloud, uint16_t, double ts)
+      {
+        CloudInfo info = {ts, cloud->points.size(), 0.0};
+        for (auto& p : cloud->points)
+          info.sum += p.x + p.y * 3 + p.z * 7;
+        clouds.push_back(info);
+      },
+      [](const Error&) {});
+
+  batch.chunk_bytes_ = chunk_bytes;
+  if (index == NULL)
+  {
+    EXPECT_TRUE(batch.decode(thread_num));
+  }
+  else
+  {
+    // as LidarDriverImpl::decodePcap() with a range of frames
+    const PcapIndex& idx = *index;
+    EXPECT_TRUE(batch.decode(thread_num, idx[begin].offset, (end < idx.size()) ? idx[end].offset : 0, 
+          idx[begin].difop_offset));
+  }
+  return clouds;
+}
+
+TEST(TestPcapBatchDecoder, sameAsOneThread)
+{
+  writeRs16Pcap(TEST_PCAP, 1200); // 8 rounds
+
+  for (float split_angle : {0.0f, 97.0f})
+  {
+    std::vector<CloudInfo> expected = decode(1, 1 << 30, split_angle);
+    ASSERT_GE(expected.size(), 7);
+
+    // chunks smaller or larger than a frame (150 packets)
+    for (uint64_t chunk_bytes : {32 * 1024, 300 * 1024})
+    {
+      std::vector<CloudInfo> clouds = decode(3, chunk_bytes, split_angle);
+      ASSERT_EQ(clouds.size(), expected.size());
+      for (size_t i = 0; i < clouds.size(); i++)
+      {
+        ASSERT_EQ(clouds[i].ts, expected[i].ts);
+        ASSERT_EQ(clouds[i].size, expected[i].size);
+        ASSERT_EQ(clouds[i].sum, expected[i].sum);
+      }
+    }
+  }
+
+  remove(TEST_PCAP);
+}
+
+TEST(TestPcapBatchDecoder, range)
+{
+  // splits at the first block of packets, or in the middle of them.
+  for (uint32_t az_step : {20, 13})
+  {
+    writeRs16Pcap(TEST_PCAP, 2000, az_step);
+
+    for (float split_angle : {0.0f, 97.0f})
+    {
+      PcapIndex index;
+      ASSERT_TRUE(PcapIndexBuilder<PointCloud>::build(makeParam(split_angle), index));
+      ASSERT_GE(index.size(), 7);
+
+      std::vector<CloudInfo> all = decode(1, 1 << 30, split_angle);
+      ASSERT_EQ(all.size(), index.size());
+
+      // on one chunk, or on chunks smaller than a frame.
+      for (uint64_t chunk_bytes : {1 << 30, 32 * 1024})
+      {
+        std::vector<CloudInfo> clouds = decode(3, chunk_bytes, split_angle, &index, 3, 6);
+        ASSERT_EQ(clouds.size(), 3);
+        for (size_t i = 0; i < clouds.size(); i++)
+        {
+          ASSERT_EQ(clouds[i].ts, all[3 + i].ts);
+          ASSERT_EQ(clouds[i].size, all[3 + i].size);
+          ASSERT_EQ(clouds[i].sum, all[3 + i].sum);
+        }
+      }
+    }
+  }
+
+  remove(TEST_PCAP);
+}
+
+TEST(TestPcapBatchDecoder, wrongPath)
+{
+  RSDriverParam param;
+  param.input_param.pcap_path = "not_exist.pcap";
+
+  bool excep = false;
+  PcapBatchDecoder<PointCloud> batch(param,
+      []() { return std::make_shared<PointCloud>(); },
+      [](std::shared_ptr<PointCloud>, uint16_t, double) {},
+      [&excep](const Error& err) { excep = (err.error_code == ERRCODE_PCAPWRONGPATH); });
+
+  ASSERT_FALSE(batch.decode(2));
+  ASSERT_TRUE(excep);
+}
@@ -0,0 +1,285 @@
+
+#include <gtest/gtest.h>
+
+#include "rs16_pcap_writer.hpp"
+
+#include <rs_driver/driver/lidar_driver_impl.hpp>
+#include <rs_driver/driver/pcap_index_builder.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+using namespace robosense::lidar;
+
+typedef PointXYZIRT PointT;
+typedef PointCloudT<PointT> PointCloud;
+
+static const char* INDEX_FILE = "pcap_index_test.rsidx";
+static const char* TEST_PCAP = "pcap_index_test.pcap";
+
+static PcapIndexKey makeKey(uint64_t file_size)
+{
+  PcapIndexKey key;
+  memset(&key, 0, sizeof(key));
+  key.file_size = file_size;
+  key.msop_port = 6699;
+  return key;
+}
+
+static void makeIndex(PcapIndex& index)
+{
+  index.reset(makeKey(1000));
+  for (uint64_t i = 0; i < 10; i++)
+  {
+    PcapFrame frame = {100.0 + 0.1 * i, 24 + i * 100, (uint64_t)((i > 0) ? 24 : 0)};
+    index.add(frame);
+  }
+}
+
+static RSDriverParam makeParam()
+{
+  RSDriverParam param;
+  param.lidar_type = LidarType::RS16;
+  param.input_type = InputType::PCAP_FILE;
+  param.input_param.pcap_path = TEST_PCAP;
+  param.input_param.pcap_replay_mode = PcapReplayMode::PCAP_REPLAY_FAST;
+  param.input_param.pcap_repeat = false;
+  param.decoder_param.wait_for_difop = false;
+  param.decoder_param.use_lidar_clock = true;
+  return param;
+}
+
+TEST(TestPcapIndex, sidecarPath)
+{
+  ASSERT_EQ(PcapIndex::sidecarPath("/data/lidar.pcap"), "/data/lidar.pcap.rsidx");
+}
+
+TEST(TestPcapIndex, saveLoad)
+{
+  PcapIndex index;
+  makeIndex(index);
+  ASSERT_TRUE(index.save(INDEX_FILE));
+
+  PcapIndex loaded;
+  ASSERT_TRUE(loaded.load(INDEX_FILE, makeKey(1000)));
+  ASSERT_EQ(loaded.size(), 10);
+  ASSERT_EQ(loaded[3].ts, index[3].ts);
+  ASSERT_EQ(loaded[3].offset, 324);
+  ASSERT_EQ(loaded[3].difop_offset, 24);
+
+  // stale. The pcap file changed.
+  ASSERT_FALSE(loaded.load(INDEX_FILE, makeKey(2000)));
+  ASSERT_EQ(loaded.size(), 0);
+
+  remove(INDEX_FILE);
+  ASSERT_FALSE(loaded.load(INDEX_FILE, makeKey(1000)));
+}
+
+TEST(TestPcapIndex, rangeByFrame)
+{
+  PcapIndex index;
+  makeIndex(index);
+
+  RSInputParam param;
+  size_t begin, end;
+
+  param.pcap_frame_begin = 3;
+  ASSERT_TRUE(index.range(param, begin, end));
+  ASSERT_EQ(begin, 3);
+  ASSERT_EQ(end, 10);
+
+  param.pcap_frame_end = 5;
+  ASSERT_TRUE(index.range(param, begin, end));
+  ASSERT_EQ(begin, 3);
+  ASSERT_EQ(end, 5);
+
+  param.pcap_frame_end = 20;
+  ASSERT_TRUE(index.range(param, begin, end));
+  ASSERT_EQ(end, 10);
+
+  param.pcap_frame_begin = 10;
+  ASSERT_FALSE(index.range(param, begin, end));
+}
+
+TEST(TestPcapIndex, rangeByTime)
+{
+  PcapIndex index;
+  makeIndex(index);
+
+  RSInputParam param;
+  size_t begin, end;
+
+  // time overrides frames
+  param.pcap_frame_begin = 8;
+  param.pcap_time_begin = 100.25;
+  ASSERT_TRUE(index.range(param, begin, end));
+  ASSERT_EQ(begin, 3);
+  ASSERT_EQ(end, 10);
+
+  param.pcap_time_end = 100.55;
+  ASSERT_TRUE(index.range(param, begin, end));
+  ASSERT_EQ(begin, 3);
+  ASSERT_EQ(end, 6);
+
+  param.pcap_time_begin = 0.0;
+  ASSERT_TRUE(index.range(param, begin, end));
+  ASSERT_EQ(begin, 0);
+  ASSERT_EQ(end, 6);
+
+  param.pcap_time_begin = 200.0;
+  param.pcap_time_end = 0.0;
+  ASSERT_FALSE(index.range(param, begin, end));
+}
+
+TEST(TestPcapIndex, keyOfDecoderParam)
+{
+  writeRs16Pcap(TEST_PCAP, 10);
+
+  RSDriverParam param = makeParam();
+  PcapIndexKey key;
+  ASSERT_TRUE(PcapIndex::makeKey(param, key));
+
+  // points out of the range change the frames.
+  RSDriverParam other = param;
+  other.decoder_param.start_angle = 90.0f;
+  PcapIndexKey other_key;
+  ASSERT_TRUE(PcapIndex::makeKey(other, other_key));
+  ASSERT_NE(memcmp(&key, &other_key, sizeof(key)), 0);
+
+  other = param;
+  other.decoder_param.max_distance = 50.0f;
+  ASSERT_TRUE(PcapIndex::makeKey(other, other_key));
+  ASSERT_NE(memcmp(&key, &other_key, sizeof(key)), 0);
+
+  remove(TEST_PCAP);
+}
+
+struct FrameInfo
+{
+  double ts;
+  size_t size;
+};
+
+//
+// replay records in [begin, end] through a driver, as LidarDriverImpl::initPcapRange() sets them.
+//
+static std::vector<FrameInfo> replayFrames(const RSDriverParam& param, uint64_t begin, uint64_t end, uint64_t difop)
+{
+  std::vector<FrameInfo> frames;
+
+  RSDriverParam driver_param = param;
+  driver_param.input_type = InputType::RAW_PACKET;
+  driver_param.decode_inline = true;
+
+  LidarDriverImpl<PointCloud> driver;
+  driver.regPointCloudCallback(
+      []() { return std::make_shared<PointCloud>(); },
+      [&frames](std::shared_ptr<PointCloud> cloud) { frames.push_back(FrameInfo{cloud->timestamp, cloud->points.size()}); });
+  EXPECT_TRUE(driver.init(driver_param));
+
+  InputPcap input(param.input_param, 0);
+  std::atomic<bool> exit(false);
+  input.regCallback(
+      [&exit](const Error& err) { if (err.error_code == ERRCODE_PCAPEXIT) exit = true; },
+      std::bind(&LidarDriverImpl<PointCloud>::packetGet, &driver, std::placeholders::_1),
+      std::bind(&LidarDriverImpl<PointCloud>::packetPut, &driver, std::placeholders::_1, std::placeholders::_2));
+
+  EXPECT_TRUE(input.init());
+  if (begin != 0)
+  {
+    input.setRange(begin, end, difop);
+  }
+  EXPECT_TRUE(input.start());
+
+  auto start = std::chrono::steady_clock::now();
+  while (!exit && (std::chrono::steady_clock::now() - start < std::chrono::seconds(5)))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  input.stop();
+
+  EXPECT_TRUE(exit);
+  return frames;
+}
+
+static void checkSeek()
+{
+  RSDriverParam param = makeParam();
+  PcapIndex index;
+  ASSERT_TRUE(PcapIndexBuilder<PointCloud>::build(param, index));
+  ASSERT_GE(index.size(), 6);
+
+  std::vector<FrameInfo> all = replayFrames(param, 0, 0, 0);
+  ASSERT_EQ(all.size(), index.size());
+
+  // replay from frame 3 to frame 5. The first frame is whole, not the tail of frame 2.
+  std::vector<FrameInfo> frames = replayFrames(param, index[3].offset, index[5].offset, index[3].difop_offset);
+  ASSERT_EQ(frames.size(), 2);
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    ASSERT_EQ(frames[i].ts, index[3 + i].ts);
+    ASSERT_EQ(frames[i].size, all[3 + i].size);
+  }
+}
+
+TEST(TestPcapIndex, seek)
+{
+  // splits at the first block of packets.
+  writeRs16Pcap(TEST_PCAP, 1200); // 8 rounds
+  checkSeek();
+  remove(TEST_PCAP);
+}
+
+TEST(TestPcapIndex, seekSplitInPacket)
+{
+  // splits in the middle of packets.
+  writeRs16Pcap(TEST_PCAP, 2000, 13); // 8 rounds
+  checkSeek();
+  remove(TEST_PCAP);
+}
+
+static size_t replayViews(bool write_pkt_ts)
+{
+  RSDriverParam param = makeParam();
+  InputPcap input(param.input_param, 0);
+  input.enableWritePktTs(write_pkt_ts);
+
+  Buffer pkt(ETH_LEN);
+  size_t pkts = 0, views = 0;
+  std::atomic<bool> exit(false);
+  input.regCallback(
+      [&exit](const Error& err) { if (err.error_code == ERRCODE_PCAPEXIT) exit = true; },
+      [&pkt](size_t) { pkt.ref(); return &pkt; },
+      [&](Buffer* p, bool) 
+      { 
+        pkts++;
+        if (p != &pkt)
+          views++;
+        p->unref();
+      });
+
+  EXPECT_TRUE(input.init());
+  EXPECT_TRUE(input.start());
+
+  auto start = std::chrono::steady_clock::now();
+  while (!exit && (std::chrono::steady_clock::now() - start < std::chrono::seconds(5)))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  input.stop();
+
+  EXPECT_EQ(pkts, 10);
+  return views;
+}
+
+TEST(TestInputPcap, copyRewrittenPacket)
+{
+  writeRs16Pcap(TEST_PCAP, 10);
+
+  // views on the mapped file, unless the decoder rewrites packets.
+  ASSERT_EQ(replayViews(false), 10);
+  ASSERT_EQ(replayViews(true), 0);
+
+  remove(TEST_PCAP);
+}
@@ -0,0 +1,78 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/input/pcap_pacer.hpp>
+
+using namespace robosense::lidar;
+
+static int64_t elapsedUs(std::chrono::steady_clock::time_point start)
+{
+  return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(TestPcapPacer, fast)
+{
+  PcapPacer pacer(PcapReplayMode::PCAP_REPLAY_FAST, 0.001, 1.0f);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < 100; i++)
+  {
+    pacer.wait(i * 10000000); // 10ms in capture
+  }
+
+  // not paced. 1s if it were. Loose, for loaded machines
+  ASSERT_LT(elapsedUs(start), 500000);
+}
+
+TEST(TestPcapPacer, fixed)
+{
+  PcapPacer pacer(PcapReplayMode::PCAP_REPLAY_FIXED, 0.001, 2.0f);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < 10; i++)
+  {
+    pacer.wait(0);
+  }
+
+  // 0.5ms per packet
+  ASSERT_GE(elapsedUs(start), 5000);
+}
+
+TEST(TestPcapPacer, timestamp)
+{
+  PcapPacer pacer(PcapReplayMode::PCAP_REPLAY_TIMESTAMP, 0.001, 2.0f);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i <= 20; i++)
+  {
+    pacer.wait(1000000000000 + i * 2000000); // 2ms in capture
+  }
+
+  // 40ms in capture, at rate 2.0
+  ASSERT_GE(elapsedUs(start), 20000);
+}
+
+TEST(TestPcapPacer, timestampRebase)
+{
+  PcapPacer pacer(PcapReplayMode::PCAP_REPLAY_TIMESTAMP, 0.001, 1.0f);
+
+  auto start = std::chrono::steady_clock::now();
+  pacer.wait(1000000000);
+
+  // long gap in capture
+  pacer.wait(1000000000 + PcapPacer::GAP_MAX_NS + 1);
+
+  // timestamp going back
+  pacer.wait(0);
+
+  // pcap reopened
+  pacer.reset();
+  pacer.wait(5000000000);
+
+  // no wait for the gaps. Loose, for loaded machines
+  ASSERT_LT(elapsedUs(start), 500000);
+
+  pacer.wait(5000000000 + 10000000);
+  ASSERT_GE(elapsedUs(start), 10000);
+}
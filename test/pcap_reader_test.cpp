@@ -0,0 +1,497 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/input/pcap_reader.hpp>
+
+#include <cstdio>
+#include <vector>
+
+#ifdef ENABLE_PCAP_GZIP
+#include <zlib.h>
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace robosense::lidar;
+
+static const char* TEST_PCAP = "pcap_reader_test.pcap";
+
+static void put16Be(std::vector<uint8_t>& v, uint16_t x)
+{
+  v.push_back((uint8_t)(x >> 8));
+  v.push_back((uint8_t)(x & 0xFF));
+}
+
+static void put32(std::vector<uint8_t>& v, uint32_t x)
+{
+  for (int i = 0; i < 4; i++)
+    v.push_back((uint8_t)(x >> (8 * i)));
+}
+
+static std::vector<uint8_t> udpFrame(uint16_t port, size_t payload_len, bool vlan = false, uint16_t frag = 0)
+{
+  std::vector<uint8_t> f(12, 0xFF);
+  if (vlan)
+  {
+    put16Be(f, 0x8100);
+    put16Be(f, 0x0001);
+  }
+  put16Be(f, 0x0800);
+
+  // IPv4
+  f.push_back(0x45); f.push_back(0);
+  put16Be(f, (uint16_t)(20 + 8 + payload_len));
+  put16Be(f, 0); put16Be(f, frag);
+  f.push_back(64); f.push_back(17);
+  put16Be(f, 0);
+  for (int i = 0; i < 8; i++) f.push_back(0);
+
+  // UDP
+  put16Be(f, port); put16Be(f, port);
+  put16Be(f, (uint16_t)(8 + payload_len)); put16Be(f, 0);
+
+  for (size_t i = 0; i < payload_len; i++)
+    f.push_back((uint8_t)i);
+
+  // Ethernet padding
+  f.push_back(0); f.push_back(0);
+  return f;
+}
+
+static void writeFile(const std::vector<uint8_t>& v)
+{
+  FILE* fp = fopen(TEST_PCAP, "wb");
+  fwrite(v.data(), 1, v.size(), fp);
+  fclose(fp);
+}
+
+static std::vector<uint8_t> pcapBytes(const std::vector<std::vector<uint8_t>>& frames, uint32_t magic, 
+    bool truncate = false)
+{
+  std::vector<uint8_t> v;
+  put32(v, magic);
+  put32(v, 0x00040002);
+  put32(v, 0); put32(v, 0); put32(v, 65535);
+  put32(v, PcapReader::LINKTYPE_ETHERNET);
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    put32(v, 100 + (uint32_t)i);
+    put32(v, 500);
+    put32(v, (uint32_t)frames[i].size());
+    put32(v, (uint32_t)frames[i].size());
+    v.insert(v.end(), frames[i].begin(), frames[i].end());
+  }
+
+  if (truncate)
+    v.resize(v.size() - 1);
+
+  return v;
+}
+
+static void writePcap(const std::vector<std::vector<uint8_t>>& frames, uint32_t magic, bool truncate = false)
+{
+  writeFile(pcapBytes(frames, magic, truncate));
+}
+
+static void putBlock(std::vector<uint8_t>& v, uint32_t type, const std::vector<uint8_t>& body)
+{
+  uint32_t len = (uint32_t)(12 + ((body.size() + 3) & ~3));
+  put32(v, type);
+  put32(v, len);
+  v.insert(v.end(), body.begin(), body.end());
+  v.resize(v.size() + (((body.size() + 3) & ~3) - body.size()), 0);
+  put32(v, len);
+}
+
+static std::vector<uint8_t> shb()
+{
+  std::vector<uint8_t> b;
+  put32(b, 0x1A2B3C4D);
+  put32(b, 0x00000001);
+  put32(b, 0xFFFFFFFF); put32(b, 0xFFFFFFFF);
+  return b;
+}
+
+static std::vector<uint8_t> idb(uint16_t link_type, int tsresol = -1)
+{
+  std::vector<uint8_t> b;
+  put32(b, link_type);
+  put32(b, 65535);
+  if (tsresol >= 0)
+  {
+    put32(b, 0x00010009); // if_tsresol, 1 byte
+    put32(b, (uint32_t)tsresol);
+    put32(b, 0);          // opt_endofopt
+  }
+  return b;
+}
+
+static std::vector<uint8_t> epb(uint32_t if_id, uint64_t ts, const std::vector<uint8_t>& frame)
+{
+  std::vector<uint8_t> b;
+  put32(b, if_id);
+  put32(b, (uint32_t)(ts >> 32)); put32(b, (uint32_t)ts);
+  put32(b, (uint32_t)frame.size()); put32(b, (uint32_t)frame.size());
+  b.insert(b.end(), frame.begin(), frame.end());
+  return b;
+}
+
+TEST(TestPcapReader, open)
+{
+  PcapReader reader;
+  ASSERT_FALSE(reader.open("not_exist.pcap"));
+  ASSERT_FALSE(reader.isOpen());
+
+  writePcap({}, 0x12345678);
+  ASSERT_FALSE(reader.open(TEST_PCAP));
+
+  writePcap({}, 0xA1B2C3D4);
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+  ASSERT_TRUE(reader.linkType() == PcapReader::LINKTYPE_ETHERNET);
+
+  PcapRecord rec;
+  ASSERT_FALSE(reader.next(rec));
+
+  remove(TEST_PCAP);
+}
+
+TEST(TestPcapReader, next)
+{
+  writePcap({udpFrame(6699, 100), udpFrame(7788, 50)}, 0xA1B2C3D4, true);
+
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+
+  PcapRecord rec;
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 100000500000);
+  ASSERT_EQ(rec.caplen, 14 + 20 + 8 + 100 + 2);
+
+  PcapUdp udp;
+  ASSERT_TRUE(PcapReader::parseUdp(reader.linkType(), rec.data, rec.caplen, udp));
+  ASSERT_EQ(udp.dst_port, 6699);
+  ASSERT_EQ(udp.payload, rec.data + 42);
+  ASSERT_EQ(udp.payload_len, 100); // without padding
+  ASSERT_EQ(udp.payload[99], 99);
+
+  // the last record is truncated
+  ASSERT_FALSE(reader.next(rec));
+
+  reader.rewind();
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 100000500000);
+
+  // copy on write. The file is not changed.
+  rec.data[42] = 0xAA;
+  reader.close();
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.data[42], 0);
+
+  remove(TEST_PCAP);
+}
+
+TEST(TestPcapReader, nanosecSwapped)
+{
+  writePcap({udpFrame(6699, 10)}, 0xA1B23C4D);
+
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+
+  PcapRecord rec;
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 100000000500);
+
+  // byte-swapped magic
+  writePcap({}, 0xD4C3B2A1);
+  ASSERT_FALSE(reader.open(TEST_PCAP)); // link type is swapped, and unsupported
+
+  remove(TEST_PCAP);
+}
+
+TEST(TestPcapReader, parseUdp)
+{
+  PcapUdp udp;
+
+  std::vector<uint8_t> f = udpFrame(6699, 100, true);
+  ASSERT_TRUE(PcapReader::parseUdp(PcapReader::LINKTYPE_ETHERNET, f.data(), f.size(), udp));
+  ASSERT_TRUE(udp.vlan);
+  ASSERT_EQ(udp.ip_off, 18);
+  ASSERT_EQ(udp.dst_port, 6699);
+  ASSERT_EQ(udp.payload, f.data() + 46);
+
+  // first fragment
+  f = udpFrame(6699, 100, false, 0x2000);
+  ASSERT_TRUE(PcapReader::parseUdp(PcapReader::LINKTYPE_ETHERNET, f.data(), f.size(), udp));
+  ASSERT_TRUE(udp.more_frags);
+  ASSERT_EQ(udp.frag_off, 0);
+  ASSERT_EQ(udp.dst_port, 6699);
+
+  // not the first fragment
+  f = udpFrame(6699, 100, false, 0x0010);
+  ASSERT_TRUE(PcapReader::parseUdp(PcapReader::LINKTYPE_ETHERNET, f.data(), f.size(), udp));
+  ASSERT_FALSE(udp.more_frags);
+  ASSERT_EQ(udp.frag_off, 128);
+  ASSERT_TRUE(udp.payload == NULL);
+
+  // not UDP
+  f = udpFrame(6699, 100);
+  f[14 + 9] = 6;
+  ASSERT_FALSE(PcapReader::parseUdp(PcapReader::LINKTYPE_ETHERNET, f.data(), f.size(), udp));
+
+  // not IPv4
+  f = udpFrame(6699, 100);
+  f[12] = 0x86;
+  f[13] = 0xDD;
+  ASSERT_FALSE(PcapReader::parseUdp(PcapReader::LINKTYPE_ETHERNET, f.data(), f.size(), udp));
+
+  // too short
+  f = udpFrame(6699, 100);
+  ASSERT_FALSE(PcapReader::parseUdp(PcapReader::LINKTYPE_ETHERNET, f.data(), 40, udp));
+}
+
+TEST(TestPcapReader, pcapng)
+{
+  std::vector<uint8_t> v;
+  putBlock(v, 0x0A0D0D0A, shb());
+  putBlock(v, 1, idb(PcapReader::LINKTYPE_ETHERNET));         // microseconds
+  putBlock(v, 1, idb(PcapReader::LINKTYPE_LINUX_SLL, 9));     // nanoseconds
+  putBlock(v, 5, std::vector<uint8_t>(20, 0));               // interface statistics, skipped
+  putBlock(v, 6, epb(0, 100000500, udpFrame(6699, 101)));
+  putBlock(v, 6, epb(1, 200000000007, udpFrame(7788, 50)));
+  putBlock(v, 6, epb(2, 0, udpFrame(6699, 10)));             // no such interface, skipped
+
+  std::vector<uint8_t> spb;
+  std::vector<uint8_t> f = udpFrame(6699, 20);
+  put32(spb, (uint32_t)f.size());
+  spb.insert(spb.end(), f.begin(), f.end());
+  putBlock(v, 3, spb);
+  writeFile(v);
+
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+  ASSERT_TRUE(reader.isMapped());
+
+  PcapRecord rec;
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 100000500000);
+  ASSERT_EQ(rec.caplen, 14 + 20 + 8 + 101 + 2);
+  ASSERT_TRUE(rec.link_type == PcapReader::LINKTYPE_ETHERNET);
+
+  PcapUdp udp;
+  ASSERT_TRUE(PcapReader::parseUdp(rec.link_type, rec.data, rec.caplen, udp));
+  ASSERT_EQ(udp.dst_port, 6699);
+  ASSERT_EQ(udp.payload_len, 101);
+
+  size_t off = reader.tell();
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 200000000007);
+  ASSERT_TRUE(rec.link_type == PcapReader::LINKTYPE_LINUX_SLL);
+
+  // simple packet block has timestamp of the previous record.
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 200000000007);
+  ASSERT_EQ(rec.caplen, f.size());
+  ASSERT_TRUE(rec.link_type == PcapReader::LINKTYPE_ETHERNET);
+  ASSERT_FALSE(reader.next(rec));
+
+  // interfaces are read again on the way.
+  reader.close();
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+  ASSERT_TRUE(reader.seek(off));
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 200000000007);
+
+  ASSERT_FALSE(reader.seek(off + 4)); // not a block
+
+  reader.rewind();
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, 100000500000);
+
+  remove(TEST_PCAP);
+}
+
+//
+// pcap bytes of frames, followed by a record of caplen, which is larger than any packet.
+//
+static std::vector<uint8_t> corruptPcapBytes(const std::vector<std::vector<uint8_t>>& frames, uint32_t caplen)
+{
+  std::vector<uint8_t> v = pcapBytes(frames, 0xA1B2C3D4);
+  put32(v, 100 + (uint32_t)frames.size());
+  put32(v, 500);
+  put32(v, caplen);
+  put32(v, caplen);
+  v.resize(v.size() + 400000, 0);
+  return v;
+}
+
+TEST(TestPcapReader, corruptLength)
+{
+  // in the file, but too large.
+  writeFile(corruptPcapBytes({udpFrame(6699, 100)}, 300000));
+
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+
+  PcapRecord rec;
+  ASSERT_TRUE(reader.next(rec));
+  size_t off = reader.tell();
+  ASSERT_FALSE(reader.next(rec));
+  ASSERT_EQ(reader.tell(), off); // stay at the corrupted record
+
+  // a packet block of pcapng file.
+  std::vector<uint8_t> v;
+  putBlock(v, 0x0A0D0D0A, shb());
+  putBlock(v, 1, idb(PcapReader::LINKTYPE_ETHERNET));
+  putBlock(v, 6, epb(0, 100000500, udpFrame(6699, 100)));
+  putBlock(v, 6, epb(0, 100000600, std::vector<uint8_t>(400000, 0)));
+  writeFile(v);
+
+  ASSERT_TRUE(reader.open(TEST_PCAP));
+  ASSERT_TRUE(reader.next(rec));
+  off = reader.tell();
+  ASSERT_FALSE(reader.next(rec));
+  ASSERT_EQ(reader.tell(), off);
+
+  remove(TEST_PCAP);
+}
+
+static std::vector<std::vector<uint8_t>> manyFrames()
+{
+  // across blocks of decompressed data
+  std::vector<std::vector<uint8_t>> frames;
+  for (size_t i = 0; i < 3000; i++)
+  {
+    frames.push_back(udpFrame((i % 10) ? 6699 : 7788, 1000 + i % 300));
+  }
+  return frames;
+}
+
+static void checkStream(const std::vector<std::vector<uint8_t>>& frames, 
+    PcapReadMode mode = PcapReadMode::PCAP_READ_MMAP)
+{
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(TEST_PCAP, mode));
+  ASSERT_FALSE(reader.isMapped());
+
+  size_t off = 0;
+  PcapRecord rec;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if (i == 2000)
+      off = reader.tell();
+
+    ASSERT_TRUE(reader.next(rec));
+    ASSERT_EQ(rec.ts_ns, (int64_t)(100 + i) * 1000000000 + 500000);
+    ASSERT_EQ(rec.caplen, frames[i].size());
+    ASSERT_EQ(memcmp(rec.data, frames[i].data(), rec.caplen), 0);
+  }
+  ASSERT_FALSE(reader.next(rec));
+
+  ASSERT_TRUE(reader.seek(off));
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, (int64_t)(100 + 2000) * 1000000000 + 500000);
+
+  reader.rewind();
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.ts_ns, (int64_t)100 * 1000000000 + 500000);
+}
+
+//
+// frames are read, and then the stream stops at the last record, which is corrupted or truncated.
+//
+static void checkStreamEnd(const std::vector<std::vector<uint8_t>>& frames, 
+    PcapReadMode mode = PcapReadMode::PCAP_READ_MMAP)
+{
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(TEST_PCAP, mode));
+  ASSERT_FALSE(reader.isMapped());
+
+  PcapRecord rec;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    ASSERT_TRUE(reader.next(rec));
+    ASSERT_EQ(rec.caplen, frames[i].size());
+  }
+  ASSERT_FALSE(reader.next(rec));
+
+  reader.rewind();
+  ASSERT_TRUE(reader.next(rec));
+  ASSERT_EQ(rec.caplen, frames[0].size());
+}
+
+TEST(TestPcapReader, readAhead)
+{
+  std::vector<std::vector<uint8_t>> frames = manyFrames();
+  writePcap(frames, 0xA1B2C3D4);
+
+  checkStream(frames, PcapReadMode::PCAP_READ_AHEAD);
+  checkStream(frames, PcapReadMode::PCAP_READ_AHEAD_DIRECT);
+
+  // not spilled up to the end of file.
+  writeFile(corruptPcapBytes(frames, 300000));
+  checkStreamEnd(frames, PcapReadMode::PCAP_READ_AHEAD);
+  checkStreamEnd(frames, PcapReadMode::PCAP_READ_AHEAD_DIRECT);
+
+  writePcap(frames, 0xA1B2C3D4, true);
+  frames.pop_back();
+  checkStreamEnd(frames, PcapReadMode::PCAP_READ_AHEAD);
+  remove(TEST_PCAP);
+}
+
+#ifdef ENABLE_PCAP_GZIP
+
+TEST(TestPcapReader, gzip)
+{
+  std::vector<std::vector<uint8_t>> frames = manyFrames();
+  std::vector<uint8_t> v = pcapBytes(frames, 0xA1B2C3D4);
+
+  // two members
+  size_t half = v.size() / 2;
+  gzFile gz = gzopen(TEST_PCAP, "wb");
+  gzwrite(gz, v.data(), (unsigned)half);
+  gzclose(gz);
+  gz = gzopen(TEST_PCAP, "ab");
+  gzwrite(gz, v.data() + half, (unsigned)(v.size() - half));
+  gzclose(gz);
+
+  checkStream(frames);
+
+  // a corrupted length, in a stream to decompress.
+  v = corruptPcapBytes(frames, 300000);
+  gz = gzopen(TEST_PCAP, "wb");
+  gzwrite(gz, v.data(), (unsigned)v.size());
+  gzclose(gz);
+  checkStreamEnd(frames);
+
+  // truncated
+  v = pcapBytes(frames, 0xA1B2C3D4, true);
+  gz = gzopen(TEST_PCAP, "wb");
+  gzwrite(gz, v.data(), (unsigned)v.size());
+  gzclose(gz);
+  frames.pop_back();
+  checkStreamEnd(frames);
+  remove(TEST_PCAP);
+}
+
+#endif
+
+#ifdef ENABLE_PCAP_ZSTD
+
+TEST(TestPcapReader, zstd)
+{
+  std::vector<std::vector<uint8_t>> frames = manyFrames();
+  std::vector<uint8_t> v = pcapBytes(frames, 0xA1B2C3D4);
+
+  std::vector<uint8_t> z(ZSTD_compressBound(v.size()));
+  z.resize(ZSTD_compress(z.data(), z.size(), v.data(), v.size(), 1));
+  writeFile(z);
+
+  checkStream(frames);
+  remove(TEST_PCAP);
+}
+
+#endif
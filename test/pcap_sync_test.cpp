@@ -0,0 +1,217 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/input/pcap_sync.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace robosense::lidar;
+
+struct TestSyncLog
+{
+  std::mutex mtx;
+  std::vector<std::pair<int, int64_t>> puts;  // source id, timestamp
+
+  size_t size()
+  {
+    std::lock_guard<std::mutex> lg(mtx);
+    return puts.size();
+  }
+};
+
+class TestSource : public PcapSyncSource
+{
+public:
+  TestSource(int id, const std::vector<int64_t>& ts, TestSyncLog& log)
+    : id_(id), ts_(ts), pos_(0), log_(log), ends_(0), repeats_(0)
+  {
+  }
+
+  virtual bool syncNext(PcapRecord& rec, size_t& data_off, size_t& data_size)
+  {
+    if (pos_ >= ts_.size())
+      return false;
+
+    rec.ts_ns = ts_[pos_++];
+    data_off = 0;
+    data_size = 0;
+    return true;
+  }
+
+  virtual void syncPut(const PcapRecord& rec, size_t data_off, size_t data_size)
+  {
+    std::lock_guard<std::mutex> lg(log_.mtx);
+    log_.puts.push_back(std::make_pair(id_, rec.ts_ns));
+  }
+
+  virtual void syncEnd(bool repeat)
+  {
+    if (repeat)
+    {
+      repeats_++;
+      pos_ = 0;
+    }
+    else
+    {
+      ends_++;
+    }
+  }
+
+  int id_;
+  std::vector<int64_t> ts_;
+  size_t pos_;
+  TestSyncLog& log_;
+  int ends_;
+  int repeats_;
+};
+
+static RSInputParam syncParam(const std::string& name, uint16_t num, bool repeat)
+{
+  RSInputParam param;
+  param.pcap_sync_group = name;
+  param.pcap_sync_num = num;
+  param.pcap_repeat = repeat;
+  param.pcap_replay_mode = PcapReplayMode::PCAP_REPLAY_FAST;
+  return param;
+}
+
+static void waitFor(TestSyncLog& log, size_t n)
+{
+  for (int i = 0; (i < 200) && (log.size() < n); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+TEST(TestPcapSync, join)
+{
+  std::shared_ptr<PcapSyncGroup> g1 = PcapSyncGroup::join(syncParam("join", 2, false));
+  std::shared_ptr<PcapSyncGroup> g2 = PcapSyncGroup::join(syncParam("join", 2, false));
+  std::shared_ptr<PcapSyncGroup> g3 = PcapSyncGroup::join(syncParam("other", 2, false));
+  ASSERT_EQ(g1, g2);
+  ASSERT_NE(g1, g3);
+
+  // a new group, after all drivers leave.
+  TestSyncLog log;
+  TestSource a(0, {1}, log);
+  g1->start(&a);
+  g1->stop(&a);
+  g1.reset();
+  g2.reset();
+
+  std::shared_ptr<PcapSyncGroup> g4 = PcapSyncGroup::join(syncParam("join", 2, false));
+  ASSERT_EQ(g4->members_.size(), 0);
+  ASSERT_FALSE(g4->replaying_);
+}
+
+TEST(TestPcapSync, merge)
+{
+  TestSyncLog log;
+  TestSource a(0, {1, 4, 5, 9}, log);
+  TestSource b(1, {2, 3, 5, 10}, log);
+
+  std::shared_ptr<PcapSyncGroup> group = PcapSyncGroup::join(syncParam("merge", 2, false));
+
+  // wait for all sources
+  group->start(&a);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_EQ(log.size(), 0);
+
+  group->start(&b);
+  waitFor(log, 8);
+
+  std::vector<std::pair<int, int64_t>> expected = 
+    {{0, 1}, {1, 2}, {1, 3}, {0, 4}, {0, 5}, {1, 5}, {0, 9}, {1, 10}};
+  ASSERT_EQ(log.puts, expected);
+
+  group->stop(&a);
+  group->stop(&b);
+  ASSERT_EQ(a.ends_, 1);
+  ASSERT_EQ(b.ends_, 1);
+}
+
+TEST(TestPcapSync, repeat)
+{
+  TestSyncLog log;
+  TestSource a(0, {1, 2}, log);
+  TestSource b(1, {3}, log);
+
+  std::shared_ptr<PcapSyncGroup> group = PcapSyncGroup::join(syncParam("repeat", 2, true));
+  group->start(&a);
+  group->start(&b);
+  waitFor(log, 6);
+
+  // stop one. The other goes on.
+  group->stop(&b);
+  size_t n = log.size();
+  waitFor(log, n + 4);
+  group->stop(&a);
+
+  std::vector<std::pair<int, int64_t>> expected = {{0, 1}, {0, 2}, {1, 3}, {0, 1}, {0, 2}, {1, 3}};
+  ASSERT_TRUE(std::equal(expected.begin(), expected.end(), log.puts.begin()));
+  ASSERT_GE(log.puts.size(), n + 4);
+  for (size_t i = n; i < log.puts.size(); i++)
+  {
+    ASSERT_EQ(log.puts[i].first, 0);
+  }
+
+  ASSERT_GE(a.repeats_, 2);
+  ASSERT_EQ(a.ends_, 0);
+}
+
+TEST(TestPcapSync, restart)
+{
+  TestSyncLog log;
+  TestSource a(0, {1, 2}, log);
+  TestSource b(1, {3}, log);
+
+  std::shared_ptr<PcapSyncGroup> group = PcapSyncGroup::join(syncParam("restart", 2, true));
+  group->start(&a);
+  group->start(&b);
+  waitFor(log, 6);
+
+  // stop and start one, while the group is replaying.
+  group->stop(&b);
+  group->start(&b);
+  ASSERT_EQ(group->members_.size(), 2);
+
+  size_t n = log.size();
+  waitFor(log, n + 12);
+  group->stop(&a);
+  group->stop(&b);
+  ASSERT_EQ(group->members_.size(), 0);
+
+  size_t b_puts = 0;
+  for (size_t i = n; i < log.puts.size(); i++)
+  {
+    if (log.puts[i].first == 1)
+      b_puts++;
+  }
+  ASSERT_GT(b_puts, 0);
+}
+
+TEST(TestPcapSync, startAfterEnd)
+{
+  TestSyncLog log;
+  TestSource a(0, {1, 2}, log);
+  TestSource b(1, {3}, log);
+
+  std::shared_ptr<PcapSyncGroup> group = PcapSyncGroup::join(syncParam("startAfterEnd", 2, false));
+  group->start(&a);
+  group->start(&b);
+  waitFor(log, 3);
+
+  // the replay thread has ended. Start it again for the restarted one.
+  group->stop(&b);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  b.pos_ = 0;
+  group->start(&b);
+  waitFor(log, 4);
+  group->stop(&a);
+  group->stop(&b);
+
+  ASSERT_EQ(log.puts.size(), 4);
+  ASSERT_EQ(log.puts[3], std::make_pair(1, (int64_t)3));
+  ASSERT_EQ(b.ends_, 2);
+}
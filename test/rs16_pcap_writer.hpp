@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//
+// Make synthetic RS16 MSOP packet i, of 1248 bytes. Packets are 100 us apart.
+// A packet has 12 blocks of az_step (0.01 degree) each, so a round is 150 packets by default.
+// With az_step not dividing 3000, frames are split in the middle of packets.
+//
+static inline void makeRs16Packet(size_t i, uint32_t az_step, uint8_t* pkt)
+{
+  static const uint8_t hdr[] = {0x55, 0xAA, 0x05, 0x0A, 0x5A, 0xA5, 0x50, 0xA0};
+  memset(pkt, 0, 1248);
+  memcpy(pkt, hdr, sizeof(hdr));
+
+  uint64_t us = i * 100;
+  pkt[20] = 23; pkt[21] = 1; pkt[22] = 1;
+  pkt[26] = (uint8_t)((us / 1000 % 1000) >> 8); pkt[27] = (uint8_t)(us / 1000 % 1000);
+  pkt[28] = (uint8_t)((us % 1000) >> 8); pkt[29] = (uint8_t)(us % 1000);
+  pkt[25] = (uint8_t)(us / 1000000);
+
+  for (size_t b = 0; b < 12; b++)
+  {
+    uint8_t* blk = pkt + 42 + b * 100;
+    uint16_t az = (uint16_t)(((i * 12 + b) * az_step) % 36000);
+    blk[0] = 0xFF; blk[1] = 0xEE; blk[2] = (uint8_t)(az >> 8); blk[3] = (uint8_t)az;
+    for (size_t c = 0; c < 32; c++)
+    {
+      uint16_t dist = (uint16_t)(1000 + c + i % 7);
+      blk[4 + c * 3] = (uint8_t)(dist >> 8); blk[5 + c * 3] = (uint8_t)dist; blk[6 + c * 3] = (uint8_t)c;
+    }
+  }
+}
+
+//
+// Write a pcap file of the synthetic RS16 MSOP packets, to port 6699.
+//
+static inline void writeRs16Pcap(const char* path, size_t pkt_num, uint32_t az_step = 20)
+{
+  std::vector<uint8_t> v;
+  auto put = [&v](const void* p, size_t len) { v.insert(v.end(), (const uint8_t*)p, (const uint8_t*)p + len); };
+
+  uint32_t file_hdr[6] = {0xA1B2C3D4, 0x00040002, 0, 0, 65535, 1};
+  put(file_hdr, sizeof(file_hdr));
+
+  for (size_t i = 0; i < pkt_num; i++)
+  {
+    uint8_t pkt[1248];
+    makeRs16Packet(i, az_step, pkt);
+    uint64_t us = i * 100;
+
+    uint8_t hdr[42] = {0};
+    hdr[12] = 0x08; hdr[13] = 0x00;
+    hdr[14] = 0x45;
+    hdr[16] = (uint8_t)((20 + 8 + 1248) >> 8); hdr[17] = (uint8_t)(20 + 8 + 1248);
+    hdr[23] = 17;
+    hdr[36] = (uint8_t)(6699 >> 8); hdr[37] = (uint8_t)6699;
+    hdr[38] = (uint8_t)((8 + 1248) >> 8); hdr[39] = (uint8_t)(8 + 1248);
+
+    uint32_t rec_hdr[4] = {(uint32_t)(us / 1000000), (uint32_t)(us % 1000000), 42 + 1248, 42 + 1248};
+    put(rec_hdr, sizeof(rec_hdr));
+    put(hdr, sizeof(hdr));
+    put(pkt, sizeof(pkt));
+  }
+
+  FILE* fp = fopen(path, "wb");
+  fwrite(v.data(), 1, v.size(), fp);
+  fclose(fp);
+}
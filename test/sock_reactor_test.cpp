@@ -0,0 +1,148 @@
+
+#include <gtest/gtest.h>
+
+#ifdef __linux__
+#include <rs_driver/driver/input/unix/sock_reactor.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace robosense::lidar;
+
+class TestSockSource : public SockReactorSource
+{
+public:
+  virtual bool reactorRecv(int fd)
+  {
+    uint8_t buf[64];
+    ssize_t ret = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (ret > 0)
+    {
+      last_fd = fd;
+      pkts++;
+    }
+
+    return true;
+  }
+
+  virtual void reactorTimeout()
+  {
+    timeouts++;
+  }
+
+  std::atomic<int> last_fd{-1};
+  std::atomic<int> pkts{0};
+  std::atomic<int> timeouts{0};
+};
+
+static int bindSocket(uint16_t& port)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+
+  socklen_t len = sizeof(addr);
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static void sendTo(uint16_t port)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  uint8_t buf[16] = {0};
+  sendto(fd, buf, sizeof(buf), 0, (struct sockaddr*)&addr, sizeof(addr));
+  close(fd);
+}
+
+static bool waitFor(const std::atomic<int>& val, int expected)
+{
+  for (int i = 0; (i < 1000) && (val != expected); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  return (val == expected);
+}
+
+TEST(TestSockReactor, join)
+{
+  RSInputParam param;
+  param.sock_reactor_group = "test_join";
+
+  std::shared_ptr<SockReactor> r1 = SockReactor::join(param);
+  std::shared_ptr<SockReactor> r2 = SockReactor::join(param);
+  ASSERT_EQ(r1, r2);
+
+  param.sock_reactor_group = "test_join_other";
+  std::shared_ptr<SockReactor> r3 = SockReactor::join(param);
+  ASSERT_NE(r1, r3);
+}
+
+TEST(TestSockReactor, dispatch)
+{
+  RSInputParam param;
+  param.sock_reactor_group = "test_dispatch";
+  std::shared_ptr<SockReactor> reactor = SockReactor::join(param);
+
+  uint16_t port_a1, port_a2, port_b;
+  int fds_a[2] = {bindSocket(port_a1), bindSocket(port_a2)};
+  int fd_b = bindSocket(port_b);
+
+  TestSockSource src_a, src_b;
+  ASSERT_TRUE(reactor->start(&src_a, fds_a, 2));
+  ASSERT_TRUE(reactor->start(&src_b, &fd_b, 1));
+
+  sendTo(port_a2);
+  ASSERT_TRUE(waitFor(src_a.pkts, 1));
+  ASSERT_EQ(src_a.last_fd, fds_a[1]);
+
+  sendTo(port_b);
+  ASSERT_TRUE(waitFor(src_b.pkts, 1));
+  ASSERT_EQ(src_b.last_fd, fd_b);
+  ASSERT_EQ(src_a.pkts, 1);
+
+  // the others go on without a removed source.
+  reactor->stop(&src_a);
+  sendTo(port_a1);
+  sendTo(port_b);
+  ASSERT_TRUE(waitFor(src_b.pkts, 2));
+  ASSERT_EQ(src_a.pkts, 1);
+
+  reactor->stop(&src_b);
+  close(fds_a[0]);
+  close(fds_a[1]);
+  close(fd_b);
+}
+
+TEST(TestSockReactor, timeout)
+{
+  RSInputParam param;
+  param.sock_reactor_group = "test_timeout";
+  std::shared_ptr<SockReactor> reactor = SockReactor::join(param);
+
+  uint16_t port;
+  int fd = bindSocket(port);
+
+  TestSockSource src;
+  ASSERT_TRUE(reactor->start(&src, &fd, 1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+  reactor->stop(&src);
+  ASSERT_GE(src.timeouts, 1);
+
+  close(fd);
+}
+#endif
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <rs_driver/utility/spsc_queue.hpp>
+
+#include <memory>
+
+using namespace robosense::lidar;
+
+TEST(TestSpscQueue, emptyPop)
+{
+  SpscQueue<std::shared_ptr<int>> queue;
+
+  ASSERT_TRUE(queue.pop().get() == NULL);
+  ASSERT_TRUE(queue.popWait(1000).get() == NULL);
+
+  SpscQueue<int*> raw_queue;
+  ASSERT_TRUE(raw_queue.pop() == NULL);
+  ASSERT_TRUE(raw_queue.popWait(1000) == NULL);
+}
+
+TEST(TestSpscQueue, valPtrPop)
+{
+  SpscQueue<std::shared_ptr<int>> queue;
+
+  {
+    std::shared_ptr<int> v_ptr = std::make_shared<int>(100);
+    ASSERT_EQ(queue.push(v_ptr), 1);
+    ASSERT_EQ(*queue.pop(), 100);
+  }
+
+  {
+    std::shared_ptr<int> v_ptr = std::make_shared<int>(100);
+    ASSERT_GT(queue.push(v_ptr), 0);
+    ASSERT_EQ(*queue.popWait(1000), 100);
+  }
+
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(TestSpscQueue, full)
+{
+  SpscQueue<std::shared_ptr<int>> queue(3);
+  ASSERT_EQ(queue.capacity(), 4);
+
+  std::shared_ptr<int> v_ptr = std::make_shared<int>(100);
+  for (size_t i = 1; i <= 4; i++)
+  {
+    ASSERT_EQ(queue.push(v_ptr), i);
+  }
+
+  ASSERT_EQ(queue.push(v_ptr), 0);
+
+  // slots are released on pop
+  queue.pop();
+  ASSERT_EQ(v_ptr.use_count(), 4);
+
+  ASSERT_GT(queue.push(v_ptr), 0);
+  ASSERT_EQ(queue.push(v_ptr), 0);
+}
+
+TEST(TestSpscQueue, clear)
+{
+  SpscQueue<std::shared_ptr<int>> queue;
+
+  std::shared_ptr<int> v_ptr = std::make_shared<int>(100);
+  ASSERT_EQ(queue.push(v_ptr), 1);
+  ASSERT_EQ(queue.push(v_ptr), 2);
+  queue.clear();
+  ASSERT_TRUE(queue.empty());
+  ASSERT_GT(queue.push(v_ptr), 0);
+}
+
+TEST(TestSpscQueue, crossThread)
+{
+  SpscQueue<std::shared_ptr<int>> queue(16);
+  const int NUM = 100000;
+
+  std::thread producer([&queue]()
+  {
+    for (int i = 0; i < NUM; i++)
+    {
+      std::shared_ptr<int> v_ptr = std::make_shared<int>(i);
+      while (queue.push(v_ptr) == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  for (int i = 0; i < NUM; i++)
+  {
+    std::shared_ptr<int> v_ptr;
+    while (v_ptr.get() == NULL)
+      v_ptr = queue.popWait(1000);
+
+    ASSERT_EQ(*v_ptr, i);
+  }
+
+  producer.join();
+}
+
+TEST(TestSpscQueue, waitModes)
+{
+  SpscWait::Mode modes[] = {SpscWait::BUSY_SPIN, SpscWait::SPIN_PARK, SpscWait::TIMED_BATCH};
+
+  for (auto mode : modes)
+  {
+    SpscQueue<int*> queue(16);
+    SpscWait wait;
+    wait.mode = mode;
+    wait.batch_us = 100;
+    queue.setWait(wait);
+
+    // timeout with nothing pushed
+    ASSERT_TRUE(queue.popWait(1000) == NULL);
+
+    const int NUM = 10000;
+    static int vals[NUM];
+
+    std::thread producer([&queue]()
+    {
+      for (int i = 0; i < NUM; i++)
+      {
+        vals[i] = i;
+        while (queue.push(&vals[i]) == 0)
+          std::this_thread::yield();
+      }
+    });
+
+    for (int i = 0; i < NUM; i++)
+    {
+      int* v = NULL;
+      while (v == NULL)
+        v = queue.popWait(1000);
+
+      ASSERT_EQ(*v, i);
+    }
+
+    producer.join();
+  }
+}
+
+TEST(TestSpscQueue, adaptiveSpin)
+{
+  SpscQueue<int*> queue;
+  SpscWait wait;
+  wait.adaptive = true;
+
+  // frequent values: spin a little longer than the interval
+  queue.setWait(wait, 10000);
+  ASSERT_EQ(queue.getWait().spin_ns, 12500);
+
+  // rare values: spin shortly, and park
+  queue.setWait(wait, 1000000);
+  ASSERT_EQ(queue.getWait().spin_ns, 2000);
+
+  // unknown
+  queue.setWait(wait, 0);
+  ASSERT_EQ(queue.getWait().spin_ns, 2000);
+
+  // not adaptive: keep it
+  wait.adaptive = false;
+  wait.spin_ns = 0;
+  queue.setWait(wait, 10000);
+  ASSERT_EQ(queue.getWait().spin_ns, 0);
+}
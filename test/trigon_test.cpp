@@ -30,3 +30,20 @@ TEST(TestTrigon, ctor)
 #endif
 }
 
+
+TEST(TestTrigon, shared)
+{
+  Trigon a, b;
+  ASSERT_EQ(a.sinTable(), b.sinTable());
+  ASSERT_EQ(a.cosTable(), b.cosTable());
+
+  for (int32_t angle = Trigon::ANGLE_MIN; angle < Trigon::ANGLE_MAX; angle += 7)
+  {
+    ASSERT_EQ(a.sin(angle), Trigon::calcSin(angle));
+    ASSERT_EQ(a.cos(angle), Trigon::calcCos(angle));
+  }
+
+  // out of range
+  ASSERT_EQ(a.sin(Trigon::ANGLE_MAX), 0.0f);
+  ASSERT_EQ(a.cos(Trigon::ANGLE_MIN - 1), 1.0f);
+}